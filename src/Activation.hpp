@@ -0,0 +1,13 @@
+#pragma once
+#include <cstdint>
+
+namespace nn {
+
+// matches the ACTIVATION specialization constant of the shaders
+enum class Activation : uint32_t {
+    eNone,
+    eRelu,
+    eSigmoid,
+};
+
+} // namespace nn
@@ -0,0 +1,38 @@
+#pragma once
+#define VULKAN_HPP_NO_STRUCT_CONSTRUCTORS 1
+#include <vulkan/vulkan.hpp>
+#include <memory>
+#include <span>
+#include "DeviceAllocator.hpp"
+
+namespace nn {
+
+// a storage buffer sub-allocated from the engine, shared between the tasks that read or write it
+struct Buffer {
+    vk::UniqueBuffer Handle;
+    Allocation Memory;
+    vk::UniqueDeviceMemory Imported; // host memory bound instead of an allocation, see ComputeEngine::ImportHostMemory
+    std::shared_ptr<Allocation> Arena; // memory shared with other buffers instead, see ComputeEngine::CreateArena
+    vk::DeviceSize ArenaOffset = 0;
+    uint32_t Size;  // size of a given element
+    uint32_t Count; // elements in buffer
+
+    vk::DeviceSize Bytes() const { return vk::DeviceSize(Size) * Count; }
+    // what the device sees, Bytes() rounded up to whole uints. kernels read 8 and 16 bit elements packed into
+    // words, so the word holding the last element must be in the buffer even when it is only partly used
+    vk::DeviceSize Range() const { return (Bytes() + 3) / 4 * 4; }
+
+    // only buffers placed in the same arena can overlap, every other buffer has memory of its own
+    bool Aliases(const Buffer& other) const {
+        return this == &other || (Arena && Arena == other.Arena && ArenaOffset < other.ArenaOffset + other.Range() &&
+                                  other.ArenaOffset < ArenaOffset + Range());
+    }
+
+    // the persistently mapped contents, empty for device-local memory
+    template <typename T>
+    std::span<T> View() const {
+        return {static_cast<T*>(Memory.Mapped()), Memory.Mapped() ? Bytes() / sizeof(T) : 0};
+    }
+};
+
+} // namespace nn
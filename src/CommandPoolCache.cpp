@@ -0,0 +1,48 @@
+#include "CommandPoolCache.hpp"
+
+namespace nn {
+
+std::unique_ptr<CommandContext> CommandPoolCache::Acquire(uint32_t family) {
+    {
+        std::lock_guard lock(m_Mutex);
+        std::vector<std::unique_ptr<CommandContext>>& free = m_Free[family];
+        if (!free.empty()) {
+            std::unique_ptr<CommandContext> context = std::move(free.back());
+            free.pop_back();
+            return context;
+        }
+        m_Created++;
+    }
+
+    // tasks recorded once re-record in place when autotuned, so buffers stay individually resettable
+    vk::CommandPoolCreateInfo commandPoolCreateInfo = {
+        .sType = vk::StructureType::eCommandPoolCreateInfo,
+        .pNext = nullptr,
+        .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+        .queueFamilyIndex = family,
+    };
+
+    auto context = std::make_unique<CommandContext>();
+    context->Pool = m_Device.createCommandPoolUnique(commandPoolCreateInfo);
+    context->Family = family;
+
+    vk::CommandBufferAllocateInfo commandBufferAllocInfo = {
+        .sType = vk::StructureType::eCommandBufferAllocateInfo,
+        .pNext = nullptr,
+        .commandPool = *context->Pool,
+        .level = vk::CommandBufferLevel::ePrimary,
+        .commandBufferCount = 1,
+    };
+    context->CommandBuffer = std::move(m_Device.allocateCommandBuffersUnique(commandBufferAllocInfo).front());
+    return context;
+}
+
+void CommandPoolCache::Recycle(std::unique_ptr<CommandContext> context) {
+    // whoever recycles owns the pool until it is on the free list, so the reset needs no lock
+    m_Device.resetCommandPool(*context->Pool, {});
+
+    std::lock_guard lock(m_Mutex);
+    m_Free[context->Family].push_back(std::move(context));
+}
+
+} // namespace nn
@@ -0,0 +1,40 @@
+#pragma once
+#define VULKAN_HPP_NO_STRUCT_CONSTRUCTORS 1
+#include <vulkan/vulkan.hpp>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace nn {
+
+// a command pool with its one primary command buffer, recorded by a single thread at a time
+struct CommandContext {
+    vk::UniqueCommandPool Pool;
+    vk::UniqueCommandBuffer CommandBuffer;
+    uint32_t Family;
+};
+
+// command pools are externally synchronized, so instead of one pool per queue every recording takes a
+// pool of its own and hands it back once the device is done with it, the pool is reset and reused
+class CommandPoolCache {
+public:
+    explicit CommandPoolCache(vk::Device device) : m_Device(device) {}
+    CommandPoolCache(const CommandPoolCache&) = delete;
+    void operator=(const CommandPoolCache&) = delete;
+
+    // the command buffer is in the initial state, ready to begin
+    std::unique_ptr<CommandContext> Acquire(uint32_t family);
+    void Recycle(std::unique_ptr<CommandContext> context);
+
+    size_t Created() const { return m_Created.load(); } // pools ever created, bounded once recycling kicks in
+
+private:
+    vk::Device m_Device;
+    std::mutex m_Mutex;
+    std::unordered_map<uint32_t, std::vector<std::unique_ptr<CommandContext>>> m_Free; // per queue family
+    std::atomic<size_t> m_Created = 0;
+};
+
+} // namespace nn
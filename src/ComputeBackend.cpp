@@ -0,0 +1,24 @@
+#include "ComputeBackend.hpp"
+#include "CpuBackend.hpp"
+#include "Log.hpp"
+#include "VulkanBackend.hpp"
+
+namespace nn {
+
+std::unique_ptr<ComputeBackend> CreateBackend(BackendKind kind) {
+    if (kind == BackendKind::eCpu) {
+        return std::make_unique<CpuBackend>();
+    }
+
+    try {
+        return std::make_unique<VulkanBackend>();
+    } catch (std::exception& e) {
+        if (kind == BackendKind::eVulkan) {
+            throw;
+        }
+        LogWarning("falling back to the cpu backend:", e.what());
+        return std::make_unique<CpuBackend>();
+    }
+}
+
+} // namespace nn
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include "Activation.hpp"
+
+namespace nn {
+
+// row-major float matrix owned by a backend, only the backend that created it may use it
+class Tensor {
+public:
+    Tensor(uint32_t rows, uint32_t cols) : m_Rows(rows), m_Cols(cols) {}
+    Tensor(const Tensor&) = delete;
+    void operator=(const Tensor&) = delete;
+    virtual ~Tensor() = default;
+
+    uint32_t Rows() const { return m_Rows; }
+    uint32_t Cols() const { return m_Cols; }
+    size_t Count() const { return size_t(m_Rows) * m_Cols; }
+
+private:
+    uint32_t m_Rows;
+    uint32_t m_Cols;
+};
+
+// the operations network code is written against, implemented by the vulkan engine and natively on the cpu.
+// operations may be queued and run asynchronously, Read and Finish wait for everything queued before them
+class ComputeBackend {
+public:
+    virtual ~ComputeBackend() = default;
+
+    virtual std::string Name() const = 0;
+
+    virtual std::unique_ptr<Tensor> CreateTensor(uint32_t rows, uint32_t cols) = 0;
+    virtual void Write(Tensor& tensor, std::span<const float> data) = 0;
+    virtual void Read(const Tensor& tensor, std::span<float> data) = 0;
+
+    // dst = activation(src * weights + bias), src is M x K, weights K x N, bias 1 x N and dst M x N
+    virtual void Gemm(const Tensor& src,
+                      const Tensor& weights,
+                      const Tensor& bias,
+                      Tensor& dst,
+                      Activation function) = 0;
+    // dst = activation(src) elementwise, dst may be src
+    virtual void Activate(const Tensor& src, Tensor& dst, Activation function) = 0;
+    // dst is 1 x N with the sum of every column of src
+    virtual void SumRows(const Tensor& src, Tensor& dst) = 0;
+
+    virtual void Finish() = 0;
+};
+
+enum class BackendKind {
+    eAuto,   // vulkan when a device can be created, the cpu otherwise
+    eVulkan,
+    eCpu,
+};
+
+std::unique_ptr<ComputeBackend> CreateBackend(BackendKind kind = BackendKind::eAuto);
+
+} // namespace nn
@@ -1,7 +1,12 @@
 #include "ComputeEngine.hpp"
 #include "ComputeEngine.hpp"
-#include <fstream>
+#include <algorithm>
+#include <bit>
 #include <chrono>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_set>
 #include "Log.hpp"
 
 static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
@@ -28,16 +33,104 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
 
 namespace nn {
 
-ComputeEngine::ComputeEngine() {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// how well a device suits the engine, negative when it cannot run it at all. the type dominates so a discrete
+// gpu wins over an integrated one and anything wins over a cpu implementation, then device-local memory,
+// compute queues, a transfer queue, subgroup width and the optional features the config asks for
+double scoreDevice(vk::PhysicalDevice device, const EngineConfig& config) {
+    vk::PhysicalDeviceProperties properties = device.getProperties();
+    if (properties.apiVersion < VK_API_VERSION_1_3) {
+        return -1.0;
+    }
+
+    // the engine uses the first family with compute, a copy-only family is its transfer queue
+    std::vector<vk::QueueFamilyProperties> families = device.getQueueFamilyProperties();
+    auto compute = std::ranges::find_if(families, [](const vk::QueueFamilyProperties& family) {
+        return bool(family.queueFlags & vk::QueueFlagBits::eCompute);
+    });
+    if (compute == families.end()) {
+        return -1.0;
+    }
+    bool transfer = std::ranges::any_of(families, [](const vk::QueueFamilyProperties& family) {
+        return (family.queueFlags & vk::QueueFlagBits::eTransfer) &&
+               !(family.queueFlags & (vk::QueueFlagBits::eCompute | vk::QueueFlagBits::eGraphics));
+    });
+
+    vk::PhysicalDeviceMemoryProperties memory = device.getMemoryProperties();
+    vk::DeviceSize deviceLocal = 0;
+    for (uint32_t i = 0; i < memory.memoryHeapCount; i++) {
+        if (memory.memoryHeaps[i].flags & vk::MemoryHeapFlagBits::eDeviceLocal) {
+            deviceLocal = std::max(deviceLocal, memory.memoryHeaps[i].size);
+        }
+    }
+
+    auto subgroup = device.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceSubgroupProperties>();
+    auto features = device.getFeatures2<vk::PhysicalDeviceFeatures2,
+                                        vk::PhysicalDeviceVulkan11Features,
+                                        vk::PhysicalDeviceVulkan12Features>();
+
+    double score = 0.0;
+    switch (properties.deviceType) {
+        case vk::PhysicalDeviceType::eDiscreteGpu:
+            score += 10000.0;
+            break;
+        case vk::PhysicalDeviceType::eIntegratedGpu:
+            score += 5000.0;
+            break;
+        case vk::PhysicalDeviceType::eVirtualGpu:
+            score += 2000.0;
+            break;
+        default:
+            break;
+    }
+    score += 100.0 * double(deviceLocal >> 30);
+    score += 50.0 * double(std::min(compute->queueCount, 8u));
+    score += transfer ? 100.0 : 0.0;
+    score += 10.0 * double(subgroup.get<vk::PhysicalDeviceSubgroupProperties>().subgroupSize);
+    if (config.Float16 && features.get<vk::PhysicalDeviceVulkan11Features>().storageBuffer16BitAccess) {
+        score += 500.0;
+    }
+    if (config.Int8 && features.get<vk::PhysicalDeviceVulkan12Features>().storageBuffer8BitAccess) {
+        score += 500.0;
+    }
+    return score;
+}
+
+bool hasLayer(const char* name) {
+    std::vector<vk::LayerProperties> layers = vk::enumerateInstanceLayerProperties();
+    return std::ranges::any_of(layers, [&](const vk::LayerProperties& layer) {
+        return std::strcmp(layer.layerName.data(), name) == 0;
+    });
+}
+
+bool hasInstanceExtension(const char* name) {
+    std::vector<vk::ExtensionProperties> extensions = vk::enumerateInstanceExtensionProperties();
+    return std::ranges::any_of(extensions, [&](const vk::ExtensionProperties& extension) {
+        return std::strcmp(extension.extensionName.data(), name) == 0;
+    });
+}
+
+} // namespace
+
+ComputeEngine::ComputeEngine(const EngineConfig& config) {
+    auto start = Clock::now();
+
     //--- Application
     vk::ApplicationInfo applicationInfo = {
         .sType = vk::StructureType::eApplicationInfo,
         .pNext = nullptr,
         .pApplicationName = "Neural Netword In A Weekend",
-        .applicationVersion = VK_VERSION_1_3,
+        .applicationVersion = VK_API_VERSION_1_3,
         .pEngineName = "No Engine",
-        .engineVersion = VK_VERSION_1_3,
-        .apiVersion = VK_VERSION_1_3,
+        .engineVersion = VK_API_VERSION_1_3,
+        .apiVersion = VK_API_VERSION_1_3,
     };
 
     //--- Debug
@@ -55,28 +148,50 @@ ComputeEngine::ComputeEngine() {
     };
 
     //--- Instance
+    // release builds run without layers, a debug build on a machine without the sdk still starts
+    bool validation = config.Validation && std::ranges::all_of(m_ValidationLayers, hasLayer);
+    if (config.Validation && !validation) {
+        LogWarning("validation layers are not installed, running without them");
+    }
+    bool debugUtils = validation && std::ranges::all_of(m_Extensions, hasInstanceExtension);
+
     vk::InstanceCreateInfo instanceCreateInfo = {
         .sType = vk::StructureType::eInstanceCreateInfo,
-        .pNext = &debugUtilsMessengerCreateInfo,
+        .pNext = debugUtils ? &debugUtilsMessengerCreateInfo : nullptr,
         .flags = {},
         .pApplicationInfo = &applicationInfo,
-        .enabledLayerCount = static_cast<uint32_t>(m_ValidationLayers.size()),
-        .ppEnabledLayerNames = m_ValidationLayers.data(),
-        .enabledExtensionCount = 0,
-        .ppEnabledExtensionNames = nullptr,
+        .enabledLayerCount = validation ? static_cast<uint32_t>(m_ValidationLayers.size()) : 0,
+        .ppEnabledLayerNames = validation ? m_ValidationLayers.data() : nullptr,
+        .enabledExtensionCount = debugUtils ? static_cast<uint32_t>(m_Extensions.size()) : 0,
+        .ppEnabledExtensionNames = debugUtils ? m_Extensions.data() : nullptr,
     };
 
     m_Instance = vk::createInstanceUnique(instanceCreateInfo);
+    m_Timings.InstanceSeconds = secondsSince(start);
+    auto deviceStart = Clock::now();
 
     //--- Physical Device Selection
     std::vector<vk::PhysicalDevice> devices = m_Instance->enumeratePhysicalDevices();
+    if (devices.empty()) {
+        throw std::runtime_error("no Vulkan device available");
+    }
 
-    auto it = std::ranges::find_if(devices, [](const vk::PhysicalDevice& device) {
-        vk::PhysicalDeviceProperties deviceProperties = device.getProperties();
-        return deviceProperties.deviceType == vk::PhysicalDeviceType::eDiscreteGpu;
-    });
+    double bestScore = -1.0;
+    for (const vk::PhysicalDevice& device : devices) {
+        std::string name = device.getProperties().deviceName.data();
+        double score = scoreDevice(device, config);
+        LogInfo("device", name, "scores", score);
 
-    m_PhyscialDevice = it != devices.end() ? *it : devices.front();
+        bool named = config.Device.empty() || name.find(config.Device) != std::string::npos;
+        if (named && score > bestScore) {
+            m_PhyscialDevice = device;
+            bestScore = score;
+        }
+    }
+    if (!m_PhyscialDevice) {
+        throw std::runtime_error(config.Device.empty() ? "no Vulkan 1.3 device with a compute queue"
+                                                       : "no usable Vulkan device named like " + config.Device);
+    }
 
     //--- Compute Queue Query
     std::vector<vk::QueueFamilyProperties> queueFamilyProperties = m_PhyscialDevice.getQueueFamilyProperties();
@@ -88,42 +203,758 @@ ComputeEngine::ComputeEngine() {
         i++;
     }
 
-    uint32_t m_ComputeQueueIndex = i;
+    m_ComputeQueueIndex = i;
+    m_ComputeQueueCount = queueFamilyProperties[m_ComputeQueueIndex].queueCount;
+    if (config.MaxComputeQueues) {
+        m_ComputeQueueCount = std::min(m_ComputeQueueCount, config.MaxComputeQueues);
+    }
+
+    // a family that can only copy is usually a dma engine that runs alongside the compute units
+    std::optional<uint32_t> transferFamily;
+    for (uint32_t family = 0; family < queueFamilyProperties.size(); family++) {
+        vk::QueueFlags flags = queueFamilyProperties[family].queueFlags;
+        if ((flags & vk::QueueFlagBits::eTransfer) &&
+            !(flags & (vk::QueueFlagBits::eCompute | vk::QueueFlagBits::eGraphics))) {
+            transferFamily = family;
+            break;
+        }
+    }
 
     //--- Device Queue(s)
-    float queuePriority = 1.0f;
-    vk::DeviceQueueCreateInfo deviceQueueCreateInfo ={
-        .sType = vk::StructureType::eDeviceQueueCreateInfo,
+    std::vector<float> queuePriorities(m_ComputeQueueCount, 1.0f);
+    std::vector<vk::DeviceQueueCreateInfo> deviceQueueCreateInfos = {
+        {
+            .sType = vk::StructureType::eDeviceQueueCreateInfo,
+            .pNext = nullptr,
+            .flags = {},
+            .queueFamilyIndex = m_ComputeQueueIndex,
+            .queueCount = m_ComputeQueueCount,
+            .pQueuePriorities = queuePriorities.data(),
+        },
+    };
+    if (transferFamily) {
+        deviceQueueCreateInfos.push_back({
+            .sType = vk::StructureType::eDeviceQueueCreateInfo,
+            .pNext = nullptr,
+            .flags = {},
+            .queueFamilyIndex = *transferFamily,
+            .queueCount = 1,
+            .pQueuePriorities = queuePriorities.data(),
+        });
+    }
+
+    //--- Features
+    // the 16 and 8 bit storage and arithmetic extensions are core since 1.1 and 1.2, only the features need enabling
+    auto supported = m_PhyscialDevice.getFeatures2<vk::PhysicalDeviceFeatures2,
+                                                   vk::PhysicalDeviceVulkan11Features,
+                                                   vk::PhysicalDeviceVulkan12Features>();
+    const auto& supported11 = supported.get<vk::PhysicalDeviceVulkan11Features>();
+    const auto& supported12 = supported.get<vk::PhysicalDeviceVulkan12Features>();
+
+    m_Float16 = config.Float16 && supported11.storageBuffer16BitAccess;
+    m_Int8 = config.Int8 && supported12.storageBuffer8BitAccess;
+    if (config.Float16 && !m_Float16) {
+        LogWarning("device lacks 16-bit storage buffers, fp16 kernels disabled");
+    }
+    if (config.Int8 && !m_Int8) {
+        LogWarning("device lacks 8-bit storage buffers, int8 kernels disabled");
+    }
+
+    vk::PhysicalDeviceVulkan11Features vulkan11Features = {
+        .sType = vk::StructureType::ePhysicalDeviceVulkan11Features,
         .pNext = nullptr,
-        .flags = {},
-        .queueFamilyIndex = m_ComputeQueueIndex,
-        .queueCount = 1,
-        .pQueuePriorities = &queuePriority,
+        .storageBuffer16BitAccess = m_Float16,
     };
 
+    // the kernels only load and store reduced precision, the arithmetic features are enabled when present
+    vk::PhysicalDeviceVulkan12Features vulkan12Features = {
+        .sType = vk::StructureType::ePhysicalDeviceVulkan12Features,
+        .pNext = &vulkan11Features,
+        .storageBuffer8BitAccess = m_Int8,
+        .shaderFloat16 = m_Float16 && supported12.shaderFloat16,
+        .shaderInt8 = m_Int8 && supported12.shaderInt8,
+        .timelineSemaphore = VK_TRUE,
+    };
+
+    // core since 1.1, only which operations and stages a device supports varies
+    auto subgroup = m_PhyscialDevice.getProperties2<vk::PhysicalDeviceProperties2,
+                                                    vk::PhysicalDeviceSubgroupProperties>();
+    const auto& subgroupProperties = subgroup.get<vk::PhysicalDeviceSubgroupProperties>();
+    m_SubgroupSize = subgroupProperties.subgroupSize;
+    m_SubgroupArithmetic =
+        (subgroupProperties.supportedStages & vk::ShaderStageFlagBits::eCompute) &&
+        (subgroupProperties.supportedOperations & vk::SubgroupFeatureFlagBits::eBasic) &&
+        (subgroupProperties.supportedOperations & vk::SubgroupFeatureFlagBits::eArithmetic);
+
+    //--- Extensions
+    // importing host pointers lets model files be copied by the device straight out of their mapping
+    std::vector<const char*> deviceExtensions;
+    if (config.ImportHostMemory) {
+        std::vector<vk::ExtensionProperties> extensions = m_PhyscialDevice.enumerateDeviceExtensionProperties();
+        bool hasHostImport = std::ranges::any_of(extensions, [](const vk::ExtensionProperties& extension) {
+            return std::strcmp(extension.extensionName.data(), VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME) == 0;
+        });
+        if (hasHostImport) {
+            auto properties = m_PhyscialDevice.getProperties2<vk::PhysicalDeviceProperties2,
+                                                              vk::PhysicalDeviceExternalMemoryHostPropertiesEXT>();
+            m_HostImportAlignment =
+                properties.get<vk::PhysicalDeviceExternalMemoryHostPropertiesEXT>().minImportedHostPointerAlignment;
+            deviceExtensions.push_back(VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME);
+        }
+    }
+
     //--- Device
     vk::DeviceCreateInfo deviceCreateInfo = {
         .sType = vk::StructureType::eDeviceCreateInfo,
-        .pNext = nullptr,
+        .pNext = &vulkan12Features,
         .flags = {},
-        .queueCreateInfoCount = 1,
-        .pQueueCreateInfos = &deviceQueueCreateInfo,
+        .queueCreateInfoCount = static_cast<uint32_t>(deviceQueueCreateInfos.size()),
+        .pQueueCreateInfos = deviceQueueCreateInfos.data(),
         .enabledLayerCount = 0,
         .ppEnabledLayerNames = nullptr,
-        .enabledExtensionCount = 0,
-        .ppEnabledExtensionNames = nullptr,
+        .enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size()),
+        .ppEnabledExtensionNames = deviceExtensions.data(),
         .pEnabledFeatures = nullptr,
     };
 
     m_Device = m_PhyscialDevice.createDeviceUnique(deviceCreateInfo);
+    m_Timings.DeviceSeconds = secondsSince(deviceStart);
+    auto setupStart = Clock::now();
+    if (m_HostImportAlignment) {
+        m_GetHostPointerProperties = reinterpret_cast<PFN_vkGetMemoryHostPointerPropertiesEXT>(
+            m_Device->getProcAddr("vkGetMemoryHostPointerPropertiesEXT"));
+        if (!m_GetHostPointerProperties) {
+            m_HostImportAlignment = 0;
+        }
+    }
+
+    //--- Memory
+    m_Allocator = std::make_unique<DeviceAllocator>(*m_Device, m_PhyscialDevice);
+
+    //--- Pipelines
+    m_Pipelines = std::make_unique<PipelineLibrary>(*m_Device, m_PhyscialDevice, config.PipelineCachePath);
+    m_Descriptors = std::make_unique<DescriptorAllocator>(*m_Device);
+
+    //--- Profiling
+    m_Profiler =
+        std::make_unique<GpuProfiler>(*m_Device, m_PhyscialDevice, m_ComputeQueueIndex, config.ProfilerQueries);
+
+    //--- Submission
+    m_CommandPools = std::make_unique<CommandPoolCache>(*m_Device);
+
+    auto addQueue = [&](uint32_t family, uint32_t index, vk::PipelineStageFlags waitStages) {
+        vk::SemaphoreTypeCreateInfo semaphoreTypeCreateInfo = {
+            .sType = vk::StructureType::eSemaphoreTypeCreateInfo,
+            .pNext = nullptr,
+            .semaphoreType = vk::SemaphoreType::eTimeline,
+            .initialValue = 0,
+        };
+        vk::SemaphoreCreateInfo semaphoreCreateInfo = {
+            .sType = vk::StructureType::eSemaphoreCreateInfo,
+            .pNext = &semaphoreTypeCreateInfo,
+            .flags = {},
+        };
+
+        // one timeline per queue, queues finish out of order and a timeline may only move forward
+        m_Queues.push_back({
+            .Queue = m_Device->getQueue(family, index),
+            .Family = family,
+            .WaitStages = waitStages,
+            .Timeline = m_Device->createSemaphoreUnique(semaphoreCreateInfo),
+            .Value = 0,
+            .Submissions = {},
+        });
+    };
+
+    for (uint32_t index = 0; index < m_ComputeQueueCount; index++) {
+        addQueue(m_ComputeQueueIndex,
+                 index,
+                 vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer);
+    }
+    m_QueueFamilies = {m_ComputeQueueIndex};
+    if (transferFamily) {
+        m_TransferQueue = uint32_t(m_Queues.size());
+        addQueue(*transferFamily, 0, vk::PipelineStageFlagBits::eTransfer);
+        m_QueueFamilies.push_back(*transferFamily);
+    }
+    m_QueueLocks = std::vector<std::mutex>(m_Queues.size());
+
+    //--- Staging
+    m_Staging = std::make_unique<StagingRing>(CreateBuffer(config.StagingSize, 1, MemoryUsage::eHostVisible));
+
+    // the pipeline cache load is counted by the library
+    m_Timings.SetupSeconds = secondsSince(setupStart) - m_Pipelines->CreationSeconds();
+    EngineTimings timings = Timings();
+    LogInfo("engine on",
+            m_PhyscialDevice.getProperties().deviceName.data(),
+            "ready in",
+            secondsSince(start) * 1000.0,
+            "ms: instance",
+            timings.InstanceSeconds * 1000.0,
+            "device",
+            timings.DeviceSeconds * 1000.0,
+            "setup",
+            timings.SetupSeconds * 1000.0,
+            "pipeline cache",
+            timings.PipelineSeconds * 1000.0);
+}
+
+EngineTimings ComputeEngine::Timings() const {
+    EngineTimings timings = m_Timings;
+    timings.PipelineSeconds = m_Pipelines->CreationSeconds();
+    return timings;
+}
+
+ComputeEngine::~ComputeEngine() {
+    if (m_Device) {
+        m_Device->waitIdle();
+    }
 }
 
 void ComputeEngine::ExecuteTasks() {
-    while (!m_TaskQueue.empty()) {
-        auto& task = m_TaskQueue.front();
-        m_TaskQueue.pop();
-        task->Execute(*this);
+    Wait(ExecuteTasksAsync());
+}
+
+std::shared_ptr<Buffer> ComputeEngine::CreateBuffer(size_t count, size_t size, MemoryUsage usage) const {
+    auto buffer = std::make_shared<Buffer>();
+    buffer->Size = uint32_t(size);
+    buffer->Count = uint32_t(count);
+    buffer->Handle = createBufferHandle(buffer->Range());
+    buffer->Memory = m_Allocator->Allocate(m_Device->getBufferMemoryRequirements(*buffer->Handle), usage);
+    m_Device->bindBufferMemory(*buffer->Handle, buffer->Memory.Memory(), buffer->Memory.Offset());
+
+    return buffer;
+}
+
+std::shared_ptr<Allocation> ComputeEngine::CreateArena(vk::DeviceSize size) const {
+    // buffers with the same usage share memory type bits and alignment, one of the arena's size stands for all
+    vk::UniqueBuffer buffer = createBufferHandle(size);
+    return std::make_shared<Allocation>(
+        m_Allocator->Allocate(m_Device->getBufferMemoryRequirements(*buffer), MemoryUsage::eDeviceLocal));
+}
+
+std::shared_ptr<Buffer> ComputeEngine::CreateBuffer(size_t count,
+                                                    size_t size,
+                                                    std::shared_ptr<Allocation> arena,
+                                                    vk::DeviceSize offset) const {
+    auto buffer = std::make_shared<Buffer>();
+    buffer->Size = uint32_t(size);
+    buffer->Count = uint32_t(count);
+    buffer->Handle = createBufferHandle(buffer->Range());
+
+    vk::MemoryRequirements requirements = m_Device->getBufferMemoryRequirements(*buffer->Handle);
+    if (offset % requirements.alignment != 0 || offset + requirements.size > arena->Size()) {
+        throw std::runtime_error("buffer does not fit the arena at the given offset");
+    }
+    m_Device->bindBufferMemory(*buffer->Handle, arena->Memory(), arena->Offset() + offset);
+    buffer->Arena = std::move(arena);
+    buffer->ArenaOffset = offset;
+
+    return buffer;
+}
+
+vk::DeviceSize ComputeEngine::ArenaAlignment() const {
+    return m_Device->getBufferMemoryRequirements(*createBufferHandle(1)).alignment;
+}
+
+vk::UniqueBuffer ComputeEngine::createBufferHandle(vk::DeviceSize size) const {
+    vk::BufferCreateInfo bufferCreateInfo = {
+        .sType = vk::StructureType::eBufferCreateInfo,
+        .pNext = nullptr,
+        .flags = {},
+        .size = size,
+        .usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc |
+                 vk::BufferUsageFlagBits::eTransferDst,
+        // concurrent when the transfer queue is a separate family, saves ownership transfers on every copy
+        .sharingMode = m_QueueFamilies.size() > 1 ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive,
+        .queueFamilyIndexCount = static_cast<uint32_t>(m_QueueFamilies.size()),
+        .pQueueFamilyIndices = m_QueueFamilies.data(),
+    };
+
+    return m_Device->createBufferUnique(bufferCreateInfo);
+}
+
+SubmitHandle ComputeEngine::ExecuteTasksAsync() {
+    TaskGraph graph;
+    {
+        std::lock_guard lock(m_DrainMutex);
+        while (std::optional<std::shared_ptr<Task>> task = m_TaskQueue.Pop()) {
+            graph.Add(std::move(*task));
+        }
+    }
+
+    // components are placed by their index in this call, so a task may land on another queue than the one an
+    // earlier call left its writes running on. every submission waits for what the other queues held before
+    // this call, the components of one call share no buffers and still overlap
+    std::vector<SubmitHandle> earlier;
+    for (uint32_t queue = 0; queue < m_ComputeQueueCount; queue++) {
+        earlier.push_back(lastSubmission(queue));
+    }
+
+    std::vector<TaskGraph> components = graph.Components();
+    if (components.size() <= 1 || m_ComputeQueueCount == 1) {
+        return ExecuteGraph(graph, 0, earlier);
+    }
+
+    std::vector<SubmitHandle> handles;
+    for (uint32_t stream = 0; stream < components.size(); stream++) {
+        handles.push_back(ExecuteGraph(components[stream], stream, earlier));
+    }
+
+    // an empty submission on queue 0 that waits for every component gives the caller one handle to wait on
+    return submit(0, beginCommands(0), {}, handles);
+}
+
+SubmitHandle ComputeEngine::ExecuteGraph(const TaskGraph& graph, uint32_t stream, std::vector<SubmitHandle> after) {
+    retire();
+
+    uint32_t queue = stream % m_ComputeQueueCount;
+    if (graph.Empty()) {
+        return lastSubmission(queue);
+    }
+
+    std::vector<std::shared_ptr<Task>> tasks;
+    for (const auto& node : graph.m_Nodes) {
+        tasks.push_back(node.Task);
+    }
+
+    vk::MemoryBarrier hostBarrier = {
+        .sType = vk::StructureType::eMemoryBarrier,
+        .pNext = nullptr,
+        .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+        .dstAccessMask = vk::AccessFlagBits::eHostRead,
+    };
+
+    // the graph only tracks hazards between its own tasks, earlier submissions may still be
+    // writing what the first level reads, e.g. the previous training step's weight update
+    vk::MemoryBarrier submissionBarrier = {
+        .sType = vk::StructureType::eMemoryBarrier,
+        .pNext = nullptr,
+        .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+        .dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+    };
+
+    std::unique_ptr<CommandContext> commands = beginCommands(queue);
+    vk::CommandBuffer commandBuffer = *commands->CommandBuffer;
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                                  vk::PipelineStageFlagBits::eComputeShader,
+                                  {},
+                                  {submissionBarrier},
+                                  {},
+                                  {});
+    graph.Record(commandBuffer);
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eHost, {}, {hostBarrier}, {}, {});
+
+    after.push_back({m_TransferQueue, m_UploadValue.load()});
+    return submit(queue, std::move(commands), std::move(tasks), after);
+}
+
+SubmitHandle ComputeEngine::Upload(const Buffer& dst, const void* data, vk::DeviceSize size, vk::DeviceSize offset) {
+    if (char* mapped = (char*)dst.Memory.Mapped()) {
+        std::memcpy(mapped + offset, data, size);
+        return {};
+    }
+
+    // transfers larger than the ring go through it in chunks, one submission each
+    std::lock_guard lock(m_StagingMutex);
+    SubmitHandle handle = {};
+    vk::DeviceSize chunkSize = m_Staging->Capacity() / 4;
+    for (vk::DeviceSize done = 0; done < size; done += chunkSize) {
+        vk::DeviceSize bytes = std::min(chunkSize, size - done);
+        vk::DeviceSize stagingOffset = allocateStaging(bytes);
+        std::memcpy(m_Staging->Mapped(stagingOffset), (const char*)data + done, bytes);
+
+        vk::BufferCopy region = {
+            .srcOffset = stagingOffset,
+            .dstOffset = offset + done,
+            .size = bytes,
+        };
+
+        std::unique_ptr<CommandContext> commands = beginCommands(m_TransferQueue);
+        vk::CommandBuffer commandBuffer = *commands->CommandBuffer;
+        commandBuffer.copyBuffer(*m_Staging->Storage().Handle, *dst.Handle, {region});
+        // a dedicated transfer queue cannot name compute stages, the compute side's semaphore wait covers it
+        if (!HasTransferQueue()) {
+            vk::MemoryBarrier transferBarrier = {
+                .sType = vk::StructureType::eMemoryBarrier,
+                .pNext = nullptr,
+                .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+                .dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+            };
+            commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                          vk::PipelineStageFlagBits::eComputeShader,
+                                          {},
+                                          {transferBarrier},
+                                          {},
+                                          {});
+        }
+        handle = submit(m_TransferQueue, std::move(commands), {});
+        m_Staging->Submitted(handle.Value);
+        m_UploadValue = handle.Value;
+    }
+
+    return handle;
+}
+
+SubmitHandle ComputeEngine::Copy(const Buffer& src,
+                                 const Buffer& dst,
+                                 vk::DeviceSize size,
+                                 vk::DeviceSize srcOffset,
+                                 vk::DeviceSize dstOffset) {
+    vk::BufferCopy region = {
+        .srcOffset = srcOffset,
+        .dstOffset = dstOffset,
+        .size = size,
+    };
+
+    // the staging lock keeps the upload value increasing, copies and uploads share it
+    std::lock_guard lock(m_StagingMutex);
+    std::unique_ptr<CommandContext> commands = beginCommands(m_TransferQueue);
+    vk::CommandBuffer commandBuffer = *commands->CommandBuffer;
+    commandBuffer.copyBuffer(*src.Handle, *dst.Handle, {region});
+    if (!HasTransferQueue()) {
+        vk::MemoryBarrier transferBarrier = {
+            .sType = vk::StructureType::eMemoryBarrier,
+            .pNext = nullptr,
+            .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+            .dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+        };
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                      vk::PipelineStageFlagBits::eComputeShader,
+                                      {},
+                                      {transferBarrier},
+                                      {},
+                                      {});
+    }
+    SubmitHandle handle = submit(m_TransferQueue, std::move(commands), {});
+    m_UploadValue = handle.Value;
+    return handle;
+}
+
+std::shared_ptr<Buffer> ComputeEngine::ImportHostMemory(const void* data, vk::DeviceSize size) const {
+    if (!m_HostImportAlignment || size == 0 || size > UINT32_MAX || uintptr_t(data) % m_HostImportAlignment != 0 ||
+        size % m_HostImportAlignment != 0) {
+        return nullptr;
+    }
+
+    // the device only ever reads the memory, the pointer is non-const in the api alone
+    void* hostPointer = const_cast<void*>(data);
+    // called through the c api, the function pointer was loaded by hand
+    VkMemoryHostPointerPropertiesEXT hostPointerProperties = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_HOST_POINTER_PROPERTIES_EXT,
+        .pNext = nullptr,
+        .memoryTypeBits = 0,
+    };
+    VkResult result = m_GetHostPointerProperties(static_cast<VkDevice>(*m_Device),
+                                                 VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT,
+                                                 hostPointer,
+                                                 &hostPointerProperties);
+    if (result != VK_SUCCESS) {
+        return nullptr;
+    }
+
+    vk::ExternalMemoryBufferCreateInfo externalMemoryBufferCreateInfo = {
+        .sType = vk::StructureType::eExternalMemoryBufferCreateInfo,
+        .pNext = nullptr,
+        .handleTypes = vk::ExternalMemoryHandleTypeFlagBits::eHostAllocationEXT,
+    };
+
+    vk::BufferCreateInfo bufferCreateInfo = {
+        .sType = vk::StructureType::eBufferCreateInfo,
+        .pNext = &externalMemoryBufferCreateInfo,
+        .flags = {},
+        .size = size,
+        .usage = vk::BufferUsageFlagBits::eTransferSrc,
+        .sharingMode = m_QueueFamilies.size() > 1 ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive,
+        .queueFamilyIndexCount = static_cast<uint32_t>(m_QueueFamilies.size()),
+        .pQueueFamilyIndices = m_QueueFamilies.data(),
+    };
+
+    auto buffer = std::make_shared<Buffer>();
+    buffer->Size = 1;
+    buffer->Count = uint32_t(size);
+    buffer->Handle = m_Device->createBufferUnique(bufferCreateInfo);
+
+    vk::MemoryRequirements requirements = m_Device->getBufferMemoryRequirements(*buffer->Handle);
+    uint32_t typeBits = requirements.memoryTypeBits & hostPointerProperties.memoryTypeBits;
+    if (typeBits == 0 || requirements.size > size) {
+        return nullptr;
+    }
+
+    vk::ImportMemoryHostPointerInfoEXT importMemoryHostPointerInfo = {
+        .sType = vk::StructureType::eImportMemoryHostPointerInfoEXT,
+        .pNext = nullptr,
+        .handleType = vk::ExternalMemoryHandleTypeFlagBits::eHostAllocationEXT,
+        .pHostPointer = hostPointer,
+    };
+
+    vk::MemoryAllocateInfo memoryAllocateInfo = {
+        .sType = vk::StructureType::eMemoryAllocateInfo,
+        .pNext = &importMemoryHostPointerInfo,
+        .allocationSize = size,
+        .memoryTypeIndex = uint32_t(std::countr_zero(typeBits)),
+    };
+
+    // some drivers only import anonymous memory and refuse file mappings, which is not an error for the caller
+    try {
+        buffer->Imported = m_Device->allocateMemoryUnique(memoryAllocateInfo);
+    } catch (const vk::SystemError& e) {
+        LogWarning("host memory import failed:", e.what());
+        return nullptr;
+    }
+    m_Device->bindBufferMemory(*buffer->Handle, *buffer->Imported, 0);
+
+    return buffer;
+}
+
+void ComputeEngine::Download(const Buffer& src, void* data, vk::DeviceSize size, vk::DeviceSize offset) {
+    // whatever the compute queues have submitted may be writing src, mapped or not
+    std::vector<SubmitHandle> writers;
+    for (uint32_t queue = 0; queue < m_ComputeQueueCount; queue++) {
+        writers.push_back(lastSubmission(queue));
+    }
+
+    // mapped memory is always coherent, once the writers and any copy into src are done the bytes are there
+    if (const char* mapped = (const char*)src.Memory.Mapped()) {
+        writers.push_back({m_TransferQueue, m_UploadValue.load()});
+        for (SubmitHandle writer : writers) {
+            Wait(writer);
+        }
+        std::memcpy(data, mapped + offset, size);
+        return;
+    }
+
+    std::lock_guard lock(m_StagingMutex);
+    vk::DeviceSize chunkSize = m_Staging->Capacity() / 4;
+    for (vk::DeviceSize done = 0; done < size; done += chunkSize) {
+        vk::DeviceSize bytes = std::min(chunkSize, size - done);
+        vk::DeviceSize stagingOffset = allocateStaging(bytes);
+
+        vk::BufferCopy region = {
+            .srcOffset = offset + done,
+            .dstOffset = stagingOffset,
+            .size = bytes,
+        };
+
+        vk::MemoryBarrier hostBarrier = {
+            .sType = vk::StructureType::eMemoryBarrier,
+            .pNext = nullptr,
+            .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+            .dstAccessMask = vk::AccessFlagBits::eHostRead,
+        };
+
+        std::unique_ptr<CommandContext> commands = beginCommands(m_TransferQueue);
+        vk::CommandBuffer commandBuffer = *commands->CommandBuffer;
+        if (!HasTransferQueue()) {
+            vk::MemoryBarrier computeBarrier = {
+                .sType = vk::StructureType::eMemoryBarrier,
+                .pNext = nullptr,
+                .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+                .dstAccessMask = vk::AccessFlagBits::eTransferRead,
+            };
+            commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                                          vk::PipelineStageFlagBits::eTransfer,
+                                          {},
+                                          {computeBarrier},
+                                          {},
+                                          {});
+        }
+        commandBuffer.copyBuffer(*src.Handle, *m_Staging->Storage().Handle, {region});
+        commandBuffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, {}, {hostBarrier}, {}, {});
+
+        SubmitHandle handle = submit(m_TransferQueue, std::move(commands), {}, writers);
+        m_Staging->Submitted(handle.Value);
+        Wait(handle);
+        std::memcpy((char*)data + done, m_Staging->Mapped(stagingOffset), bytes);
+    }
+}
+
+vk::DeviceSize ComputeEngine::allocateStaging(vk::DeviceSize size) {
+    // called with the staging lock held
+    auto release = [&] {
+        m_Staging->Release(m_Device->getSemaphoreCounterValue(*m_Queues[m_TransferQueue].Timeline));
+    };
+
+    release();
+    std::optional<vk::DeviceSize> offset = m_Staging->Allocate(size);
+    while (!offset && m_Staging->HasInFlight()) {
+        // the ring is full of data the device still reads, wait for the oldest submission to free some
+        Wait({m_TransferQueue, m_Staging->OldestValue()});
+        release();
+        offset = m_Staging->Allocate(size);
+    }
+    if (!offset) {
+        throw std::runtime_error("staging ring cannot hold the requested transfer");
+    }
+    return *offset;
+}
+
+std::unique_ptr<CommandContext> ComputeEngine::beginCommands(uint32_t queue) {
+    std::unique_ptr<CommandContext> commands = m_CommandPools->Acquire(m_Queues[queue].Family);
+
+    vk::CommandBufferBeginInfo commandBufferBeginInfo = {
+        .sType = vk::StructureType::eCommandBufferBeginInfo,
+        .pNext = nullptr,
+        .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
+        .pInheritanceInfo = nullptr,
+    };
+
+    commands->CommandBuffer->begin(commandBufferBeginInfo);
+    return commands;
+}
+
+SubmitHandle ComputeEngine::submit(uint32_t queue,
+                                   std::unique_ptr<CommandContext> commands,
+                                   std::vector<std::shared_ptr<Task>> tasks,
+                                   const std::vector<SubmitHandle>& waits) {
+    commands->CommandBuffer->end();
+
+    QueueContext& context = m_Queues[queue];
+
+    // waiting on our own queue or on work that already finished is redundant
+    std::vector<vk::Semaphore> waitSemaphores;
+    std::vector<uint64_t> waitValues;
+    std::vector<vk::PipelineStageFlags> waitStages;
+    for (const SubmitHandle& wait : waits) {
+        if (wait.Queue != queue && wait.Value > 0 && !IsComplete(wait)) {
+            waitSemaphores.push_back(*m_Queues[wait.Queue].Timeline);
+            waitValues.push_back(wait.Value);
+            waitStages.push_back(context.WaitStages);
+        }
+    }
+
+    // values must reach the queue in increasing order, so the lock covers both
+    std::lock_guard lock(m_QueueLocks[queue]);
+    uint64_t value = ++context.Value;
+
+    vk::TimelineSemaphoreSubmitInfo timelineSubmitInfo = {
+        .sType = vk::StructureType::eTimelineSemaphoreSubmitInfo,
+        .pNext = nullptr,
+        .waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size()),
+        .pWaitSemaphoreValues = waitValues.data(),
+        .signalSemaphoreValueCount = 1,
+        .pSignalSemaphoreValues = &value,
+    };
+
+    vk::SubmitInfo submitInfo = {
+        .sType = vk::StructureType::eSubmitInfo,
+        .pNext = &timelineSubmitInfo,
+        .waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size()),
+        .pWaitSemaphores = waitSemaphores.data(),
+        .pWaitDstStageMask = waitStages.data(),
+        .commandBufferCount = 1,
+        .pCommandBuffers = &*commands->CommandBuffer,
+        .signalSemaphoreCount = 1,
+        .pSignalSemaphores = &*context.Timeline,
+    };
+
+    context.Queue.submit({submitInfo});
+    context.Submissions.push_back({
+        .Value = value,
+        .Commands = std::move(commands),
+        .Tasks = std::move(tasks),
+    });
+    return {queue, value};
+}
+
+SubmitHandle ComputeEngine::lastSubmission(uint32_t queue) const {
+    std::lock_guard lock(m_QueueLocks[queue]);
+    return {queue, m_Queues[queue].Value};
+}
+
+void ComputeEngine::Submit(vk::CommandBuffer commandBuffer, vk::Fence fence) const {
+    // queue 0's own earlier work is ordered by submission order and the barrier the commands begin with,
+    // the last upload and the other compute queues only through their timelines
+    std::vector<SubmitHandle> waits = {{m_TransferQueue, m_UploadValue.load()}};
+    for (uint32_t queue = 1; queue < m_ComputeQueueCount; queue++) {
+        waits.push_back(lastSubmission(queue));
+    }
+
+    std::vector<vk::Semaphore> waitSemaphores;
+    std::vector<uint64_t> waitValues;
+    std::vector<vk::PipelineStageFlags> waitStages;
+    for (const SubmitHandle& wait : waits) {
+        if (wait.Queue != 0 && wait.Value > 0 && !IsComplete(wait)) {
+            waitSemaphores.push_back(*m_Queues[wait.Queue].Timeline);
+            waitValues.push_back(wait.Value);
+            waitStages.push_back(m_Queues[0].WaitStages);
+        }
+    }
+
+    vk::TimelineSemaphoreSubmitInfo timelineSubmitInfo = {
+        .sType = vk::StructureType::eTimelineSemaphoreSubmitInfo,
+        .pNext = nullptr,
+        .waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size()),
+        .pWaitSemaphoreValues = waitValues.data(),
+        .signalSemaphoreValueCount = 0,
+        .pSignalSemaphoreValues = nullptr,
+    };
+
+    vk::SubmitInfo submitInfo = {
+        .sType = vk::StructureType::eSubmitInfo,
+        .pNext = &timelineSubmitInfo,
+        .waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size()),
+        .pWaitSemaphores = waitSemaphores.data(),
+        .pWaitDstStageMask = waitStages.data(),
+        .commandBufferCount = 1,
+        .pCommandBuffers = &commandBuffer,
+        .signalSemaphoreCount = 0,
+        .pSignalSemaphores = nullptr,
+    };
+
+    std::lock_guard lock(m_QueueLocks[0]);
+    m_Queues[0].Queue.submit({submitInfo}, fence);
+}
+
+bool ComputeEngine::IsComplete(SubmitHandle handle) const {
+    return m_Device->getSemaphoreCounterValue(*m_Queues[handle.Queue].Timeline) >= handle.Value;
+}
+
+void ComputeEngine::Wait(SubmitHandle handle) {
+    vk::SemaphoreWaitInfo semaphoreWaitInfo = {
+        .sType = vk::StructureType::eSemaphoreWaitInfo,
+        .pNext = nullptr,
+        .flags = {},
+        .semaphoreCount = 1,
+        .pSemaphores = &*m_Queues[handle.Queue].Timeline,
+        .pValues = &handle.Value,
+    };
+
+    vk::Result result = m_Device->waitSemaphores(semaphoreWaitInfo, UINT64_MAX);
+    if (result != vk::Result::eSuccess) {
+        LogWarning("timeline wait result error on line", __LINE__, __FILE__);
+    }
+
+    retire();
+}
+
+void ComputeEngine::retire() {
+    for (uint32_t queue = 0; queue < m_Queues.size(); queue++) {
+        QueueContext& context = m_Queues[queue];
+        uint64_t completed = m_Device->getSemaphoreCounterValue(*context.Timeline);
+
+        std::vector<InFlight> retired;
+        {
+            std::lock_guard lock(m_QueueLocks[queue]);
+            while (!context.Submissions.empty() && context.Submissions.front().Value <= completed) {
+                retired.push_back(std::move(context.Submissions.front()));
+                context.Submissions.pop_front();
+            }
+        }
+
+        for (InFlight& submission : retired) {
+            // a task recorded several times in one batch only keeps its last timestamps
+            std::unordered_set<Task*> collected;
+            for (const auto& task : submission.Tasks) {
+                if (collected.insert(task.get()).second) {
+                    task->collect();
+                }
+            }
+            m_CommandPools->Recycle(std::move(submission.Commands));
+        }
     }
 }
 
-} // namespace nn
\ No newline at end of file
+} // namespace nn
@@ -1,29 +1,197 @@
 #pragma once
 #define VULKAN_HPP_NO_STRUCT_CONSTRUCTORS 1
 #include <vulkan/vulkan.hpp>
-#include <queue>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <span>
+#include "Buffer.hpp"
+#include "CommandPoolCache.hpp"
+#include "DescriptorAllocator.hpp"
+#include "DeviceAllocator.hpp"
+#include "GpuProfiler.hpp"
+#include "MpscQueue.hpp"
+#include "PipelineLibrary.hpp"
+#include "StagingRing.hpp"
 #include "Task.hpp"
+#include "TaskGraph.hpp"
 
 namespace nn {
 
+#ifdef NDEBUG
+constexpr bool defaultValidation = false;
+#else
+constexpr bool defaultValidation = true;
+#endif
+
+struct EngineConfig {
+    // VK_LAYER_KHRONOS_validation with its messages logged, slows every call down. a missing layer only warns
+    bool Validation = defaultValidation;
+    // only devices whose name contains this are considered, e.g. "llvmpipe" for lavapipe, the best scoring otherwise
+    std::string Device = {};
+    std::string PipelineCachePath = "pipeline_cache.bin"; // empty disables the on-disk cache
+    uint32_t ProfilerQueries = 4096;                      // two per task, 0 disables GPU timestamps
+    size_t StagingSize = 64 << 20;                        // ring used for device-local uploads and readbacks
+    uint32_t MaxComputeQueues = 0;                        // 0 creates every queue the compute family offers
+    bool Float16 = false; // opt in to 16-bit storage buffers and shaderFloat16 where the device has them
+    bool Int8 = false;    // same for 8-bit storage buffers and shaderInt8
+    // enables VK_EXT_external_memory_host where the device has it, see ComputeEngine::ImportHostMemory
+    bool ImportHostMemory = true;
+};
+
+// wall time spent bringing the engine up, to keep an eye on cold starts
+struct EngineTimings {
+    double InstanceSeconds; // instance and layers
+    double DeviceSeconds;   // scoring the devices and creating the chosen one
+    double SetupSeconds;    // allocator, profiler, queues and staging
+    double PipelineSeconds; // loading the pipeline cache and every shader module and pipeline created so far
+};
+
+// a point on one queue's timeline semaphore, reached once the submission it names has finished
+struct SubmitHandle {
+    uint32_t Queue = 0; // compute queues first, then the transfer queue when the device has one
+    uint64_t Value = 0;
+};
+
+// tasks may be built, pushed and submitted from any number of threads. each queue is locked only around the
+// submission itself, and every recording takes a command pool no other thread is using
 class ComputeEngine {
 public:
-    ComputeEngine();
+    explicit ComputeEngine(const EngineConfig& config = {});
     ComputeEngine(const ComputeEngine&) = delete;
     void operator=(const ComputeEngine&) = delete;
+    ~ComputeEngine();
 
     vk::Device Device() const { return *m_Device; }
     vk::PhysicalDevice GPU() const { return m_PhyscialDevice; }
-    uint32_t ComputeQueue() const { return m_ComputeQueueIndex; }
-    void PushTask(std::shared_ptr<Task> task) { m_TaskQueue.push(task); }
+    uint32_t ComputeQueue() const { return m_ComputeQueueIndex; } // queue family
+    uint32_t ComputeQueueCount() const { return m_ComputeQueueCount; }
+    bool HasTransferQueue() const { return m_TransferQueue != 0; }
+    bool HasFloat16() const { return m_Float16; } // requested and supported
+    bool HasInt8() const { return m_Int8; }
+    // subgroup add, min and max in compute shaders, what the reduction kernels are built on
+    bool HasSubgroupArithmetic() const { return m_SubgroupArithmetic; }
+    uint32_t SubgroupSize() const { return m_SubgroupSize; }
+    vk::DeviceSize HostImportAlignment() const { return m_HostImportAlignment; } // 0 when imports are unsupported
+    DeviceAllocator& Allocator() const { return *m_Allocator; }
+    PipelineLibrary& Pipelines() const { return *m_Pipelines; }
+    DescriptorAllocator& Descriptors() const { return *m_Descriptors; }
+    GpuProfiler& Profiler() const { return *m_Profiler; }
+    CommandPoolCache& CommandPools() const { return *m_CommandPools; }
+    EngineTimings Timings() const;
+    std::shared_ptr<Buffer> CreateBuffer(size_t count, size_t size, MemoryUsage usage) const;
+
+    // device-local memory buffers are placed in at offsets the caller chooses, so that buffers never in use at
+    // the same time can share it, see MemoryPlanner. offsets must be multiples of ArenaAlignment()
+    std::shared_ptr<Allocation> CreateArena(vk::DeviceSize size) const;
+    std::shared_ptr<Buffer> CreateBuffer(size_t count,
+                                         size_t size,
+                                         std::shared_ptr<Allocation> arena,
+                                         vk::DeviceSize offset) const;
+    vk::DeviceSize ArenaAlignment() const;
+    void PushTask(std::shared_ptr<Task> task) { m_TaskQueue.Push(std::move(task)); }
     void ExecuteTasks();
 
+    // records every queued task and submits without waiting, tasks sharing no buffers spread across the queues.
+    // a call starts after everything earlier submitted to any compute queue. concurrent callers drain the queue
+    // one at a time, a task pushed meanwhile may go to the next call
+    SubmitHandle ExecuteTasksAsync();
+    // one command buffer with barriers only where the graph's buffer accesses demand them.
+    // submissions on the same stream run in order, streams map round-robin onto the compute queues and are
+    // only ordered against each other through the handles passed as after
+    SubmitHandle ExecuteGraph(const TaskGraph& graph, uint32_t stream = 0, std::vector<SubmitHandle> after = {});
+    bool IsComplete(SubmitHandle handle) const;
+    void Wait(SubmitHandle handle);
+
+    // submits to compute queue 0 under its lock, for work tracked by a fence rather than the timeline. ordered
+    // after the last upload and everything submitted to the other compute queues so far, like ExecuteGraph
+    void Submit(vk::CommandBuffer commandBuffer, vk::Fence fence) const;
+
+    // mapped buffers, which are always host coherent, are written in place, anything else goes through the
+    // staging ring on the transfer queue. either way the upload is ordered before every later submission but not
+    // after earlier ones, so a buffer that submitted work still reads must not be overwritten, double buffer
+    // inputs to overlap copies with compute
+    SubmitHandle Upload(const Buffer& dst, const void* data, vk::DeviceSize size, vk::DeviceSize offset = 0);
+    // blocks until everything submitted to the compute queues so far has finished, whether src is mapped and
+    // read in place or copied out through the staging ring
+    void Download(const Buffer& src, void* data, vk::DeviceSize size, vk::DeviceSize offset = 0);
+
+    // device-side copy on the transfer queue, ordered like an upload
+    SubmitHandle Copy(const Buffer& src,
+                      const Buffer& dst,
+                      vk::DeviceSize size,
+                      vk::DeviceSize srcOffset = 0,
+                      vk::DeviceSize dstOffset = 0);
+
+    // a transfer source bound directly to host memory, e.g. a mapped file, so the device reads it without a
+    // staging copy. data and size must be multiples of HostImportAlignment() and data must stay valid while the
+    // buffer lives. empty when the device or the driver refuses, callers fall back to Upload
+    std::shared_ptr<Buffer> ImportHostMemory(const void* data, vk::DeviceSize size) const;
+
+    template <typename T>
+    SubmitHandle Upload(const Buffer& dst, std::span<const T> data, vk::DeviceSize offset = 0) {
+        return Upload(dst, data.data(), data.size_bytes(), offset);
+    }
+
+    template <typename T>
+    void Download(const Buffer& src, std::span<T> data, vk::DeviceSize offset = 0) {
+        Download(src, data.data(), data.size_bytes(), offset);
+    }
+
 private:
-    std::queue<std::shared_ptr<Task>> m_TaskQueue;
+    vk::UniqueBuffer createBufferHandle(vk::DeviceSize size) const;
+    void retire();
+    std::unique_ptr<CommandContext> beginCommands(uint32_t queue);
+    SubmitHandle submit(uint32_t queue,
+                        std::unique_ptr<CommandContext> commands,
+                        std::vector<std::shared_ptr<Task>> tasks,
+                        const std::vector<SubmitHandle>& waits = {});
+    SubmitHandle lastSubmission(uint32_t queue) const;
+    vk::DeviceSize allocateStaging(vk::DeviceSize size);
+
+    struct InFlight {
+        uint64_t Value;
+        std::unique_ptr<CommandContext> Commands; // recycled once the value is reached
+        std::vector<std::shared_ptr<Task>> Tasks; // kept alive until the device is done with them
+    };
+
+    struct QueueContext {
+        vk::Queue Queue;
+        uint32_t Family;
+        vk::PipelineStageFlags WaitStages; // what submissions on this queue wait on other queues with
+        vk::UniqueSemaphore Timeline;
+        uint64_t Value = 0; // last value submitted
+        std::deque<InFlight> Submissions;
+    };
+
+    MpscQueue<std::shared_ptr<Task>> m_TaskQueue;
+    std::mutex m_DrainMutex; // the queue has a single consumer
     vk::UniqueInstance m_Instance;
     vk::PhysicalDevice m_PhyscialDevice;
     vk::UniqueDevice m_Device;
     uint32_t m_ComputeQueueIndex = 0;
+    uint32_t m_ComputeQueueCount = 1;
+    std::vector<uint32_t> m_QueueFamilies; // every family buffers are shared between
+    bool m_Float16 = false;
+    bool m_Int8 = false;
+    bool m_SubgroupArithmetic = false;
+    uint32_t m_SubgroupSize = 1;
+    vk::DeviceSize m_HostImportAlignment = 0;
+    PFN_vkGetMemoryHostPointerPropertiesEXT m_GetHostPointerProperties = nullptr; // not exported by the loader
+    std::unique_ptr<DeviceAllocator> m_Allocator;
+    std::unique_ptr<PipelineLibrary> m_Pipelines;
+    std::unique_ptr<DescriptorAllocator> m_Descriptors;
+    std::unique_ptr<GpuProfiler> m_Profiler;
+    std::unique_ptr<CommandPoolCache> m_CommandPools;
+
+    std::vector<QueueContext> m_Queues;
+    mutable std::vector<std::mutex> m_QueueLocks; // one per queue, guards its submissions and timeline value
+    uint32_t m_TransferQueue = 0;            // staging copies run here, compute queue 0 when there is no transfer queue
+    std::atomic<uint64_t> m_UploadValue = 0; // last upload, compute submissions wait for it
+    std::mutex m_StagingMutex;               // held for a whole upload or download
+    std::unique_ptr<StagingRing> m_Staging;
+    EngineTimings m_Timings = {};
 
     const std::vector<const char*> m_ValidationLayers = {
         "VK_LAYER_KHRONOS_validation",
@@ -0,0 +1,254 @@
+#include "Conv.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include "Dense.hpp"
+#include "TaskBuilder.hpp"
+#include "TaskGraph.hpp"
+
+namespace nn {
+
+namespace {
+
+// must match the tile, filter group and workgroup sizes in conv_direct.comp and conv_winograd.comp
+constexpr uint32_t directTile = 8;
+constexpr uint32_t directGroup = 8;
+constexpr uint32_t directMaxKernel = 7;
+constexpr uint32_t winogradGroup = 4;
+
+bool applies(ConvKernel kernel, const ConvSpecification& spec) {
+    switch (kernel) {
+        case ConvKernel::eDirect:
+            return spec.KernelSize <= directMaxKernel;
+        case ConvKernel::eWinograd:
+            return spec.KernelSize == 3;
+        default:
+            return true;
+    }
+}
+
+} // namespace
+
+ConvKernel SelectConvKernel(ComputeEngine& engine, const ConvSpecification& spec) {
+    if (spec.Kernel != ConvKernel::eAuto) {
+        return spec.Kernel;
+    }
+
+    PipelineLibrary& pipelines = engine.Pipelines();
+    std::vector<uint32_t> shape = {spec.Batch,
+                                   spec.Height,
+                                   spec.Width,
+                                   spec.Channels,
+                                   spec.Filters,
+                                   spec.KernelSize,
+                                   spec.Padding,
+                                   static_cast<uint32_t>(spec.Function)};
+    if (auto tuned = pipelines.TunedVariant("conv", shape)) {
+        return static_cast<ConvKernel>(*tuned);
+    }
+
+    constexpr int warmupRuns = 2;
+    constexpr int timedRuns = 8;
+
+    ConvKernel best = ConvKernel::eIm2col;
+    auto bestTime = std::chrono::nanoseconds::max();
+    for (ConvKernel candidate : {ConvKernel::eDirect, ConvKernel::eIm2col, ConvKernel::eWinograd}) {
+        if (!applies(candidate, spec)) {
+            continue;
+        }
+
+        ConvSpecification candidateSpec = spec;
+        candidateSpec.Kernel = candidate;
+        Conv layer(engine, candidateSpec);
+        layer.Initialize(engine, 0);
+        TaskGraph graph;
+        for (const auto& task : layer.Forward()) {
+            graph.Add(task);
+        }
+
+        for (int i = 0; i < warmupRuns; i++) {
+            engine.Wait(engine.ExecuteGraph(graph));
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < timedRuns; i++) {
+            engine.Wait(engine.ExecuteGraph(graph));
+        }
+        auto elapsed = std::chrono::high_resolution_clock::now() - start;
+
+        if (elapsed < bestTime) {
+            bestTime = elapsed;
+            best = candidate;
+        }
+    }
+
+    pipelines.SetTunedVariant("conv", shape, static_cast<uint32_t>(best));
+    return best;
+}
+
+std::shared_ptr<Task> CreatePoolTask(const ComputeEngine& engine,
+                                     const PoolSpecification& spec,
+                                     std::shared_ptr<Buffer> input,
+                                     std::shared_ptr<Buffer> output) {
+    if (spec.Size == 0 || spec.Height < spec.Size || spec.Width < spec.Size) {
+        throw std::runtime_error("a pooling window has to fit the image");
+    }
+
+    size_t outputs = size_t(spec.Batch) * (spec.Height / spec.Size) * (spec.Width / spec.Size) * spec.Channels;
+    TaskBuilder taskBuilder(engine);
+    taskBuilder.SetShader(spec.ShaderDirectory + "/maxpool.comp.spv");
+    taskBuilder.SetBuffers({
+        .SrcCount = size_t(spec.Batch) * spec.Height * spec.Width * spec.Channels,
+        .SrcSize = sizeof(float),
+        .DstCount = outputs,
+        .DstSize = sizeof(float),
+        .SrcUsage = MemoryUsage::eDeviceLocal,
+        .DstUsage = MemoryUsage::eDeviceLocal,
+    });
+    taskBuilder.SetSrcBuffer(std::move(input));
+    taskBuilder.SetDstBuffer(std::move(output));
+    taskBuilder.SetPipeline({
+        .bindings = StorageBindings(2),
+        .constants = {spec.Batch, spec.Height, spec.Width, spec.Channels, spec.Size},
+    });
+    return taskBuilder.create();
+}
+
+Conv::Conv(ComputeEngine& engine,
+           const ConvSpecification& spec,
+           std::shared_ptr<Buffer> input,
+           std::shared_ptr<Buffer> output)
+    : m_Spec(spec) {
+    if (spec.KernelSize == 0 || spec.KernelSize > 2 * spec.Padding + std::min(spec.Height, spec.Width)) {
+        throw std::runtime_error("a convolution kernel has to fit the padded image");
+    }
+    m_Spec.Kernel = SelectConvKernel(engine, spec);
+    if (!applies(m_Spec.Kernel, spec)) {
+        throw std::runtime_error("the convolution kernel does not support this kernel size");
+    }
+
+    const size_t pixels = size_t(spec.Batch) * spec.OutputHeight() * spec.OutputWidth();
+    m_Input = input ? std::move(input)
+                    : engine.CreateBuffer(size_t(spec.Batch) * spec.Height * spec.Width * spec.Channels,
+                                          sizeof(float),
+                                          MemoryUsage::eDeviceLocal);
+    if (!output) {
+        output = engine.CreateBuffer(pixels * spec.Filters, sizeof(float), MemoryUsage::eDeviceLocal);
+    }
+    m_Weights = engine.CreateBuffer(size_t(spec.PatchSize()) * spec.Filters, sizeof(float), MemoryUsage::eDeviceLocal);
+    m_Bias = engine.CreateBuffer(spec.Filters, sizeof(float), MemoryUsage::eDeviceLocal);
+
+    const std::vector<uint32_t> image = {spec.Batch, spec.Height, spec.Width, spec.Channels};
+
+    switch (m_Spec.Kernel) {
+        case ConvKernel::eDirect: {
+            uint32_t tiles = ((spec.OutputHeight() + directTile - 1) / directTile) *
+                             ((spec.OutputWidth() + directTile - 1) / directTile);
+            uint32_t groups = (spec.Filters + directGroup - 1) / directGroup;
+
+            TaskBuilder taskBuilder(engine);
+            taskBuilder.SetShader(spec.ShaderDirectory + "/conv_direct.comp.spv");
+            taskBuilder.SetSrcBuffer(m_Input);
+            taskBuilder.SetDstBuffer(std::move(output));
+            taskBuilder.AddBuffer(m_Weights);
+            taskBuilder.AddBuffer(m_Bias);
+            taskBuilder.SetPipeline({
+                .bindings = StorageBindings(4),
+                .constants = {spec.Batch,
+                              spec.Height,
+                              spec.Width,
+                              spec.Channels,
+                              spec.Filters,
+                              spec.KernelSize,
+                              spec.Padding,
+                              static_cast<uint32_t>(spec.Function)},
+            });
+            taskBuilder.SetWorkgroupSize(directTile * directTile);
+            taskBuilder.SetInvocations(spec.Batch * tiles * groups * directTile * directTile);
+            m_Forward.push_back(taskBuilder.create());
+            break;
+        }
+        case ConvKernel::eIm2col: {
+            m_Patches = engine.CreateBuffer(pixels * spec.PatchSize(), sizeof(float), MemoryUsage::eDeviceLocal);
+
+            TaskBuilder taskBuilder(engine);
+            taskBuilder.SetShader(spec.ShaderDirectory + "/im2col.comp.spv");
+            taskBuilder.SetSrcBuffer(m_Input);
+            taskBuilder.SetDstBuffer(m_Patches);
+            std::vector<uint32_t> constants = image;
+            constants.insert(constants.end(), {spec.KernelSize, spec.Padding});
+            taskBuilder.SetPipeline({
+                .bindings = StorageBindings(2),
+                .constants = constants,
+            });
+            m_Forward.push_back(taskBuilder.create());
+
+            DenseSpecification gemm = {
+                .Inputs = spec.PatchSize(),
+                .Outputs = spec.Filters,
+                .Batch = uint32_t(pixels),
+                .Function = spec.Function,
+                .ShaderDirectory = spec.ShaderDirectory,
+            };
+            m_Forward.push_back(CreateGemmTask(engine, gemm, m_Patches, std::move(output), m_Weights, m_Bias));
+            break;
+        }
+        case ConvKernel::eWinograd: {
+            // 4 x 4 transformed taps per channel and filter
+            size_t transformedCount = size_t(16) * spec.Channels * spec.Filters;
+            std::shared_ptr<Buffer> transformed =
+                engine.CreateBuffer(transformedCount, sizeof(float), MemoryUsage::eDeviceLocal);
+
+            TaskBuilder transformBuilder(engine);
+            transformBuilder.SetShader(spec.ShaderDirectory + "/winograd_weights.comp.spv");
+            transformBuilder.SetSrcBuffer(m_Weights);
+            transformBuilder.SetDstBuffer(transformed);
+            transformBuilder.SetPipeline({
+                .bindings = StorageBindings(2),
+                .constants = {spec.Channels, spec.Filters},
+            });
+            transformBuilder.SetInvocations(spec.Channels * spec.Filters);
+            m_Forward.push_back(transformBuilder.create());
+
+            uint32_t tiles = ((spec.OutputHeight() + 1) / 2) * ((spec.OutputWidth() + 1) / 2);
+            uint32_t groups = (spec.Filters + winogradGroup - 1) / winogradGroup;
+
+            TaskBuilder taskBuilder(engine);
+            taskBuilder.SetShader(spec.ShaderDirectory + "/conv_winograd.comp.spv");
+            taskBuilder.SetSrcBuffer(m_Input);
+            taskBuilder.SetDstBuffer(std::move(output));
+            taskBuilder.AddBuffer(std::move(transformed));
+            taskBuilder.AddBuffer(m_Bias);
+            std::vector<uint32_t> constants = image;
+            constants.insert(constants.end(), {spec.Filters, spec.Padding, static_cast<uint32_t>(spec.Function)});
+            taskBuilder.SetPipeline({
+                .bindings = StorageBindings(4),
+                .constants = constants,
+            });
+            taskBuilder.SetInvocations(spec.Batch * tiles * groups);
+            m_Forward.push_back(taskBuilder.create());
+            break;
+        }
+        case ConvKernel::eAuto:
+            break;
+    }
+}
+
+void Conv::Initialize(ComputeEngine& engine, uint32_t seed) {
+    float limit = std::sqrt(6.0f / float(m_Spec.PatchSize()));
+
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<float> distribution(-limit, limit);
+    std::vector<float> weights(size_t(m_Spec.PatchSize()) * m_Spec.Filters);
+    for (float& weight : weights) {
+        weight = distribution(generator);
+    }
+    std::vector<float> bias(m_Spec.Filters, 0.0f);
+
+    engine.Upload(*m_Weights, std::span<const float>(weights));
+    engine.Upload(*m_Bias, std::span<const float>(bias));
+}
+
+} // namespace nn
@@ -0,0 +1,96 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "Activation.hpp"
+#include "ComputeEngine.hpp"
+#include "Task.hpp"
+
+namespace nn {
+
+enum class ConvKernel : uint32_t {
+    eAuto,     // the fastest of the others for the shape, see SelectConvKernel
+    eDirect,   // 8 x 8 output tiles, the input window and 8 filters' taps staged in shared memory per channel
+    eIm2col,   // every patch unrolled into a row of a matrix that gemm_tiled.comp multiplies by the weights
+    eWinograd, // F(2x2, 3x3), 3 x 3 kernels only
+};
+
+// stride 1, zero padded 2-D convolution over a batch of NHWC images, the output is NHWC as well.
+// weights are KernelSize x KernelSize x Channels x Filters, i.e. the Inputs x Outputs matrix of a dense layer
+// over im2col patches, bias is Filters
+struct ConvSpecification {
+    uint32_t Batch;
+    uint32_t Height;
+    uint32_t Width;
+    uint32_t Channels;
+    uint32_t Filters;
+    uint32_t KernelSize = 3;
+    uint32_t Padding = 1;
+    Activation Function = Activation::eRelu;
+    ConvKernel Kernel = ConvKernel::eAuto;
+    std::string ShaderDirectory = "tests/spirv";
+
+    uint32_t OutputHeight() const { return Height + 2 * Padding - KernelSize + 1; }
+    uint32_t OutputWidth() const { return Width + 2 * Padding - KernelSize + 1; }
+    uint32_t PatchSize() const { return KernelSize * KernelSize * Channels; }
+};
+
+// Size x Size max pooling with stride Size over NHWC images, a partial window at the edge is dropped
+struct PoolSpecification {
+    uint32_t Batch;
+    uint32_t Height;
+    uint32_t Width;
+    uint32_t Channels;
+    uint32_t Size = 2;
+    std::string ShaderDirectory = "tests/spirv";
+};
+
+// the kernel for spec.Kernel, eAuto times every variant that applies on the first call for a shape and keeps
+// the fastest in the engine's PipelineLibrary next to its tuned workgroup sizes, later calls reuse it
+ConvKernel SelectConvKernel(ComputeEngine& engine, const ConvSpecification& spec);
+
+std::shared_ptr<Task> CreatePoolTask(const ComputeEngine& engine,
+                                     const PoolSpecification& spec,
+                                     std::shared_ptr<Buffer> input,
+                                     std::shared_ptr<Buffer> output);
+
+// convolution layer, output = activation(conv(input, weights) + bias) with the selected kernel.
+// Forward() is one to two tasks to run in order: im2col then the gemm, or Winograd's filter transform then the
+// convolution, so new weights take effect without rebuilding anything
+class Conv {
+public:
+    // device-local buffers are allocated for an empty input or output
+    Conv(ComputeEngine& engine,
+         const ConvSpecification& spec,
+         std::shared_ptr<Buffer> input = nullptr,
+         std::shared_ptr<Buffer> output = nullptr);
+
+    // uniform He initialisation, bias starts at zero
+    void Initialize(ComputeEngine& engine, uint32_t seed);
+
+    const std::vector<std::shared_ptr<Task>>& Forward() const { return m_Forward; }
+    const std::shared_ptr<Buffer>& Input() const { return m_Input; }
+    const std::shared_ptr<Buffer>& Output() const { return m_Forward.back()->Dst(); }
+    const std::shared_ptr<Buffer>& Weights() const { return m_Weights; }
+    const std::shared_ptr<Buffer>& Bias() const { return m_Bias; }
+    // the unrolled input of eIm2col, empty for the other kernels
+    const std::shared_ptr<Buffer>& Patches() const { return m_Patches; }
+    // with the kernel resolved
+    const ConvSpecification& Specification() const { return m_Spec; }
+
+    // multiply-adds of the direct convolution counted as two operations, whichever kernel runs
+    double Flops() const {
+        return 2.0 * m_Spec.Batch * m_Spec.OutputHeight() * m_Spec.OutputWidth() * m_Spec.PatchSize() *
+               m_Spec.Filters;
+    }
+
+private:
+    ConvSpecification m_Spec;
+    std::shared_ptr<Buffer> m_Input;
+    std::shared_ptr<Buffer> m_Weights;
+    std::shared_ptr<Buffer> m_Bias;
+    std::shared_ptr<Buffer> m_Patches;
+    std::vector<std::shared_ptr<Task>> m_Forward;
+};
+
+} // namespace nn
@@ -0,0 +1,126 @@
+#include "CpuBackend.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace nn {
+
+namespace {
+
+// a row block of dst is computed over column panels of NC, accumulating KC deep slices of src and
+// weights so the weight panel being streamed stays in cache across the block's rows
+constexpr size_t gemmRows = 4;
+constexpr size_t gemmPanelN = 256;
+constexpr size_t gemmPanelK = 256;
+constexpr size_t elementGrain = 1 << 14;
+
+const CpuTensor& cpu(const Tensor& tensor) {
+    return static_cast<const CpuTensor&>(tensor);
+}
+
+CpuTensor& cpu(Tensor& tensor) {
+    return static_cast<CpuTensor&>(tensor);
+}
+
+} // namespace
+
+CpuBackend::CpuBackend(size_t threads) : m_Kernels(SelectCpuKernels()), m_Pool(threads) {}
+
+std::string CpuBackend::Name() const {
+    return std::string("cpu ") + m_Kernels.Isa + " x" + std::to_string(m_Pool.Size());
+}
+
+std::unique_ptr<Tensor> CpuBackend::CreateTensor(uint32_t rows, uint32_t cols) {
+    return std::make_unique<CpuTensor>(rows, cols);
+}
+
+void CpuBackend::Write(Tensor& tensor, std::span<const float> data) {
+    if (data.size() != tensor.Count()) {
+        throw std::runtime_error("tensor write size mismatch");
+    }
+    std::memcpy(cpu(tensor).Data.data(), data.data(), data.size_bytes());
+}
+
+void CpuBackend::Read(const Tensor& tensor, std::span<float> data) {
+    if (data.size() != tensor.Count()) {
+        throw std::runtime_error("tensor read size mismatch");
+    }
+    std::memcpy(data.data(), cpu(tensor).Data.data(), data.size_bytes());
+}
+
+void CpuBackend::Gemm(const Tensor& src, const Tensor& weights, const Tensor& bias, Tensor& dst, Activation function) {
+    const size_t m = src.Rows();
+    const size_t k = src.Cols();
+    const size_t n = weights.Cols();
+    if (weights.Rows() != k || bias.Count() != n || dst.Rows() != m || dst.Cols() != n) {
+        throw std::runtime_error("gemm shape mismatch");
+    }
+
+    const float* a = cpu(src).Data.data();
+    const float* b = cpu(weights).Data.data();
+    const float* biasData = cpu(bias).Data.data();
+    float* c = cpu(dst).Data.data();
+
+    size_t blocks = (m + gemmRows - 1) / gemmRows;
+    m_Pool.ParallelFor(blocks, 1, [&](size_t first, size_t last) {
+        for (size_t block = first; block < last; block++) {
+            size_t row = block * gemmRows;
+            size_t rows = std::min(gemmRows, m - row);
+            for (size_t n0 = 0; n0 < n; n0 += gemmPanelN) {
+                size_t panelN = std::min(gemmPanelN, n - n0);
+                for (size_t r = 0; r < rows; r++) {
+                    std::fill_n(c + (row + r) * n + n0, panelN, 0.0f);
+                }
+                for (size_t k0 = 0; k0 < k; k0 += gemmPanelK) {
+                    m_Kernels.GemmRows(a + row * k + k0,
+                                       k,
+                                       b + k0 * n + n0,
+                                       n,
+                                       c + row * n + n0,
+                                       n,
+                                       rows,
+                                       std::min(gemmPanelK, k - k0),
+                                       panelN);
+                }
+                for (size_t r = 0; r < rows; r++) {
+                    m_Kernels.BiasActivate(c + (row + r) * n + n0, biasData + n0, panelN, function);
+                }
+            }
+        }
+    });
+}
+
+void CpuBackend::Activate(const Tensor& src, Tensor& dst, Activation function) {
+    if (src.Count() != dst.Count()) {
+        throw std::runtime_error("activation size mismatch");
+    }
+
+    const float* x = cpu(src).Data.data();
+    float* y = cpu(dst).Data.data();
+    m_Pool.ParallelFor(src.Count(), elementGrain, [&](size_t first, size_t last) {
+        if (x != y) {
+            std::copy(x + first, x + last, y + first);
+        }
+        m_Kernels.BiasActivate(y + first, nullptr, last - first, function);
+    });
+}
+
+void CpuBackend::SumRows(const Tensor& src, Tensor& dst) {
+    if (dst.Count() != src.Cols()) {
+        throw std::runtime_error("row sum size mismatch");
+    }
+
+    // columns are split between threads so no two of them write the same output
+    const size_t rows = src.Rows();
+    const size_t cols = src.Cols();
+    const float* x = cpu(src).Data.data();
+    float* y = cpu(dst).Data.data();
+    m_Pool.ParallelFor(cols, gemmPanelN, [&](size_t first, size_t last) {
+        std::fill(y + first, y + last, 0.0f);
+        for (size_t row = 0; row < rows; row++) {
+            m_Kernels.Add(x + row * cols + first, y + first, last - first);
+        }
+    });
+}
+
+} // namespace nn
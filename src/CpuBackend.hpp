@@ -0,0 +1,41 @@
+#pragma once
+#include <vector>
+#include "ComputeBackend.hpp"
+#include "CpuKernels.hpp"
+#include "ThreadPool.hpp"
+
+namespace nn {
+
+class CpuTensor : public Tensor {
+public:
+    CpuTensor(uint32_t rows, uint32_t cols) : Tensor(rows, cols), Data(Count()) {}
+
+    std::vector<float> Data;
+};
+
+// runs every operation immediately, split across a thread pool and vectorized with the widest
+// instruction set the cpu supports
+class CpuBackend : public ComputeBackend {
+public:
+    explicit CpuBackend(size_t threads = std::thread::hardware_concurrency());
+
+    std::string Name() const override;
+
+    std::unique_ptr<Tensor> CreateTensor(uint32_t rows, uint32_t cols) override;
+    void Write(Tensor& tensor, std::span<const float> data) override;
+    void Read(const Tensor& tensor, std::span<float> data) override;
+
+    void Gemm(const Tensor& src, const Tensor& weights, const Tensor& bias, Tensor& dst, Activation function) override;
+    void Activate(const Tensor& src, Tensor& dst, Activation function) override;
+    void SumRows(const Tensor& src, Tensor& dst) override;
+
+    void Finish() override {}
+
+    const CpuKernels& Kernels() const { return m_Kernels; }
+
+private:
+    const CpuKernels& m_Kernels;
+    ThreadPool m_Pool;
+};
+
+} // namespace nn
@@ -0,0 +1,41 @@
+#include "CpuKernels.hpp"
+#include <array>
+#include "CpuKernelsImpl.hpp"
+
+namespace nn {
+
+namespace {
+
+// one lane, lets the scalar table reuse the vector code paths
+struct ScalarVector {
+    using Vec = float;
+    static constexpr size_t Width = 1;
+    static Vec Zero() { return 0.0f; }
+    static Vec Set(float value) { return value; }
+    static Vec Load(const float* p) { return *p; }
+    static void Store(float* p, Vec value) { *p = value; }
+    static Vec Fma(Vec a, Vec b, Vec c) { return a * b + c; }
+    static Vec Add(Vec a, Vec b) { return a + b; }
+    static Vec Max(Vec a, Vec b) { return a > b ? a : b; }
+};
+
+} // namespace
+
+const CpuKernels& ScalarKernels() {
+    static constexpr CpuKernels kernels = SimdKernels<ScalarVector>::Table("scalar");
+    return kernels;
+}
+
+const CpuKernels& SelectCpuKernels() {
+    static const CpuKernels& selected = [&]() -> const CpuKernels& {
+        for (const CpuKernels* kernels : std::array{Avx512Kernels(), Avx2Kernels(), NeonKernels()}) {
+            if (kernels) {
+                return *kernels;
+            }
+        }
+        return ScalarKernels();
+    }();
+    return selected;
+}
+
+} // namespace nn
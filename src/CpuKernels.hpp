@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include "Activation.hpp"
+
+namespace nn {
+
+// inner loops of the cpu backend, one table per instruction set, picked once at startup
+struct CpuKernels {
+    const char* Isa;
+    // c += a * b for a block of 1 to 4 rows, a is rows x k, b is k x n, strides in floats
+    void (*GemmRows)(const float* a,
+                     size_t lda,
+                     const float* b,
+                     size_t ldb,
+                     float* c,
+                     size_t ldc,
+                     size_t rows,
+                     size_t k,
+                     size_t n);
+    // x = activation(x + bias) elementwise, bias may be null
+    void (*BiasActivate)(float* x, const float* bias, size_t n, Activation function);
+    // y += x
+    void (*Add)(const float* x, float* y, size_t n);
+};
+
+const CpuKernels& ScalarKernels();
+// null when the build or the running cpu lacks the instruction set
+const CpuKernels* Avx2Kernels();
+const CpuKernels* Avx512Kernels();
+const CpuKernels* NeonKernels();
+
+// the widest instruction set the running cpu supports
+const CpuKernels& SelectCpuKernels();
+
+} // namespace nn
@@ -0,0 +1,52 @@
+#include "CpuKernels.hpp"
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64)
+// everything included from here on is compiled for the target, shared inline code is included above
+#if defined(__GNUC__)
+#pragma GCC target("avx2,fma")
+#endif
+#include <immintrin.h>
+#include "CpuKernelsImpl.hpp"
+
+namespace nn {
+
+namespace {
+
+struct Avx2Vector {
+    using Vec = __m256;
+    static constexpr size_t Width = 8;
+    static Vec Zero() { return _mm256_setzero_ps(); }
+    static Vec Set(float value) { return _mm256_set1_ps(value); }
+    static Vec Load(const float* p) { return _mm256_loadu_ps(p); }
+    static void Store(float* p, Vec value) { _mm256_storeu_ps(p, value); }
+    static Vec Fma(Vec a, Vec b, Vec c) { return _mm256_fmadd_ps(a, b, c); }
+    static Vec Add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+    static Vec Max(Vec a, Vec b) { return _mm256_max_ps(a, b); }
+};
+
+} // namespace
+
+const CpuKernels* Avx2Kernels() {
+#if defined(__GNUC__)
+    static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+    static const bool supported = true; // msvc builds assume an avx2 capable host
+#endif
+    static constexpr CpuKernels kernels = SimdKernels<Avx2Vector>::Table("avx2");
+    return supported ? &kernels : nullptr;
+}
+
+} // namespace nn
+
+#else
+
+namespace nn {
+
+const CpuKernels* Avx2Kernels() {
+    return nullptr;
+}
+
+} // namespace nn
+
+#endif
@@ -0,0 +1,53 @@
+#include "CpuKernels.hpp"
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64)
+// everything included from here on is compiled for the target, shared inline code is included above
+#if defined(__GNUC__)
+#pragma GCC target("avx512f")
+#endif
+#include <immintrin.h>
+#include "CpuKernelsImpl.hpp"
+
+namespace nn {
+
+namespace {
+
+struct Avx512Vector {
+    using Vec = __m512;
+    static constexpr size_t Width = 16;
+    static Vec Zero() { return _mm512_setzero_ps(); }
+    static Vec Set(float value) { return _mm512_set1_ps(value); }
+    static Vec Load(const float* p) { return _mm512_loadu_ps(p); }
+    static void Store(float* p, Vec value) { _mm512_storeu_ps(p, value); }
+    static Vec Fma(Vec a, Vec b, Vec c) { return _mm512_fmadd_ps(a, b, c); }
+    static Vec Add(Vec a, Vec b) { return _mm512_add_ps(a, b); }
+    // the masked form, gcc warns about the undefined passthrough _mm512_max_ps uses
+    static Vec Max(Vec a, Vec b) { return _mm512_mask_max_ps(a, 0xffff, a, b); }
+};
+
+} // namespace
+
+const CpuKernels* Avx512Kernels() {
+#if defined(__GNUC__)
+    static const bool supported = __builtin_cpu_supports("avx512f");
+#else
+    static const bool supported = false; // no cheap feature query without cpuid plumbing, avx2 is used instead
+#endif
+    static constexpr CpuKernels kernels = SimdKernels<Avx512Vector>::Table("avx512");
+    return supported ? &kernels : nullptr;
+}
+
+} // namespace nn
+
+#else
+
+namespace nn {
+
+const CpuKernels* Avx512Kernels() {
+    return nullptr;
+}
+
+} // namespace nn
+
+#endif
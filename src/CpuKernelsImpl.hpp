@@ -0,0 +1,134 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include "CpuKernels.hpp"
+
+// shared by the per instruction set translation units, which include it after enabling their target
+// and instantiate SimdKernels with a vector type providing Width, Zero, Set, Load, Store, Fma, Add and Max
+
+namespace nn {
+
+template <typename V>
+struct SimdKernels {
+    using Vec = typename V::Vec;
+
+    template <size_t Rows>
+    static void gemmBlock(const float* a,
+                          size_t lda,
+                          const float* b,
+                          size_t ldb,
+                          float* c,
+                          size_t ldc,
+                          size_t k,
+                          size_t n) {
+        size_t j = 0;
+        // two vectors per row keep 2 * Rows independent accumulators in flight
+        for (; j + 2 * V::Width <= n; j += 2 * V::Width) {
+            Vec acc[Rows][2];
+            for (size_t r = 0; r < Rows; r++) {
+                acc[r][0] = V::Load(c + r * ldc + j);
+                acc[r][1] = V::Load(c + r * ldc + j + V::Width);
+            }
+            for (size_t kk = 0; kk < k; kk++) {
+                Vec b0 = V::Load(b + kk * ldb + j);
+                Vec b1 = V::Load(b + kk * ldb + j + V::Width);
+                for (size_t r = 0; r < Rows; r++) {
+                    Vec scalar = V::Set(a[r * lda + kk]);
+                    acc[r][0] = V::Fma(scalar, b0, acc[r][0]);
+                    acc[r][1] = V::Fma(scalar, b1, acc[r][1]);
+                }
+            }
+            for (size_t r = 0; r < Rows; r++) {
+                V::Store(c + r * ldc + j, acc[r][0]);
+                V::Store(c + r * ldc + j + V::Width, acc[r][1]);
+            }
+        }
+        for (; j + V::Width <= n; j += V::Width) {
+            Vec acc[Rows];
+            for (size_t r = 0; r < Rows; r++) {
+                acc[r] = V::Load(c + r * ldc + j);
+            }
+            for (size_t kk = 0; kk < k; kk++) {
+                Vec b0 = V::Load(b + kk * ldb + j);
+                for (size_t r = 0; r < Rows; r++) {
+                    acc[r] = V::Fma(V::Set(a[r * lda + kk]), b0, acc[r]);
+                }
+            }
+            for (size_t r = 0; r < Rows; r++) {
+                V::Store(c + r * ldc + j, acc[r]);
+            }
+        }
+        for (; j < n; j++) {
+            for (size_t r = 0; r < Rows; r++) {
+                float acc = c[r * ldc + j];
+                for (size_t kk = 0; kk < k; kk++) {
+                    acc += a[r * lda + kk] * b[kk * ldb + j];
+                }
+                c[r * ldc + j] = acc;
+            }
+        }
+    }
+
+    static void GemmRows(const float* a,
+                         size_t lda,
+                         const float* b,
+                         size_t ldb,
+                         float* c,
+                         size_t ldc,
+                         size_t rows,
+                         size_t k,
+                         size_t n) {
+        switch (rows) {
+            case 1:
+                gemmBlock<1>(a, lda, b, ldb, c, ldc, k, n);
+                break;
+            case 2:
+                gemmBlock<2>(a, lda, b, ldb, c, ldc, k, n);
+                break;
+            case 3:
+                gemmBlock<3>(a, lda, b, ldb, c, ldc, k, n);
+                break;
+            default:
+                gemmBlock<4>(a, lda, b, ldb, c, ldc, k, n);
+                break;
+        }
+    }
+
+    static void BiasActivate(float* x, const float* bias, size_t n, Activation function) {
+        size_t i = 0;
+        // sigmoid needs exp, which has no portable vector form, so only relu and none are vectorized
+        if (function != Activation::eSigmoid) {
+            Vec zero = V::Zero();
+            for (; i + V::Width <= n; i += V::Width) {
+                Vec value = V::Load(x + i);
+                if (bias) {
+                    value = V::Add(value, V::Load(bias + i));
+                }
+                V::Store(x + i, function == Activation::eRelu ? V::Max(value, zero) : value);
+            }
+        }
+        for (; i < n; i++) {
+            float value = x[i] + (bias ? bias[i] : 0.0f);
+            if (function == Activation::eRelu) {
+                value = value > 0.0f ? value : 0.0f;
+            } else if (function == Activation::eSigmoid) {
+                value = 1.0f / (1.0f + std::exp(-value));
+            }
+            x[i] = value;
+        }
+    }
+
+    static void Add(const float* x, float* y, size_t n) {
+        size_t i = 0;
+        for (; i + V::Width <= n; i += V::Width) {
+            V::Store(y + i, V::Add(V::Load(x + i), V::Load(y + i)));
+        }
+        for (; i < n; i++) {
+            y[i] += x[i];
+        }
+    }
+
+    static constexpr CpuKernels Table(const char* isa) { return {isa, GemmRows, BiasActivate, Add}; }
+};
+
+} // namespace nn
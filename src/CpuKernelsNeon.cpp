@@ -0,0 +1,43 @@
+#include "CpuKernels.hpp"
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#include "CpuKernelsImpl.hpp"
+
+namespace nn {
+
+namespace {
+
+struct NeonVector {
+    using Vec = float32x4_t;
+    static constexpr size_t Width = 4;
+    static Vec Zero() { return vdupq_n_f32(0.0f); }
+    static Vec Set(float value) { return vdupq_n_f32(value); }
+    static Vec Load(const float* p) { return vld1q_f32(p); }
+    static void Store(float* p, Vec value) { vst1q_f32(p, value); }
+    static Vec Fma(Vec a, Vec b, Vec c) { return vfmaq_f32(c, a, b); }
+    static Vec Add(Vec a, Vec b) { return vaddq_f32(a, b); }
+    static Vec Max(Vec a, Vec b) { return vmaxq_f32(a, b); }
+};
+
+} // namespace
+
+// neon is part of every aarch64 cpu, no runtime check needed
+const CpuKernels* NeonKernels() {
+    static constexpr CpuKernels kernels = SimdKernels<NeonVector>::Table("neon");
+    return &kernels;
+}
+
+} // namespace nn
+
+#else
+
+namespace nn {
+
+const CpuKernels* NeonKernels() {
+    return nullptr;
+}
+
+} // namespace nn
+
+#endif
@@ -0,0 +1,161 @@
+#include "DataParallelTrainer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+namespace nn {
+
+DataParallelTrainer::DataParallelTrainer(const std::vector<ComputeEngine*>& engines, const TrainerSpecification& spec)
+    : m_Engines(engines),
+      m_Spec(spec),
+      m_Pool(engines.size()) {
+    if (engines.empty() || spec.Batch % engines.size() != 0) {
+        throw std::runtime_error("the batch has to split evenly across the engines");
+    }
+
+    // the same seed everywhere, so every replica starts from the same parameters
+    for (uint32_t replica = 0; replica < engines.size(); replica++) {
+        TrainerSpecification replicaSpec = spec;
+        replicaSpec.Batch = spec.Batch / uint32_t(engines.size());
+        replicaSpec.Replicas = uint32_t(engines.size());
+        replicaSpec.Replica = replica;
+        m_Replicas.push_back(std::make_unique<Trainer>(*engines[replica], replicaSpec));
+    }
+}
+
+StepResult DataParallelTrainer::Step(std::span<const uint8_t> images, std::span<const uint8_t> labels) {
+    if (images.size() != size_t(m_Spec.Batch) * m_Spec.Widths.front() || labels.size() != m_Spec.Batch) {
+        throw std::runtime_error("batch does not match the trainer's batch size");
+    }
+
+    m_Step++;
+    const size_t replicas = m_Replicas.size();
+    if (replicas == 1) {
+        return m_Replicas.front()->Step(images, labels);
+    }
+
+    std::vector<std::vector<SubmitHandle>> gradients;
+    for (size_t replica = 0; replica < replicas; replica++) {
+        gradients.push_back(m_Replicas[replica]->submitGradients(shard(images, replica), shard(labels, replica)));
+    }
+
+    // the last layer's gradients are ready first, its update queues behind the rest of the backward pass
+    std::vector<SubmitHandle> updates(replicas);
+    for (size_t segment = 0; segment < gradients.front().size(); segment++) {
+        for (size_t replica = 0; replica < replicas; replica++) {
+            m_Engines[replica]->Wait(gradients[replica][segment]);
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        allReduce(segment);
+        m_ReduceSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+        for (size_t replica = 0; replica < replicas; replica++) {
+            updates[replica] = m_Replicas[replica]->submitUpdate(segment);
+        }
+    }
+
+    StepResult result = {};
+    for (size_t replica = 0; replica < replicas; replica++) {
+        m_Engines[replica]->Wait(updates[replica]);
+        StepResult step = m_Replicas[replica]->stats();
+        result.Loss += step.Loss / float(replicas);
+        result.Accuracy += step.Accuracy / float(replicas);
+    }
+    return result;
+}
+
+StepResult DataParallelTrainer::Evaluate(std::span<const uint8_t> images, std::span<const uint8_t> labels) {
+    if (images.size() != size_t(m_Spec.Batch) * m_Spec.Widths.front() || labels.size() != m_Spec.Batch) {
+        throw std::runtime_error("batch does not match the trainer's batch size");
+    }
+
+    const size_t replicas = m_Replicas.size();
+    std::vector<SubmitHandle> handles;
+    for (size_t replica = 0; replica < replicas; replica++) {
+        Trainer& trainer = *m_Replicas[replica];
+        handles.push_back(trainer.submit(trainer.m_EvalGraph, false, shard(images, replica), shard(labels, replica)));
+    }
+
+    StepResult result = {};
+    for (size_t replica = 0; replica < replicas; replica++) {
+        m_Engines[replica]->Wait(handles[replica]);
+        StepResult step = m_Replicas[replica]->stats();
+        result.Loss += step.Loss / float(replicas);
+        result.Accuracy += step.Accuracy / float(replicas);
+    }
+    return result;
+}
+
+EpochResult DataParallelTrainer::TrainEpoch(BatchPrefetcher& prefetcher) {
+    const size_t imageSize = m_Spec.Widths.front();
+
+    EpochResult result = {};
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t batch = 0; batch < prefetcher.BatchesPerEpoch(); batch++) {
+        const BatchSlot& slot = prefetcher.Next();
+        if (slot.Count != m_Spec.Batch) {
+            continue;
+        }
+
+        StepResult step = Step(slot.Images.first(slot.Count * imageSize), slot.Labels.first(slot.Count));
+        result.Loss += step.Loss;
+        result.Accuracy += step.Accuracy;
+        result.Images += slot.Count;
+        for (const auto& replica : m_Replicas) {
+            result.UploadBytes += replica->UploadBytes();
+        }
+    }
+    result.Seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+    size_t steps = result.Images / m_Spec.Batch;
+    if (steps > 0) {
+        result.Loss /= float(steps);
+        result.Accuracy /= float(steps);
+    }
+    result.ImagesPerSecond = result.Seconds > 0.0 ? double(result.Images) / result.Seconds : 0.0;
+    return result;
+}
+
+void DataParallelTrainer::SetLearningRate(float learningRate) {
+    m_Spec.LearningRate = learningRate;
+    for (const auto& replica : m_Replicas) {
+        replica->SetLearningRate(learningRate);
+    }
+}
+
+// a ring-ordered reduce-scatter and all-gather: replica r owns the r-th chunk, sums it from every other replica
+// starting with its successor, then copies the sum back out to them. all the buffers are host memory, so the
+// owners of different chunks never touch the same values and need no barrier between the two phases
+void DataParallelTrainer::allReduce(size_t segment) {
+    std::vector<std::span<float>> gradients;
+    for (const auto& replica : m_Replicas) {
+        gradients.push_back(replica->parameterGradients(segment));
+    }
+
+    const size_t replicas = gradients.size();
+    const size_t count = gradients.front().size();
+    m_Pool.ParallelFor(replicas, 1, [&](size_t begin, size_t end) {
+        for (size_t owner = begin; owner < end; owner++) {
+            size_t first = count * owner / replicas;
+            size_t size = count * (owner + 1) / replicas - first;
+            std::span<float> sum = gradients[owner].subspan(first, size);
+            for (size_t step = 1; step < replicas; step++) {
+                std::span<const float> other = gradients[(owner + step) % replicas].subspan(first, size);
+                for (size_t i = 0; i < size; i++) {
+                    sum[i] += other[i];
+                }
+            }
+            for (size_t step = 1; step < replicas; step++) {
+                std::ranges::copy(sum, gradients[(owner + step) % replicas].begin() + first);
+            }
+        }
+    });
+}
+
+std::span<const uint8_t> DataParallelTrainer::shard(std::span<const uint8_t> values, size_t replica) const {
+    size_t size = values.size() / m_Replicas.size();
+    return values.subspan(replica * size, size);
+}
+
+} // namespace nn
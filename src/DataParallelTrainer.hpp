@@ -0,0 +1,48 @@
+#pragma once
+#include <memory>
+#include <span>
+#include <vector>
+#include "ComputeEngine.hpp"
+#include "Dataset.hpp"
+#include "ThreadPool.hpp"
+#include "Trainer.hpp"
+
+namespace nn {
+
+// one model trained on several engines, each on its own device or another logical device of the same one.
+// every step shards the batch across one Trainer replica per engine, sums their parameter gradients with an
+// all-reduce through host-visible memory and applies the same update everywhere, so the replicas never drift
+// apart. a layer's gradients are summed as soon as every replica has them, while the devices carry on with the
+// backward pass of the layers before it
+class DataParallelTrainer {
+public:
+    // spec.Batch is the whole batch, it has to split evenly across the engines
+    DataParallelTrainer(const std::vector<ComputeEngine*>& engines, const TrainerSpecification& spec);
+
+    StepResult Step(std::span<const uint8_t> images, std::span<const uint8_t> labels);
+    StepResult Evaluate(std::span<const uint8_t> images, std::span<const uint8_t> labels);
+
+    // trains on one epoch from the prefetcher, a short final batch is skipped
+    EpochResult TrainEpoch(BatchPrefetcher& prefetcher);
+
+    size_t ReplicaCount() const { return m_Replicas.size(); }
+    const Trainer& Replica(size_t replica) const { return *m_Replicas[replica]; }
+    const TrainerSpecification& Specification() const { return m_Spec; }
+    void SetLearningRate(float learningRate);
+    size_t Steps() const { return m_Step; }
+    // host time spent summing gradients so far, most of it hidden behind the devices' backward passes
+    double ReduceSeconds() const { return m_ReduceSeconds; }
+
+private:
+    void allReduce(size_t segment);
+    std::span<const uint8_t> shard(std::span<const uint8_t> values, size_t replica) const;
+
+    std::vector<ComputeEngine*> m_Engines;
+    TrainerSpecification m_Spec;
+    std::vector<std::unique_ptr<Trainer>> m_Replicas;
+    ThreadPool m_Pool; // one thread per replica for the all-reduce
+    size_t m_Step = 0;
+    double m_ReduceSeconds = 0.0;
+};
+
+} // namespace nn
@@ -0,0 +1,254 @@
+#include "Dataset.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace nn {
+
+//--- MappedFile
+
+MappedFile::MappedFile(const std::string& path) {
+#ifdef _WIN32
+    m_File = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, 0, nullptr);
+    if (m_File == INVALID_HANDLE_VALUE) {
+        m_File = nullptr;
+        throw std::runtime_error("could not open " + path);
+    }
+    LARGE_INTEGER size;
+    GetFileSizeEx(m_File, &size);
+    m_Size = size_t(size.QuadPart);
+    if (m_Size) {
+        m_Mapping = CreateFileMappingA(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        m_Data = (const uint8_t*)MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0);
+    }
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("could not open " + path);
+    }
+    struct stat st;
+    fstat(fd, &st);
+    m_Size = size_t(st.st_size);
+    if (m_Size) {
+        void* data = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            // batches are gathered in shuffled order, prefetch the pages up front rather than fault on each
+            madvise(data, m_Size, MADV_WILLNEED);
+            m_Data = (const uint8_t*)data;
+        }
+    }
+    ::close(fd);
+#endif
+    if (m_Size && !m_Data) {
+        close();
+        throw std::runtime_error("could not map " + path);
+    }
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : m_Data(std::exchange(other.m_Data, nullptr)),
+      m_Size(std::exchange(other.m_Size, 0))
+#ifdef _WIN32
+      ,
+      m_File(std::exchange(other.m_File, nullptr)),
+      m_Mapping(std::exchange(other.m_Mapping, nullptr))
+#endif
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        m_Data = std::exchange(other.m_Data, nullptr);
+        m_Size = std::exchange(other.m_Size, 0);
+#ifdef _WIN32
+        m_File = std::exchange(other.m_File, nullptr);
+        m_Mapping = std::exchange(other.m_Mapping, nullptr);
+#endif
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+    if (m_Data) {
+        UnmapViewOfFile(m_Data);
+    }
+    if (m_Mapping) {
+        CloseHandle(m_Mapping);
+    }
+    if (m_File) {
+        CloseHandle(m_File);
+    }
+    m_File = m_Mapping = nullptr;
+#else
+    if (m_Data) {
+        munmap((void*)m_Data, m_Size);
+    }
+#endif
+    m_Data = nullptr;
+    m_Size = 0;
+}
+
+//--- IdxFile
+
+IdxFile::IdxFile(const std::string& path) : m_File(path) {
+    std::span<const uint8_t> data = m_File.Data();
+
+    // magic: two zero bytes, element type, dimension count. then big-endian uint32 dimensions
+    constexpr uint8_t unsignedByte = 0x08;
+    if (data.size() < 4 || data[0] != 0 || data[1] != 0 || data[2] != unsignedByte || data[3] == 0) {
+        throw std::runtime_error(path + " is not an unsigned byte IDX file");
+    }
+
+    size_t dimensionCount = data[3];
+    size_t headerSize = 4 + 4 * dimensionCount;
+    if (data.size() < headerSize) {
+        throw std::runtime_error(path + " has a truncated IDX header");
+    }
+
+    m_ItemSize = 1;
+    for (size_t i = 0; i < dimensionCount; i++) {
+        const uint8_t* p = data.data() + 4 + 4 * i;
+        m_Dimensions.push_back(uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 8 | uint32_t(p[3]));
+        if (i > 0) {
+            m_ItemSize *= m_Dimensions.back();
+        }
+    }
+
+    if (data.size() - headerSize != Count() * m_ItemSize) {
+        throw std::runtime_error(path + " size does not match its IDX header");
+    }
+    m_Items = data.subspan(headerSize);
+}
+
+//--- MnistDataset
+
+MnistDataset::MnistDataset(const std::string& imagesPath, const std::string& labelsPath)
+    : m_Images(imagesPath),
+      m_Labels(labelsPath) {
+    if (m_Images.Dimensions().size() != 3 || m_Labels.Dimensions().size() != 1) {
+        throw std::runtime_error("expected an [N, rows, cols] image file and an [N] label file");
+    }
+    if (m_Images.Count() != m_Labels.Count()) {
+        throw std::runtime_error(imagesPath + " and " + labelsPath + " hold a different number of items");
+    }
+}
+
+//--- BatchSampler
+
+BatchSampler::BatchSampler(const MnistDataset& dataset, size_t batchSize, uint32_t seed)
+    : m_Dataset(dataset),
+      m_BatchSize(batchSize),
+      m_Order(dataset.Size()),
+      m_Cursor(0),
+      m_Rng(seed) {
+    std::iota(m_Order.begin(), m_Order.end(), 0u);
+    std::shuffle(m_Order.begin(), m_Order.end(), m_Rng);
+}
+
+BatchView BatchSampler::Next() {
+    if (m_Cursor >= m_Order.size()) {
+        std::shuffle(m_Order.begin(), m_Order.end(), m_Rng);
+        m_Cursor = 0;
+        m_Epoch++;
+    }
+
+    size_t count = std::min(m_BatchSize, m_Order.size() - m_Cursor);
+    BatchView batch = {&m_Dataset, std::span<const uint32_t>(m_Order).subspan(m_Cursor, count)};
+    m_Cursor += count;
+    return batch;
+}
+
+//--- BatchPrefetcher
+
+BatchPrefetcher::BatchPrefetcher(const MnistDataset& dataset,
+                                 size_t batchSize,
+                                 std::array<BatchSlot, 2> slots,
+                                 uint32_t seed)
+    : m_Sampler(dataset, batchSize, seed),
+      m_Slots(slots) {
+    for (const auto& slot : m_Slots) {
+        if (slot.Images.size() < batchSize * dataset.ImageSize() || slot.Labels.size() < batchSize) {
+            throw std::runtime_error("prefetch slot is smaller than one batch");
+        }
+    }
+    m_Worker = std::thread(&BatchPrefetcher::run, this);
+}
+
+BatchPrefetcher::~BatchPrefetcher() {
+    {
+        std::lock_guard lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_Condition.notify_all();
+    m_Worker.join();
+}
+
+const BatchSlot& BatchPrefetcher::Next() {
+    std::unique_lock lock(m_Mutex);
+
+    // the slot handed out last time is free to refill now
+    if (m_Consumed > 0) {
+        m_Ready[(m_Consumed - 1) % 2] = false;
+        m_Condition.notify_all();
+    }
+
+    size_t slot = m_Consumed % 2;
+    auto start = std::chrono::steady_clock::now();
+    m_Condition.wait(lock, [&] { return m_Ready[slot]; });
+    m_StallSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    m_Consumed++;
+    return m_Slots[slot];
+}
+
+void BatchPrefetcher::run() {
+    for (size_t produced = 0;; produced++) {
+        size_t slot = produced % 2;
+        {
+            std::unique_lock lock(m_Mutex);
+            m_Condition.wait(lock, [&] { return m_Stop || !m_Ready[slot]; });
+            if (m_Stop) {
+                return;
+            }
+        }
+
+        // the caller never touches a slot that is not ready, so packing needs no lock
+        BatchView batch = m_Sampler.Next();
+        BatchSlot& destination = m_Slots[slot];
+        size_t imageSize = batch.Dataset->ImageSize();
+        for (size_t i = 0; i < batch.Size(); i++) {
+            std::memcpy(destination.Images.data() + i * imageSize, batch.Image(i).data(), imageSize);
+            destination.Labels[i] = batch.Label(i);
+        }
+        destination.Count = batch.Size();
+        destination.Epoch = m_Sampler.Epoch();
+
+        {
+            std::lock_guard lock(m_Mutex);
+            m_Ready[slot] = true;
+        }
+        m_Condition.notify_all();
+    }
+}
+
+} // namespace nn
@@ -0,0 +1,137 @@
+#pragma once
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace nn {
+
+// read-only memory map of a whole file
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path);
+    MappedFile(const MappedFile&) = delete;
+    void operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    ~MappedFile();
+
+    std::span<const uint8_t> Data() const { return {m_Data, m_Size}; }
+
+private:
+    void close();
+
+    const uint8_t* m_Data = nullptr;
+    size_t m_Size = 0;
+#ifdef _WIN32
+    void* m_File = nullptr;
+    void* m_Mapping = nullptr;
+#endif
+};
+
+// an unsigned byte IDX file (the MNIST format), header validated against the file size
+class IdxFile {
+public:
+    IdxFile() = default;
+    explicit IdxFile(const std::string& path);
+
+    const std::vector<uint32_t>& Dimensions() const { return m_Dimensions; }
+    size_t Count() const { return m_Dimensions.empty() ? 0 : m_Dimensions.front(); }
+    size_t ItemSize() const { return m_ItemSize; }
+    std::span<const uint8_t> Item(size_t i) const { return m_Items.subspan(i * m_ItemSize, m_ItemSize); }
+
+private:
+    MappedFile m_File;
+    std::vector<uint32_t> m_Dimensions;
+    size_t m_ItemSize = 0;
+    std::span<const uint8_t> m_Items;
+};
+
+class MnistDataset {
+public:
+    MnistDataset(const std::string& imagesPath, const std::string& labelsPath);
+
+    size_t Size() const { return m_Images.Count(); }
+    size_t ImageSize() const { return m_Images.ItemSize(); } // 28 * 28
+    std::span<const uint8_t> Image(size_t i) const { return m_Images.Item(i); }
+    uint8_t Label(size_t i) const { return m_Labels.Item(i)[0]; }
+
+private:
+    IdxFile m_Images;
+    IdxFile m_Labels;
+};
+
+// zero-copy view of one shuffled mini-batch, images point straight into the mapped file
+struct BatchView {
+    const MnistDataset* Dataset;
+    std::span<const uint32_t> Indices;
+
+    size_t Size() const { return Indices.size(); }
+    std::span<const uint8_t> Image(size_t i) const { return Dataset->Image(Indices[i]); }
+    uint8_t Label(size_t i) const { return Dataset->Label(Indices[i]); }
+};
+
+// reshuffles every epoch and hands out consecutive batches of the permutation
+class BatchSampler {
+public:
+    BatchSampler(const MnistDataset& dataset, size_t batchSize, uint32_t seed = 0);
+
+    BatchView Next(); // valid until the next call, the last batch of an epoch may be short
+    size_t Epoch() const { return m_Epoch; }
+    size_t BatchesPerEpoch() const { return (m_Order.size() + m_BatchSize - 1) / m_BatchSize; }
+
+private:
+    const MnistDataset& m_Dataset;
+    size_t m_BatchSize;
+    std::vector<uint32_t> m_Order;
+    size_t m_Cursor;
+    size_t m_Epoch = 0;
+    std::mt19937 m_Rng;
+};
+
+// packed batch destination, typically a Trainer's BatchSlots in host-visible memory the device reads directly
+struct BatchSlot {
+    std::span<uint8_t> Images; // batchSize * ImageSize() bytes
+    std::span<uint8_t> Labels; // batchSize bytes
+    size_t Count = 0;          // images actually packed, short on the last batch of an epoch
+    size_t Epoch = 0;
+};
+
+// packs batch N+1 into one slot on a background thread while the caller consumes batch N from the other
+class BatchPrefetcher {
+public:
+    BatchPrefetcher(const MnistDataset& dataset, size_t batchSize, std::array<BatchSlot, 2> slots, uint32_t seed = 0);
+    BatchPrefetcher(const BatchPrefetcher&) = delete;
+    void operator=(const BatchPrefetcher&) = delete;
+    ~BatchPrefetcher();
+
+    // blocks until the next batch is packed. the slot returned by the previous call is handed
+    // back to the worker, so any upload reading it must have completed before calling again
+    const BatchSlot& Next();
+
+    size_t BatchesPerEpoch() const { return m_Sampler.BatchesPerEpoch(); }
+    // time Next() spent blocked, nonzero means loading is on the critical path
+    double StallSeconds() const { return m_StallSeconds; }
+
+private:
+    void run();
+
+    BatchSampler m_Sampler;
+    std::array<BatchSlot, 2> m_Slots;
+    std::array<bool, 2> m_Ready = {false, false};
+    size_t m_Consumed = 0; // batches handed to the caller
+    double m_StallSeconds = 0.0;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_Condition;
+    bool m_Stop = false;
+    std::thread m_Worker;
+};
+
+} // namespace nn
@@ -0,0 +1,107 @@
+#include "Dense.hpp"
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include "TaskBuilder.hpp"
+
+namespace nn {
+
+namespace {
+
+// must match the tile and workgroup sizes in gemm_tiled.comp
+constexpr uint32_t gemmTile = 64;
+constexpr uint32_t gemmThreads = 256;
+
+} // namespace
+
+Precision GemmPrecision(GemmKernel kernel) {
+    switch (kernel) {
+        case GemmKernel::eTiledFloat16:
+            return Precision::eFloat16;
+        case GemmKernel::eTiledInt8:
+            return Precision::eInt8;
+        default:
+            return Precision::eFloat32;
+    }
+}
+
+std::shared_ptr<Task> CreateGemmTask(const ComputeEngine& engine,
+                                     const DenseSpecification& spec,
+                                     std::shared_ptr<Buffer> input,
+                                     std::shared_ptr<Buffer> output,
+                                     std::shared_ptr<Buffer> weights,
+                                     std::shared_ptr<Buffer> bias) {
+    Precision precision = GemmPrecision(spec.Kernel);
+    if ((precision == Precision::eFloat16 && !engine.HasFloat16()) ||
+        (precision == Precision::eInt8 && !engine.HasInt8())) {
+        throw std::runtime_error("the engine was not created with the storage features this gemm kernel needs");
+    }
+
+    TaskBuilder taskBuilder(engine);
+    taskBuilder.SetBuffers({
+        .SrcCount = size_t(spec.Batch) * spec.Inputs,
+        .SrcSize = PrecisionSize(precision),
+        .DstCount = size_t(spec.Batch) * spec.Outputs,
+        .DstSize = PrecisionSize(precision),
+        .SrcUsage = MemoryUsage::eDeviceLocal,
+        .DstUsage = MemoryUsage::eDeviceLocal,
+    });
+    taskBuilder.SetSrcBuffer(std::move(input));
+    taskBuilder.SetDstBuffer(std::move(output));
+    taskBuilder.AddBuffer(std::move(weights));
+    taskBuilder.AddBuffer(std::move(bias));
+    taskBuilder.SetPipeline({
+        .bindings = StorageBindings(4),
+        .constants = {spec.Batch, spec.Outputs, spec.Inputs, static_cast<uint32_t>(spec.Function)},
+        .pushConstantSize = spec.Kernel == GemmKernel::eTiledInt8 ? uint32_t(sizeof(GemmScales)) : 0,
+    });
+
+    if (spec.Kernel == GemmKernel::eNaive) {
+        taskBuilder.SetShader(spec.ShaderDirectory + "/gemm_naive.comp.spv");
+    } else {
+        // the reduced precision kernels share gemm_tiled.comp's tiling
+        uint32_t tiles = ((spec.Batch + gemmTile - 1) / gemmTile) * ((spec.Outputs + gemmTile - 1) / gemmTile);
+        const char* shader = spec.Kernel == GemmKernel::eTiledFloat16 ? "/gemm_f16.comp.spv"
+                             : spec.Kernel == GemmKernel::eTiledInt8  ? "/gemm_int8.comp.spv"
+                                                                      : "/gemm_tiled.comp.spv";
+        taskBuilder.SetShader(spec.ShaderDirectory + shader);
+        taskBuilder.SetWorkgroupSize(gemmThreads);
+        taskBuilder.SetInvocations(tiles * gemmThreads);
+    }
+
+    return taskBuilder.create();
+}
+
+Dense::Dense(const ComputeEngine& engine,
+             const DenseSpecification& spec,
+             std::shared_ptr<Buffer> input,
+             std::shared_ptr<Buffer> output)
+    : m_Spec(spec) {
+    if (GemmPrecision(spec.Kernel) != Precision::eFloat32) {
+        throw std::runtime_error("a dense layer keeps fp32 weights, use InferenceNetwork for reduced precision");
+    }
+    m_Weights = engine.CreateBuffer(size_t(spec.Inputs) * spec.Outputs, sizeof(float), MemoryUsage::eDeviceLocal);
+    m_Bias = engine.CreateBuffer(spec.Outputs, sizeof(float), MemoryUsage::eDeviceLocal);
+    m_Forward = CreateGemmTask(engine, spec, std::move(input), std::move(output), m_Weights, m_Bias);
+}
+
+void Dense::Initialize(ComputeEngine& engine, uint32_t seed) {
+    // relu halves the variance of what it passes on, so it gets He's bound, everything else Xavier's
+    float fanIn = float(m_Spec.Inputs);
+    float fanOut = float(m_Spec.Outputs);
+    float limit = m_Spec.Function == Activation::eRelu ? std::sqrt(6.0f / fanIn) : std::sqrt(6.0f / (fanIn + fanOut));
+
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<float> distribution(-limit, limit);
+    std::vector<float> weights(size_t(m_Spec.Inputs) * m_Spec.Outputs);
+    for (float& weight : weights) {
+        weight = distribution(generator);
+    }
+    std::vector<float> bias(m_Spec.Outputs, 0.0f);
+
+    engine.Upload(*m_Weights, std::span<const float>(weights));
+    engine.Upload(*m_Bias, std::span<const float>(bias));
+}
+
+} // namespace nn
@@ -0,0 +1,78 @@
+#pragma once
+#include <memory>
+#include <string>
+#include "Activation.hpp"
+#include "ComputeEngine.hpp"
+#include "Quantization.hpp"
+#include "Task.hpp"
+
+namespace nn {
+
+enum class GemmKernel {
+    eTiled,        // 64 x 64 shared memory tiles, 4 x 4 outputs per invocation
+    eNaive,        // one invocation per output, kept as the baseline to benchmark against
+    eTiledFloat16, // eTiled with src, dst and weights stored as fp16, needs EngineConfig::Float16
+    eTiledInt8,    // eTiled over int8 with GemmScales pushed per dispatch, needs EngineConfig::Int8
+};
+
+// element type of src, dst and weights, bias is always fp32
+Precision GemmPrecision(GemmKernel kernel);
+
+// push constants of eTiledInt8, each tensor's real value is its scale times the stored int8
+struct GemmScales {
+    float Input;
+    float Weights;
+    float Output;
+};
+
+struct DenseSpecification {
+    uint32_t Inputs;
+    uint32_t Outputs;
+    uint32_t Batch;
+    Activation Function = Activation::eNone;
+    GemmKernel Kernel = GemmKernel::eTiled;
+    std::string ShaderDirectory = "tests/spirv";
+};
+
+// the dispatch of one forward pass over buffers owned by the caller, src or dst are allocated when empty.
+// eTiledInt8 tasks need their GemmScales set with Task::SetPushConstants before they run
+std::shared_ptr<Task> CreateGemmTask(const ComputeEngine& engine,
+                                     const DenseSpecification& spec,
+                                     std::shared_ptr<Buffer> input,
+                                     std::shared_ptr<Buffer> output,
+                                     std::shared_ptr<Buffer> weights,
+                                     std::shared_ptr<Buffer> bias);
+
+// fully connected layer, output = activation(input * weights + bias) for a whole batch in one dispatch
+// input is Batch x Inputs, weights Inputs x Outputs, bias Outputs and output Batch x Outputs, row-major floats.
+// only the fp32 kernels apply, see InferenceNetwork for the reduced precision ones
+class Dense {
+public:
+    // input is usually the previous layer's Output(), device-local buffers are allocated for an empty input or
+    // output, a given output is e.g. placed by a MemoryPlanner
+    Dense(const ComputeEngine& engine,
+          const DenseSpecification& spec,
+          std::shared_ptr<Buffer> input = nullptr,
+          std::shared_ptr<Buffer> output = nullptr);
+
+    // uniform He/Xavier initialisation depending on the activation, bias starts at zero
+    void Initialize(ComputeEngine& engine, uint32_t seed);
+
+    const std::shared_ptr<Task>& Forward() const { return m_Forward; }
+    const std::shared_ptr<Buffer>& Input() const { return m_Forward->Src(); }
+    const std::shared_ptr<Buffer>& Output() const { return m_Forward->Dst(); }
+    const std::shared_ptr<Buffer>& Weights() const { return m_Weights; }
+    const std::shared_ptr<Buffer>& Bias() const { return m_Bias; }
+    const DenseSpecification& Specification() const { return m_Spec; }
+
+    // multiply-adds of one forward pass counted as two operations
+    double Flops() const { return 2.0 * m_Spec.Batch * m_Spec.Inputs * m_Spec.Outputs; }
+
+private:
+    DenseSpecification m_Spec;
+    std::shared_ptr<Buffer> m_Weights;
+    std::shared_ptr<Buffer> m_Bias;
+    std::shared_ptr<Task> m_Forward;
+};
+
+} // namespace nn
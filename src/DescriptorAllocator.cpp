@@ -0,0 +1,115 @@
+#include "DescriptorAllocator.hpp"
+#include <stdexcept>
+#include <utility>
+
+namespace nn {
+
+DescriptorSet::DescriptorSet(DescriptorSet&& other) noexcept
+    : m_Allocator(std::exchange(other.m_Allocator, nullptr)),
+      m_Pool(std::exchange(other.m_Pool, {})),
+      m_Set(std::exchange(other.m_Set, {})) {}
+
+DescriptorSet& DescriptorSet::operator=(DescriptorSet&& other) noexcept {
+    if (this != &other) {
+        if (m_Allocator) {
+            m_Allocator->free(*this);
+        }
+        m_Allocator = std::exchange(other.m_Allocator, nullptr);
+        m_Pool = std::exchange(other.m_Pool, {});
+        m_Set = std::exchange(other.m_Set, {});
+    }
+    return *this;
+}
+
+DescriptorSet::~DescriptorSet() {
+    if (m_Allocator) {
+        m_Allocator->free(*this);
+    }
+}
+
+DescriptorAllocator::DescriptorAllocator(vk::Device device, uint32_t setsPerPool)
+    : m_Device(device),
+      m_SetsPerPool(setsPerPool),
+      m_DescriptorsPerPool({
+          {vk::DescriptorType::eStorageBuffer, setsPerPool * 8},
+          {vk::DescriptorType::eUniformBuffer, setsPerPool * 2},
+      }) {}
+
+DescriptorSet DescriptorAllocator::Allocate(vk::DescriptorSetLayout layout,
+                                            const std::vector<vk::DescriptorSetLayoutBinding>& bindings) {
+    std::map<vk::DescriptorType, uint32_t> required;
+    for (const auto& binding : bindings) {
+        required[binding.descriptorType] += binding.descriptorCount;
+    }
+    for (auto [type, count] : required) {
+        auto it = m_DescriptorsPerPool.find(type);
+        if (it == m_DescriptorsPerPool.end() || count > it->second) {
+            throw std::runtime_error("descriptor set layout does not fit in a shared descriptor pool");
+        }
+    }
+
+    vk::DescriptorSetAllocateInfo descriptorSetAllocInfo = {
+        .sType = vk::StructureType::eDescriptorSetAllocateInfo,
+        .pNext = nullptr,
+        .descriptorPool = {},
+        .descriptorSetCount = 1,
+        .pSetLayouts = &layout,
+    };
+
+    std::lock_guard lock(m_Mutex);
+
+    // the newest pool is the likeliest to have room, a full or fragmented one moves on to the next
+    for (size_t i = m_Pools.size(); i-- > 0;) {
+        descriptorSetAllocInfo.descriptorPool = *m_Pools[i];
+        try {
+            DescriptorSet set;
+            set.m_Set = m_Device.allocateDescriptorSets(descriptorSetAllocInfo).front();
+            set.m_Pool = *m_Pools[i];
+            set.m_Allocator = this;
+            return set;
+        } catch (vk::OutOfPoolMemoryError&) {
+        } catch (vk::FragmentedPoolError&) {
+        }
+    }
+
+    descriptorSetAllocInfo.descriptorPool = createPool();
+    DescriptorSet set;
+    set.m_Set = m_Device.allocateDescriptorSets(descriptorSetAllocInfo).front();
+    set.m_Pool = descriptorSetAllocInfo.descriptorPool;
+    set.m_Allocator = this;
+    return set;
+}
+
+size_t DescriptorAllocator::PoolCount() const {
+    std::lock_guard lock(m_Mutex);
+    return m_Pools.size();
+}
+
+vk::DescriptorPool DescriptorAllocator::createPool() {
+    std::vector<vk::DescriptorPoolSize> poolSizes;
+    for (auto [type, count] : m_DescriptorsPerPool) {
+        poolSizes.push_back({
+            .type = type,
+            .descriptorCount = count,
+        });
+    }
+
+    vk::DescriptorPoolCreateInfo descriptorPoolCreateInfo = {
+        .sType = vk::StructureType::eDescriptorPoolCreateInfo,
+        .pNext = nullptr,
+        .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
+        .maxSets = m_SetsPerPool,
+        .poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
+        .pPoolSizes = poolSizes.data(),
+    };
+
+    m_Pools.push_back(m_Device.createDescriptorPoolUnique(descriptorPoolCreateInfo));
+    return *m_Pools.back();
+}
+
+void DescriptorAllocator::free(DescriptorSet& set) {
+    std::lock_guard lock(m_Mutex);
+    m_Device.freeDescriptorSets(set.m_Pool, {set.m_Set});
+}
+
+} // namespace nn
@@ -0,0 +1,59 @@
+#pragma once
+#define VULKAN_HPP_NO_STRUCT_CONSTRUCTORS 1
+#include <vulkan/vulkan.hpp>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace nn {
+
+class DescriptorAllocator;
+
+// a descriptor set handed back to the pool it came from when destroyed
+class DescriptorSet {
+public:
+    DescriptorSet() = default;
+    DescriptorSet(const DescriptorSet&) = delete;
+    void operator=(const DescriptorSet&) = delete;
+    DescriptorSet(DescriptorSet&& other) noexcept;
+    DescriptorSet& operator=(DescriptorSet&& other) noexcept;
+    ~DescriptorSet();
+
+    vk::DescriptorSet Handle() const { return m_Set; }
+    explicit operator bool() const { return bool(m_Set); }
+
+private:
+    friend class DescriptorAllocator;
+
+    DescriptorAllocator* m_Allocator = nullptr;
+    vk::DescriptorPool m_Pool;
+    vk::DescriptorSet m_Set;
+};
+
+// descriptor pools shared by every task, a new pool is opened once the current ones are full.
+// sets are freed individually so long lived tasks and short lived ones can share pools
+class DescriptorAllocator {
+public:
+    explicit DescriptorAllocator(vk::Device device, uint32_t setsPerPool = 256);
+    DescriptorAllocator(const DescriptorAllocator&) = delete;
+    void operator=(const DescriptorAllocator&) = delete;
+
+    // bindings must be the ones layout was created from, they size the request
+    DescriptorSet Allocate(vk::DescriptorSetLayout layout, const std::vector<vk::DescriptorSetLayoutBinding>& bindings);
+    size_t PoolCount() const;
+
+private:
+    vk::DescriptorPool createPool();
+    void free(DescriptorSet& set);
+
+    vk::Device m_Device;
+    uint32_t m_SetsPerPool;
+    std::map<vk::DescriptorType, uint32_t> m_DescriptorsPerPool; // per type, sized for a handful each set
+    std::vector<vk::UniqueDescriptorPool> m_Pools;
+    mutable std::mutex m_Mutex; // pools are externally synchronized for both allocation and free
+
+    friend class DescriptorSet;
+};
+
+} // namespace nn
@@ -0,0 +1,227 @@
+#include "DeviceAllocator.hpp"
+#include <algorithm>
+#include <optional>
+#include <utility>
+#include "Log.hpp"
+
+namespace nn {
+
+static vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment) {
+    return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+}
+
+Allocation::Allocation(Allocation&& other) noexcept
+    : m_Allocator(std::exchange(other.m_Allocator, nullptr)),
+      m_Block(std::exchange(other.m_Block, nullptr)),
+      m_Offset(std::exchange(other.m_Offset, 0)),
+      m_Size(std::exchange(other.m_Size, 0)) {}
+
+Allocation& Allocation::operator=(Allocation&& other) noexcept {
+    if (this != &other) {
+        if (m_Allocator) {
+            m_Allocator->free(*this);
+        }
+        m_Allocator = std::exchange(other.m_Allocator, nullptr);
+        m_Block = std::exchange(other.m_Block, nullptr);
+        m_Offset = std::exchange(other.m_Offset, 0);
+        m_Size = std::exchange(other.m_Size, 0);
+    }
+    return *this;
+}
+
+Allocation::~Allocation() {
+    if (m_Allocator) {
+        m_Allocator->free(*this);
+    }
+}
+
+DeviceAllocator::DeviceAllocator(vk::Device device, vk::PhysicalDevice gpu, vk::DeviceSize blockSize)
+    : m_Device(device),
+      m_MemoryProperties(gpu.getMemoryProperties()),
+      m_BlockSize(blockSize) {}
+
+Allocation DeviceAllocator::Allocate(const vk::MemoryRequirements& requirements, MemoryUsage usage) {
+    uint32_t memoryType = findMemoryType(requirements.memoryTypeBits, usage);
+    std::lock_guard lock(m_Mutex);
+
+    // anything larger than half a block gets its own allocation so it cannot strand a whole block
+    if (requirements.size > m_BlockSize / 2) {
+        MemoryBlock& block = createBlock(memoryType, requirements.size, true);
+        block.FreeRanges.clear();
+        block.AllocationCount = 1;
+
+        Allocation allocation;
+        allocation.m_Allocator = this;
+        allocation.m_Block = &block;
+        allocation.m_Offset = 0;
+        allocation.m_Size = requirements.size;
+        return allocation;
+    }
+
+    auto tryBlock = [&](MemoryBlock& block) -> std::optional<vk::DeviceSize> {
+        for (auto [offset, size] : block.FreeRanges) {
+            vk::DeviceSize aligned = alignUp(offset, requirements.alignment);
+            if (aligned + requirements.size <= offset + size) {
+                // split the free range around the aligned sub-range
+                block.FreeRanges.erase(offset);
+                if (aligned > offset) {
+                    block.FreeRanges.emplace(offset, aligned - offset);
+                }
+                if (aligned + requirements.size < offset + size) {
+                    block.FreeRanges.emplace(aligned + requirements.size, offset + size - aligned - requirements.size);
+                }
+                block.AllocationCount++;
+                return aligned;
+            }
+        }
+        return std::nullopt;
+    };
+
+    MemoryBlock* target = nullptr;
+    std::optional<vk::DeviceSize> offset;
+    for (auto& block : m_Blocks) {
+        if (block->MemoryType == memoryType && !block->Dedicated && (offset = tryBlock(*block))) {
+            target = block.get();
+            break;
+        }
+    }
+
+    if (!target) {
+        target = &createBlock(memoryType, m_BlockSize, false);
+        offset = tryBlock(*target);
+    }
+
+    Allocation allocation;
+    allocation.m_Allocator = this;
+    allocation.m_Block = target;
+    allocation.m_Offset = *offset;
+    allocation.m_Size = requirements.size;
+    return allocation;
+}
+
+void DeviceAllocator::Trim() {
+    std::lock_guard lock(m_Mutex);
+    std::erase_if(m_Blocks, [](const std::unique_ptr<MemoryBlock>& block) { return block->AllocationCount == 0; });
+}
+
+AllocatorStats DeviceAllocator::Stats() const {
+    std::lock_guard lock(m_Mutex);
+    AllocatorStats stats = {};
+    vk::DeviceSize bytesFree = 0;
+
+    for (const auto& block : m_Blocks) {
+        stats.BlockCount++;
+        stats.AllocationCount += block->AllocationCount;
+        stats.BytesReserved += block->Size;
+
+        vk::DeviceSize blockFree = 0;
+        for (auto [offset, size] : block->FreeRanges) {
+            blockFree += size;
+            stats.LargestFreeRange = std::max(stats.LargestFreeRange, size);
+        }
+        bytesFree += blockFree;
+        stats.BytesInUse += block->Size - blockFree;
+    }
+
+    stats.Fragmentation = bytesFree ? 1.0 - double(stats.LargestFreeRange) / double(bytesFree) : 0.0;
+    return stats;
+}
+
+uint32_t DeviceAllocator::findMemoryType(uint32_t typeBits, MemoryUsage usage) const {
+    using mp = vk::MemoryPropertyFlagBits;
+
+    vk::MemoryPropertyFlags required;
+    vk::MemoryPropertyFlags preferred;
+    switch (usage) {
+        case MemoryUsage::eDeviceLocal:
+            preferred = mp::eDeviceLocal;
+            break;
+        case MemoryUsage::eHostVisible:
+            required = mp::eHostVisible | mp::eHostCoherent;
+            preferred = mp::eDeviceLocal;
+            break;
+        case MemoryUsage::eReadback:
+            required = mp::eHostVisible | mp::eHostCoherent;
+            preferred = mp::eHostCached;
+            break;
+    }
+
+    uint32_t fallback = UINT32_MAX;
+    for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; i++) {
+        vk::MemoryPropertyFlags flags = m_MemoryProperties.memoryTypes[i].propertyFlags;
+        if (!(typeBits & (1u << i)) || (flags & required) != required) {
+            continue;
+        }
+        if ((flags & preferred) == preferred) {
+            return i;
+        }
+        if (fallback == UINT32_MAX) {
+            fallback = i;
+        }
+    }
+
+    if (fallback == UINT32_MAX) {
+        throw std::runtime_error("no memory type satisfies the requested usage");
+    }
+    return fallback;
+}
+
+MemoryBlock& DeviceAllocator::createBlock(uint32_t memoryType, vk::DeviceSize size, bool dedicated) {
+    vk::MemoryAllocateInfo memoryAllocInfo = {
+        .sType = vk::StructureType::eMemoryAllocateInfo,
+        .pNext = nullptr,
+        .allocationSize = size,
+        .memoryTypeIndex = memoryType,
+    };
+
+    auto block = std::make_unique<MemoryBlock>();
+    block->Memory = m_Device.allocateMemoryUnique(memoryAllocInfo);
+    block->Size = size;
+    block->MemoryType = memoryType;
+    block->Dedicated = dedicated;
+    block->AllocationCount = 0;
+    block->FreeRanges.emplace(0, size);
+
+    // coherent host visible blocks stay mapped for their whole lifetime, sub-allocations hand out offsets into
+    // it. a non-coherent type, which eDeviceLocal may get, is left unmapped and goes through the staging ring,
+    // so no mapped access ever needs a flush or an invalidate
+    vk::MemoryPropertyFlags coherent = vk::MemoryPropertyFlagBits::eHostVisible |
+                                       vk::MemoryPropertyFlagBits::eHostCoherent;
+    bool mappable = (m_MemoryProperties.memoryTypes[memoryType].propertyFlags & coherent) == coherent;
+    block->Mapped = mappable ? m_Device.mapMemory(*block->Memory, 0, VK_WHOLE_SIZE) : nullptr;
+
+    m_Blocks.push_back(std::move(block));
+    return *m_Blocks.back();
+}
+
+void DeviceAllocator::free(Allocation& allocation) {
+    std::lock_guard lock(m_Mutex);
+    MemoryBlock* block = allocation.m_Block;
+    block->AllocationCount--;
+
+    if (block->Dedicated) {
+        std::erase_if(m_Blocks, [block](const std::unique_ptr<MemoryBlock>& b) { return b.get() == block; });
+        return;
+    }
+
+    // return the range and coalesce with its neighbours
+    vk::DeviceSize offset = allocation.m_Offset;
+    vk::DeviceSize size = allocation.m_Size;
+
+    auto next = block->FreeRanges.lower_bound(offset);
+    if (next != block->FreeRanges.end() && offset + size == next->first) {
+        size += next->second;
+        next = block->FreeRanges.erase(next);
+    }
+    if (next != block->FreeRanges.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            offset = prev->first;
+            size += prev->second;
+            block->FreeRanges.erase(prev);
+        }
+    }
+    block->FreeRanges.emplace(offset, size);
+}
+
+} // namespace nn
@@ -0,0 +1,84 @@
+#pragma once
+#define VULKAN_HPP_NO_STRUCT_CONSTRUCTORS 1
+#include <vulkan/vulkan.hpp>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace nn {
+
+enum class MemoryUsage {
+    eDeviceLocal, // weights and activations, never touched by the host
+    eHostVisible, // staging and host written inputs, persistently mapped
+    eReadback,    // device written results read by the host, prefers cached memory
+};
+
+struct AllocatorStats {
+    size_t BlockCount;
+    size_t AllocationCount;
+    vk::DeviceSize BytesReserved; // sum of all block sizes
+    vk::DeviceSize BytesInUse;    // sum of all live sub-allocations
+    vk::DeviceSize LargestFreeRange;
+    double Fragmentation; // 1 - largest free range / total free bytes
+};
+
+class DeviceAllocator;
+
+struct MemoryBlock {
+    vk::UniqueDeviceMemory Memory;
+    vk::DeviceSize Size;
+    uint32_t MemoryType;
+    void* Mapped;
+    bool Dedicated;
+    size_t AllocationCount;
+    std::map<vk::DeviceSize, vk::DeviceSize> FreeRanges; // offset -> size
+};
+
+class Allocation {
+public:
+    Allocation() = default;
+    Allocation(const Allocation&) = delete;
+    void operator=(const Allocation&) = delete;
+    Allocation(Allocation&& other) noexcept;
+    Allocation& operator=(Allocation&& other) noexcept;
+    ~Allocation();
+
+    vk::DeviceMemory Memory() const { return m_Block ? *m_Block->Memory : vk::DeviceMemory{}; }
+    vk::DeviceSize Offset() const { return m_Offset; }
+    vk::DeviceSize Size() const { return m_Size; }
+    void* Mapped() const { return m_Block && m_Block->Mapped ? (char*)m_Block->Mapped + m_Offset : nullptr; }
+
+private:
+    friend class DeviceAllocator;
+
+    DeviceAllocator* m_Allocator = nullptr;
+    MemoryBlock* m_Block = nullptr;
+    vk::DeviceSize m_Offset = 0;
+    vk::DeviceSize m_Size = 0;
+};
+
+class DeviceAllocator {
+public:
+    DeviceAllocator(vk::Device device, vk::PhysicalDevice gpu, vk::DeviceSize blockSize = 64ull << 20);
+    DeviceAllocator(const DeviceAllocator&) = delete;
+    void operator=(const DeviceAllocator&) = delete;
+
+    Allocation Allocate(const vk::MemoryRequirements& requirements, MemoryUsage usage);
+    void Trim(); // releases blocks that hold no allocations
+    AllocatorStats Stats() const;
+
+private:
+    uint32_t findMemoryType(uint32_t typeBits, MemoryUsage usage) const;
+    MemoryBlock& createBlock(uint32_t memoryType, vk::DeviceSize size, bool dedicated);
+    void free(Allocation& allocation);
+
+    vk::Device m_Device;
+    vk::PhysicalDeviceMemoryProperties m_MemoryProperties;
+    vk::DeviceSize m_BlockSize;
+    std::vector<std::unique_ptr<MemoryBlock>> m_Blocks;
+    mutable std::mutex m_Mutex; // buffers are created and released from any thread
+
+    friend class Allocation;
+};
+
+} // namespace nn
@@ -0,0 +1,199 @@
+#include "GpuProfiler.hpp"
+#include <algorithm>
+#include <cstdio>
+#include "Log.hpp"
+
+namespace nn {
+
+namespace {
+
+constexpr size_t kernelSamples = 1 << 12;
+
+// kernel names are shader paths, which may hold quotes, backslashes or anything else a file name can
+std::string escaped(std::string_view text) {
+    std::string out;
+    out.reserve(text.size());
+    for (char c : text) {
+        switch (c) {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\r':
+                out += "\\r";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char code[7];
+                    std::snprintf(code, sizeof(code), "\\u%04x", static_cast<unsigned char>(c));
+                    out += code;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+GpuProfiler::GpuProfiler(vk::Device device, vk::PhysicalDevice gpu, uint32_t queueFamily, uint32_t capacity)
+    : m_Device(device),
+      m_Capacity(capacity),
+      m_TimestampPeriod(gpu.getProperties().limits.timestampPeriod),
+      m_ValidMask(0) {
+    if (capacity == 0) {
+        return;
+    }
+
+    uint32_t validBits = gpu.getQueueFamilyProperties()[queueFamily].timestampValidBits;
+    if (validBits == 0) {
+        LogWarning("compute queue does not support timestamps, GPU profiling disabled");
+        return;
+    }
+    m_ValidMask = validBits >= 64 ? UINT64_MAX : (uint64_t(1) << validBits) - 1;
+
+    vk::QueryPoolCreateInfo queryPoolCreateInfo = {
+        .sType = vk::StructureType::eQueryPoolCreateInfo,
+        .pNext = nullptr,
+        .flags = {},
+        .queryType = vk::QueryType::eTimestamp,
+        .queryCount = capacity,
+        .pipelineStatistics = {},
+    };
+
+    m_QueryPool = m_Device.createQueryPoolUnique(queryPoolCreateInfo);
+}
+
+std::optional<uint32_t> GpuProfiler::AllocateQueries() {
+    if (!Enabled()) {
+        return std::nullopt;
+    }
+    uint32_t query = m_NextQuery.load();
+    do {
+        if (query + 2 > m_Capacity) {
+            return std::nullopt;
+        }
+    } while (!m_NextQuery.compare_exchange_weak(query, query + 2));
+    return query;
+}
+
+void GpuProfiler::RecordBegin(vk::CommandBuffer commandBuffer, uint32_t query) const {
+    commandBuffer.resetQueryPool(*m_QueryPool, query, 2);
+    commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, *m_QueryPool, query);
+}
+
+void GpuProfiler::RecordEnd(vk::CommandBuffer commandBuffer, uint32_t query) const {
+    commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, *m_QueryPool, query + 1);
+}
+
+std::optional<std::pair<uint64_t, uint64_t>> GpuProfiler::ticks(uint32_t query) const {
+    uint64_t timestamps[2];
+    vk::Result result = m_Device.getQueryPoolResults(
+        *m_QueryPool, query, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+    if (result != vk::Result::eSuccess) {
+        return std::nullopt;
+    }
+    return std::pair(timestamps[0] & m_ValidMask, timestamps[1] & m_ValidMask);
+}
+
+std::optional<double> GpuProfiler::Collect(const std::string& kernel, uint32_t query) {
+    auto pair = ticks(query);
+    if (!pair) {
+        return std::nullopt;
+    }
+    auto [begin, end] = *pair;
+    double nanoseconds = duration(begin, end);
+
+    std::lock_guard lock(m_Mutex);
+    // reservoir sampling: the n-th dispatch replaces a random sample with probability kernelSamples / n
+    Samples& samples = m_Samples[kernel];
+    samples.Count++;
+    samples.MinNs = samples.Count == 1 ? nanoseconds : std::min(samples.MinNs, nanoseconds);
+    samples.TotalNs += nanoseconds;
+    if (samples.Reservoir.size() < kernelSamples) {
+        samples.Reservoir.push_back(nanoseconds);
+    } else if (size_t slot = std::uniform_int_distribution<size_t>(0, samples.Count - 1)(m_Reservoir);
+               slot < kernelSamples) {
+        samples.Reservoir[slot] = nanoseconds;
+    }
+    if (m_Events.size() < m_MaxEvents) {
+        m_Events.push_back({kernel, begin, end});
+    }
+    return nanoseconds;
+}
+
+std::optional<double> GpuProfiler::Read(uint32_t query) const {
+    auto pair = ticks(query);
+    if (!pair) {
+        return std::nullopt;
+    }
+    return duration(pair->first, pair->second);
+}
+
+std::map<std::string, KernelStats> GpuProfiler::Stats() const {
+    std::lock_guard lock(m_Mutex);
+    std::map<std::string, KernelStats> stats;
+    for (const auto& [kernel, samples] : m_Samples) {
+        std::vector<double> reservoir = samples.Reservoir;
+        size_t p99 = std::min(reservoir.size() - 1, size_t(double(reservoir.size()) * 0.99));
+        std::ranges::nth_element(reservoir, reservoir.begin() + ptrdiff_t(p99));
+
+        stats[kernel] = {
+            .Count = samples.Count,
+            .MinNs = samples.MinNs,
+            .MeanNs = samples.TotalNs / double(samples.Count),
+            .P99Ns = reservoir[p99],
+            .TotalNs = samples.TotalNs,
+        };
+    }
+    return stats;
+}
+
+void GpuProfiler::Reset() {
+    std::lock_guard lock(m_Mutex);
+    m_Samples.clear();
+    m_Events.clear();
+}
+
+void GpuProfiler::WriteJson(std::ostream& os) const {
+    os << "{\"kernels\":[";
+    bool first = true;
+    for (const auto& [kernel, stats] : Stats()) {
+        os << (first ? "" : ",") << "{\"name\":\"" << escaped(kernel) << "\",\"count\":" << stats.Count
+           << ",\"min_ns\":" << stats.MinNs << ",\"mean_ns\":" << stats.MeanNs << ",\"p99_ns\":" << stats.P99Ns
+           << ",\"total_ns\":" << stats.TotalNs << "}";
+        first = false;
+    }
+    os << "]}\n";
+}
+
+void GpuProfiler::WriteChromeTrace(std::ostream& os) const {
+    std::lock_guard lock(m_Mutex);
+    uint64_t origin = UINT64_MAX;
+    for (const auto& event : m_Events) {
+        origin = std::min(origin, event.Begin);
+    }
+
+    // complete events, timestamps in microseconds relative to the first dispatch
+    os << "{\"traceEvents\":[";
+    bool first = true;
+    for (const auto& event : m_Events) {
+        double ts = double((event.Begin - origin) & m_ValidMask) * m_TimestampPeriod / 1000.0;
+        double dur = double((event.End - event.Begin) & m_ValidMask) * m_TimestampPeriod / 1000.0;
+        os << (first ? "" : ",") << "{\"name\":\"" << escaped(event.Kernel) << "\",\"cat\":\"dispatch\",\"ph\":\"X\""
+           << ",\"ts\":" << ts << ",\"dur\":" << dur << ",\"pid\":0,\"tid\":0}";
+        first = false;
+    }
+    os << "],\"displayTimeUnit\":\"ns\"}\n";
+}
+
+} // namespace nn
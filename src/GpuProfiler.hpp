@@ -0,0 +1,84 @@
+#pragma once
+#define VULKAN_HPP_NO_STRUCT_CONSTRUCTORS 1
+#include <vulkan/vulkan.hpp>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace nn {
+
+struct KernelStats {
+    size_t Count;
+    double MinNs;
+    double MeanNs;
+    double P99Ns;
+    double TotalNs;
+};
+
+// per-dispatch GPU timestamps, each task owns a begin/end query pair in one engine wide pool
+class GpuProfiler {
+public:
+    GpuProfiler(vk::Device device, vk::PhysicalDevice gpu, uint32_t queueFamily, uint32_t capacity);
+    GpuProfiler(const GpuProfiler&) = delete;
+    void operator=(const GpuProfiler&) = delete;
+
+    bool Enabled() const { return bool(m_QueryPool); }
+    vk::QueryPool Pool() const { return *m_QueryPool; }
+
+    // first of two consecutive queries, nullopt once the pool is exhausted
+    std::optional<uint32_t> AllocateQueries();
+    void RecordBegin(vk::CommandBuffer commandBuffer, uint32_t query) const;
+    void RecordEnd(vk::CommandBuffer commandBuffer, uint32_t query) const;
+
+    // reads a completed query pair into the named kernel's stats and returns its duration
+    std::optional<double> Collect(const std::string& kernel, uint32_t query);
+    // the duration alone, for runs that must not show up in the stats, e.g. autotuning
+    std::optional<double> Read(uint32_t query) const;
+
+    std::map<std::string, KernelStats> Stats() const;
+    void Reset();
+
+    void WriteJson(std::ostream& os) const;
+    void WriteChromeTrace(std::ostream& os) const; // chrome://tracing or ui.perfetto.dev
+
+private:
+    // begin and end in device ticks, nullopt while the pair is not available
+    std::optional<std::pair<uint64_t, uint64_t>> ticks(uint32_t query) const;
+    double duration(uint64_t begin, uint64_t end) const {
+        return double((end - begin) & m_ValidMask) * m_TimestampPeriod;
+    }
+
+    // exact count, min and total, the p99 comes from a fixed size reservoir so long runs stay bounded
+    struct Samples {
+        size_t Count = 0;
+        double MinNs = 0.0;
+        double TotalNs = 0.0;
+        std::vector<double> Reservoir; // nanoseconds
+    };
+
+    struct Event {
+        std::string Kernel;
+        uint64_t Begin; // device ticks
+        uint64_t End;
+    };
+
+    vk::Device m_Device;
+    vk::UniqueQueryPool m_QueryPool;
+    uint32_t m_Capacity;
+    std::atomic<uint32_t> m_NextQuery = 0;
+    double m_TimestampPeriod; // nanoseconds per tick
+    uint64_t m_ValidMask;
+
+    mutable std::mutex m_Mutex; // guards the samples and events, tasks retire on whichever thread waits
+    std::map<std::string, Samples> m_Samples;
+    std::minstd_rand m_Reservoir; // picks which sample a new dispatch replaces once a kernel's reservoir is full
+    std::vector<Event> m_Events;
+    size_t m_MaxEvents = 1 << 16;
+};
+
+} // namespace nn
@@ -0,0 +1,364 @@
+#include "InferenceNetwork.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace nn {
+
+namespace {
+
+GemmKernel kernelFor(Precision precision) {
+    switch (precision) {
+        case Precision::eFloat16:
+            return GemmKernel::eTiledFloat16;
+        case Precision::eInt8:
+            return GemmKernel::eTiledInt8;
+        default:
+            return GemmKernel::eTiled;
+    }
+}
+
+// converts floats into the bytes of a buffer stored at the given precision
+std::vector<uint8_t> encode(std::span<const float> values, Precision precision, float scale) {
+    std::vector<uint8_t> bytes(values.size() * PrecisionSize(precision));
+    switch (precision) {
+        case Precision::eFloat16:
+            FloatToHalf(values, {(uint16_t*)bytes.data(), values.size()});
+            break;
+        case Precision::eInt8:
+            Quantize(values, scale, {(int8_t*)bytes.data(), values.size()});
+            break;
+        default:
+            std::memcpy(bytes.data(), values.data(), values.size_bytes());
+            break;
+    }
+    return bytes;
+}
+
+void decode(std::span<const uint8_t> bytes, Precision precision, float scale, std::span<float> values) {
+    switch (precision) {
+        case Precision::eFloat16:
+            HalfToFloat({(const uint16_t*)bytes.data(), values.size()}, values);
+            break;
+        case Precision::eInt8:
+            Dequantize({(const int8_t*)bytes.data(), values.size()}, scale, values);
+            break;
+        default:
+            std::memcpy(values.data(), bytes.data(), values.size_bytes());
+            break;
+    }
+}
+
+} // namespace
+
+InferenceNetwork::InferenceNetwork(ComputeEngine& engine,
+                                   const std::vector<std::unique_ptr<Dense>>& layers,
+                                   Precision precision,
+                                   std::span<const float> calibration)
+    : m_Engine(&engine),
+      m_Precision(precision),
+      m_Batch(layers.empty() ? 0 : layers.front()->Specification().Batch),
+      m_ActivationScales(layers.size() + 1, 1.0f) {
+    if (layers.empty()) {
+        throw std::runtime_error("an inference network needs at least one layer");
+    }
+    if (precision == Precision::eInt8) {
+        calibrate(layers, calibration);
+    }
+
+    m_Activations.push_back(engine.CreateBuffer(size_t(m_Batch) * layers.front()->Specification().Inputs,
+                                                PrecisionSize(precision),
+                                                MemoryUsage::eDeviceLocal));
+
+    for (const auto& layer : layers) {
+        const DenseSpecification& spec = layer->Specification();
+        std::vector<float> weights(size_t(spec.Inputs) * spec.Outputs);
+        std::vector<float> bias(spec.Outputs);
+        engine.Download(*layer->Weights(), std::span<float>(weights));
+        engine.Download(*layer->Bias(), std::span<float>(bias));
+
+        float weightScale = SymmetricScale(weights);
+        addLayer(spec, weightScale);
+        std::vector<uint8_t> encoded = encode(weights, precision, weightScale);
+        engine.Upload(*m_Weights.back(), std::span<const uint8_t>(encoded));
+        engine.Upload(*m_Biases.back(), std::span<const float>(bias));
+    }
+}
+
+InferenceNetwork::InferenceNetwork(ComputeEngine& engine,
+                                   const ModelFile& model,
+                                   uint32_t batch,
+                                   const std::string& shaderDirectory)
+    : m_Engine(&engine),
+      m_Precision(model.Layers().front().Storage),
+      m_Batch(batch) {
+    std::span<const ModelLayer> records = model.Layers();
+    if (batch == 0) {
+        throw std::runtime_error("an inference network needs a batch of at least one");
+    }
+    if (std::ranges::any_of(records, [&](const ModelLayer& layer) { return layer.Storage != m_Precision; })) {
+        throw std::runtime_error("every layer of an inference network has the same precision");
+    }
+
+    for (const ModelLayer& layer : records) {
+        m_ActivationScales.push_back(layer.InputScale);
+    }
+    m_ActivationScales.push_back(model.OutputScale());
+    m_Activations.push_back(engine.CreateBuffer(
+        size_t(m_Batch) * records.front().Inputs, PrecisionSize(m_Precision), MemoryUsage::eDeviceLocal));
+
+    SubmitHandle loaded = {};
+    for (size_t i = 0; i < records.size(); i++) {
+        addLayer(
+            {
+                .Inputs = records[i].Inputs,
+                .Outputs = records[i].Outputs,
+                .Batch = batch,
+                .Function = records[i].Function,
+                .Kernel = GemmKernel::eTiled,
+                .ShaderDirectory = shaderDirectory,
+            },
+            records[i].WeightScale);
+        for (SubmitHandle submitted : {model.Upload(engine, model.Weights(i), *m_Weights.back()),
+                                       model.Upload(engine, model.Bias(i), *m_Biases.back())}) {
+            loaded = submitted.Value ? submitted : loaded;
+        }
+    }
+
+    // an imported copy reads the mapping, which the caller may unmap as soon as this returns
+    engine.Wait(loaded);
+}
+
+InferenceNetwork::InferenceNetwork(ComputeBackend& backend, const ModelFile& model, uint32_t batch)
+    : m_Backend(&backend),
+      m_Precision(Precision::eFloat32),
+      m_Batch(batch) {
+    std::span<const ModelLayer> records = model.Layers();
+    if (batch == 0) {
+        throw std::runtime_error("an inference network needs a batch of at least one");
+    }
+    if (std::ranges::any_of(records, [](const ModelLayer& layer) { return layer.Storage != Precision::eFloat32; })) {
+        throw std::runtime_error("a network on a compute backend runs fp32 models only");
+    }
+
+    m_ActivationScales.assign(records.size() + 1, 1.0f);
+    m_Tensors.push_back(backend.CreateTensor(batch, records.front().Inputs));
+
+    // the blobs are fp32 already, copied out of the mapping since a blob's offset need not be float aligned
+    std::vector<float> values;
+    for (size_t i = 0; i < records.size(); i++) {
+        const ModelLayer& layer = records[i];
+        m_Layers.push_back({
+            .Inputs = layer.Inputs,
+            .Outputs = layer.Outputs,
+            .Batch = batch,
+            .Function = layer.Function,
+        });
+        m_WeightScales.push_back(1.0f);
+
+        std::unique_ptr<Tensor> weights = backend.CreateTensor(layer.Inputs, layer.Outputs);
+        std::unique_ptr<Tensor> bias = backend.CreateTensor(1, layer.Outputs);
+        for (auto [tensor, blob] : {std::pair(weights.get(), model.Weights(i)), std::pair(bias.get(), model.Bias(i))}) {
+            if (blob.size() != tensor->Count() * sizeof(float)) {
+                throw std::runtime_error("model layer " + std::to_string(i) + " does not match its shape");
+            }
+            values.resize(tensor->Count());
+            std::memcpy(values.data(), blob.data(), blob.size());
+            backend.Write(*tensor, values);
+        }
+        m_ParameterBytes += (weights->Count() + bias->Count()) * sizeof(float);
+
+        m_Tensors.push_back(std::move(weights));
+        m_Tensors.push_back(std::move(bias));
+        m_Tensors.push_back(backend.CreateTensor(batch, layer.Outputs));
+    }
+    backend.Finish();
+}
+
+void InferenceNetwork::addLayer(DenseSpecification spec, float weightScale) {
+    const size_t elementSize = PrecisionSize(m_Precision);
+    const size_t i = m_Weights.size();
+    spec.Kernel = kernelFor(m_Precision);
+
+    m_Weights.push_back(
+        m_Engine->CreateBuffer(size_t(spec.Inputs) * spec.Outputs, elementSize, MemoryUsage::eDeviceLocal));
+    m_Biases.push_back(m_Engine->CreateBuffer(spec.Outputs, sizeof(float), MemoryUsage::eDeviceLocal));
+    m_ParameterBytes += m_Weights.back()->Bytes() + m_Biases.back()->Bytes();
+    m_Layers.push_back(spec);
+    m_WeightScales.push_back(weightScale);
+
+    m_Activations.push_back(
+        m_Engine->CreateBuffer(size_t(m_Batch) * spec.Outputs, elementSize, MemoryUsage::eDeviceLocal));
+    std::shared_ptr<Task> task =
+        CreateGemmTask(*m_Engine, spec, m_Activations[i], m_Activations[i + 1], m_Weights[i], m_Biases[i]);
+    if (m_Precision == Precision::eInt8) {
+        task->SetPushConstants(GemmScales{
+            .Input = m_ActivationScales[i],
+            .Weights = weightScale,
+            .Output = m_ActivationScales[i + 1],
+        });
+    }
+    m_Graph.Add(task);
+}
+
+void InferenceNetwork::Save(const std::string& path) const {
+    std::vector<std::vector<uint8_t>> weights, biases;
+    std::vector<ModelLayerData> data;
+    weights.reserve(m_Layers.size());
+    biases.reserve(m_Layers.size());
+    for (size_t i = 0; i < m_Layers.size(); i++) {
+        if (m_Backend) {
+            const Tensor& weightTensor = *m_Tensors[3 * i + 1];
+            const Tensor& biasTensor = *m_Tensors[3 * i + 2];
+            weights.emplace_back(weightTensor.Count() * sizeof(float));
+            biases.emplace_back(biasTensor.Count() * sizeof(float));
+            m_Backend->Read(weightTensor, {(float*)weights.back().data(), weightTensor.Count()});
+            m_Backend->Read(biasTensor, {(float*)biases.back().data(), biasTensor.Count()});
+        } else {
+            weights.emplace_back(m_Weights[i]->Bytes());
+            biases.emplace_back(m_Biases[i]->Bytes());
+            m_Engine->Download(*m_Weights[i], std::span<uint8_t>(weights.back()));
+            m_Engine->Download(*m_Biases[i], std::span<uint8_t>(biases.back()));
+        }
+
+        data.push_back({
+            .Inputs = m_Layers[i].Inputs,
+            .Outputs = m_Layers[i].Outputs,
+            .Function = m_Layers[i].Function,
+            .Storage = m_Precision,
+            .InputScale = m_ActivationScales[i],
+            .WeightScale = m_WeightScales[i],
+            .Weights = weights.back(),
+            .Bias = biases.back(),
+        });
+    }
+    WriteModel(path, data, m_ActivationScales.back());
+}
+
+void InferenceNetwork::calibrate(const std::vector<std::unique_ptr<Dense>>& layers,
+                                 std::span<const float> calibration) {
+    const size_t batchSize = size_t(m_Batch) * layers.front()->Specification().Inputs;
+    if (calibration.empty() || calibration.size() % batchSize != 0) {
+        throw std::runtime_error("int8 calibration needs one or more whole batches of inputs");
+    }
+
+    // one graph per layer, a trainer's planned activations share memory and a layer's output only holds until
+    // the next layers have run
+    std::vector<TaskGraph> graphs(layers.size());
+    for (size_t i = 0; i < layers.size(); i++) {
+        graphs[i].Add(layers[i]->Forward());
+    }
+
+    // the largest magnitude seen at every layer boundary over all calibration batches
+    std::vector<float> maxMagnitudes(layers.size() + 1, 0.0f);
+    std::vector<float> output;
+    for (size_t offset = 0; offset < calibration.size(); offset += batchSize) {
+        std::span<const float> batch = calibration.subspan(offset, batchSize);
+        for (float value : batch) {
+            maxMagnitudes[0] = std::max(maxMagnitudes[0], std::abs(value));
+        }
+
+        m_Engine->Upload(*layers.front()->Input(), batch);
+        for (size_t i = 0; i < layers.size(); i++) {
+            m_Engine->Wait(m_Engine->ExecuteGraph(graphs[i]));
+            output.resize(size_t(m_Batch) * layers[i]->Specification().Outputs);
+            m_Engine->Download(*layers[i]->Output(), std::span<float>(output));
+            for (float value : output) {
+                maxMagnitudes[i + 1] = std::max(maxMagnitudes[i + 1], std::abs(value));
+            }
+        }
+    }
+
+    std::ranges::transform(maxMagnitudes, m_ActivationScales.begin(), [](float magnitude) {
+        return SymmetricScale(magnitude);
+    });
+}
+
+void InferenceNetwork::Forward(std::span<const float> input, std::span<float> output) {
+    if (input.size() != size_t(m_Batch) * Inputs() || output.size() != size_t(m_Batch) * Outputs()) {
+        throw std::runtime_error("input or output does not match the network's batch");
+    }
+
+    // the backend queues every layer and the read waits for them, activations are already fp32
+    if (m_Backend) {
+        m_Backend->Write(*m_Tensors.front(), input);
+        for (size_t i = 0; i < m_Layers.size(); i++) {
+            m_Backend->Gemm(*m_Tensors[3 * i],
+                            *m_Tensors[3 * i + 1],
+                            *m_Tensors[3 * i + 2],
+                            *m_Tensors[3 * i + 3],
+                            m_Layers[i].Function);
+        }
+        m_Backend->Read(*m_Tensors.back(), output);
+        return;
+    }
+
+    std::vector<uint8_t> encoded = encode(input, m_Precision, m_ActivationScales.front());
+    m_Engine->Upload(*m_Activations.front(), std::span<const uint8_t>(encoded));
+    m_Engine->Wait(m_Engine->ExecuteGraph(m_Graph));
+
+    std::vector<uint8_t> result(m_Activations.back()->Bytes());
+    m_Engine->Download(*m_Activations.back(), std::span<uint8_t>(result));
+    decode(result, m_Precision, m_ActivationScales.back(), output);
+}
+
+Evaluation InferenceNetwork::Evaluate(std::span<const float> inputs, std::span<const uint8_t> labels) {
+    if (labels.empty() || inputs.size() != labels.size() * Inputs()) {
+        throw std::runtime_error("evaluation needs Inputs() values for every label");
+    }
+    if (!m_Engine) {
+        throw std::runtime_error("device evaluation needs a network on the compute engine");
+    }
+
+    const size_t batchCount = (labels.size() + m_Batch - 1) / m_Batch;
+    std::shared_ptr<Buffer> labelBuffer =
+        m_Engine->CreateBuffer((m_Batch + 3) / 4, sizeof(uint32_t), MemoryUsage::eHostVisible);
+    std::shared_ptr<Buffer> totals = m_Engine->CreateBuffer(2 * batchCount, sizeof(float), MemoryUsage::eReadback);
+    std::shared_ptr<Task> evaluate = CreateEvaluateTask(*m_Engine,
+                                                        {
+                                                            .Rows = m_Batch,
+                                                            .Cols = Outputs(),
+                                                            .Storage = m_Precision,
+                                                            .Scale = m_ActivationScales.back(),
+                                                            .ShaderDirectory = m_Layers.back().ShaderDirectory,
+                                                        },
+                                                        m_Activations.back(),
+                                                        labelBuffer,
+                                                        totals);
+    TaskGraph graph = m_Graph;
+    graph.Add(evaluate);
+
+    // a short final batch is padded with zeros and only its leading rows count
+    std::vector<float> batch(size_t(m_Batch) * Inputs());
+    for (size_t i = 0; i < batchCount; i++) {
+        size_t first = i * m_Batch;
+        size_t count = std::min<size_t>(m_Batch, labels.size() - first);
+        std::ranges::copy(inputs.subspan(first * Inputs(), count * Inputs()), batch.begin());
+        std::fill(batch.begin() + count * Inputs(), batch.end(), 0.0f);
+        std::ranges::copy(labels.subspan(first, count), labelBuffer->View<uint8_t>().begin());
+
+        std::vector<uint8_t> encoded = encode(batch, m_Precision, m_ActivationScales.front());
+        m_Engine->Upload(*m_Activations.front(), std::span<const uint8_t>(encoded));
+        evaluate->SetPushConstants(EvaluateSlot{
+            .Slot = uint32_t(i),
+            .Count = uint32_t(count),
+        });
+        m_Engine->Wait(m_Engine->ExecuteGraph(graph));
+    }
+
+    float loss = 0.0f;
+    float correct = 0.0f;
+    std::span<const float> sums = totals->View<float>();
+    for (size_t i = 0; i < batchCount; i++) {
+        loss += sums[2 * i];
+        correct += sums[2 * i + 1];
+    }
+    return {
+        .Loss = loss / float(labels.size()),
+        .Accuracy = correct / float(labels.size()),
+        .Samples = labels.size(),
+    };
+}
+
+} // namespace nn
@@ -0,0 +1,80 @@
+#pragma once
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+#include "ComputeBackend.hpp"
+#include "ComputeEngine.hpp"
+#include "Dense.hpp"
+#include "ModelFile.hpp"
+#include "Quantization.hpp"
+#include "Reduction.hpp"
+#include "TaskGraph.hpp"
+
+namespace nn {
+
+struct Evaluation {
+    float Loss;     // mean cross-entropy over the samples
+    float Accuracy; // fraction classified correctly
+    size_t Samples;
+};
+
+// inference-only copy of trained dense layers with weights and activations stored at reduced precision.
+// int8 uses symmetric per-tensor scales, the weights' from their own range and the activations' from a
+// calibration pass through the fp32 layers. an fp32 model can also run on any ComputeBackend instead of the
+// engine, e.g. the cpu on a node without a GPU
+class InferenceNetwork {
+public:
+    // calibration holds whole batches of Batch x Inputs floats and is only needed for int8. it runs through
+    // the given layers, which overwrites their input and output buffers
+    InferenceNetwork(ComputeEngine& engine,
+                     const std::vector<std::unique_ptr<Dense>>& layers,
+                     Precision precision,
+                     std::span<const float> calibration = {});
+    // a saved network at the precision it was saved in, the blobs go from the mapping to the device untouched
+    InferenceNetwork(ComputeEngine& engine,
+                     const ModelFile& model,
+                     uint32_t batch,
+                     const std::string& shaderDirectory = "tests/spirv");
+    // a saved fp32 network on a backend, through its Gemm alone. Evaluate needs the engine
+    InferenceNetwork(ComputeBackend& backend, const ModelFile& model, uint32_t batch);
+
+    // the weights as stored, with the scales, so loading needs neither the fp32 layers nor calibration data
+    void Save(const std::string& path) const;
+
+    // input is Batch x Inputs, output Batch x the last layer's Outputs, both converted on the host
+    void Forward(std::span<const float> input, std::span<float> output);
+    // any number of samples with one label byte each, Inputs() floats per sample. the loss and accuracy are
+    // reduced on the device batch by batch and read back once at the end, two floats per batch, instead of
+    // every logit. needs ComputeEngine::HasSubgroupArithmetic
+    Evaluation Evaluate(std::span<const float> inputs, std::span<const uint8_t> labels);
+
+    Precision Mode() const { return m_Precision; }
+    uint32_t Batch() const { return m_Batch; }
+    uint32_t Inputs() const { return m_Layers.front().Inputs; } // per sample
+    uint32_t Outputs() const { return m_Layers.back().Outputs; }
+    size_t ParameterBytes() const { return m_ParameterBytes; }
+    // scale of the input to layer i, the last entry is the network's output, all 1 unless int8
+    const std::vector<float>& ActivationScales() const { return m_ActivationScales; }
+
+private:
+    // allocates the layer's parameters and output and adds its gemm, the input is the last activation
+    void addLayer(DenseSpecification spec, float weightScale);
+    void calibrate(const std::vector<std::unique_ptr<Dense>>& layers, std::span<const float> calibration);
+
+    ComputeEngine* m_Engine = nullptr;   // exactly one of the two is set
+    ComputeBackend* m_Backend = nullptr; // fp32 only, the tensors below stand in for the buffers
+    Precision m_Precision;
+    uint32_t m_Batch;
+    std::vector<std::shared_ptr<Buffer>> m_Activations; // input of every layer followed by the output
+    std::vector<std::shared_ptr<Buffer>> m_Weights;
+    std::vector<std::shared_ptr<Buffer>> m_Biases;
+    std::vector<std::unique_ptr<Tensor>> m_Tensors; // the input, then every layer's weights, bias and output
+    std::vector<DenseSpecification> m_Layers;
+    std::vector<float> m_WeightScales;
+    std::vector<float> m_ActivationScales;
+    size_t m_ParameterBytes = 0;
+    TaskGraph m_Graph;
+};
+
+} // namespace nn
@@ -0,0 +1,170 @@
+#include "InferenceServer.hpp"
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+namespace nn {
+
+namespace {
+
+// latencies kept for the percentiles, a server under sustained load keeps a uniform sample instead of all
+constexpr size_t latencySamples = 1 << 14;
+
+} // namespace
+
+InferenceServer::InferenceServer(InferenceNetwork& network, std::chrono::microseconds maxLatency)
+    : m_Network(network),
+      m_MaxLatency(maxLatency),
+      m_StatsStart(Clock::now()),
+      m_Worker([this] { run(); }) {}
+
+InferenceServer::~InferenceServer() {
+    {
+        std::lock_guard lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_Condition.notify_all();
+    m_Worker.join();
+}
+
+std::future<std::vector<float>> InferenceServer::Infer(std::span<const float> sample) {
+    if (sample.size() != Inputs()) {
+        throw std::runtime_error("a sample must have as many values as the network has inputs");
+    }
+
+    Request request = {
+        .Sample = {sample.begin(), sample.end()},
+        .Result = {},
+        .Arrival = Clock::now(),
+    };
+    std::future<std::vector<float>> result = request.Result.get_future();
+
+    bool wake;
+    {
+        std::lock_guard lock(m_Mutex);
+        m_Pending.push_back(std::move(request));
+        // the worker sleeps until the first request arrives or the batch fills, anything between changes nothing
+        wake = m_Pending.size() == 1 || m_Pending.size() >= m_Network.Batch();
+    }
+    if (wake) {
+        m_Condition.notify_one();
+    }
+    return result;
+}
+
+void InferenceServer::run() {
+    const size_t batch = m_Network.Batch();
+    std::vector<float> input(batch * Inputs());
+    std::vector<float> output(batch * Outputs());
+    std::vector<Request> requests;
+
+    while (true) {
+        {
+            std::unique_lock lock(m_Mutex);
+            m_Condition.wait(lock, [&] { return m_Stop || !m_Pending.empty(); });
+            if (m_Pending.empty()) {
+                return;
+            }
+
+            // the oldest request sets the deadline, whatever arrived by then shares its batch
+            Clock::time_point deadline = m_Pending.front().Arrival + m_MaxLatency;
+            m_Condition.wait_until(lock, deadline, [&] { return m_Stop || m_Pending.size() >= batch; });
+
+            size_t count = std::min(batch, m_Pending.size());
+            std::move(m_Pending.begin(), m_Pending.begin() + count, std::back_inserter(requests));
+            m_Pending.erase(m_Pending.begin(), m_Pending.begin() + count);
+        }
+
+        // rows past the last request are zero, the network always runs its full batch
+        for (size_t i = 0; i < requests.size(); i++) {
+            std::ranges::copy(requests[i].Sample, input.begin() + i * Inputs());
+        }
+        std::fill(input.begin() + requests.size() * Inputs(), input.end(), 0.0f);
+
+        try {
+            m_Network.Forward(input, output);
+        } catch (...) {
+            for (Request& request : requests) {
+                request.Result.set_exception(std::current_exception());
+            }
+            requests.clear();
+            continue;
+        }
+
+        // counted before the results are handed out, a caller reading the stats then sees its own request
+        Clock::time_point finish = Clock::now();
+        {
+            std::lock_guard lock(m_StatsMutex);
+            for (const Request& request : requests) {
+                recordLatency(std::chrono::duration<double, std::milli>(finish - request.Arrival).count());
+            }
+            m_Batches++;
+        }
+
+        for (size_t i = 0; i < requests.size(); i++) {
+            auto row = output.begin() + i * Outputs();
+            requests[i].Result.set_value({row, row + Outputs()});
+        }
+        requests.clear();
+    }
+}
+
+void InferenceServer::recordLatency(double milliseconds) {
+    // reservoir sampling: the n-th request replaces a random sample with probability latencySamples / n
+    m_Requests++;
+    m_LongestLatency = std::max(m_LongestLatency, milliseconds);
+    if (m_Latencies.size() < latencySamples) {
+        m_Latencies.push_back(milliseconds);
+    } else if (size_t slot = std::uniform_int_distribution<size_t>(0, m_Requests - 1)(m_Reservoir);
+               slot < latencySamples) {
+        m_Latencies[slot] = milliseconds;
+    }
+}
+
+ServerStats InferenceServer::Stats() const {
+    std::vector<double> latencies;
+    size_t requests;
+    size_t batches;
+    double longest;
+    double seconds;
+    {
+        std::lock_guard lock(m_StatsMutex);
+        latencies = m_Latencies;
+        requests = m_Requests;
+        batches = m_Batches;
+        longest = m_LongestLatency;
+        seconds = std::chrono::duration<double>(Clock::now() - m_StatsStart).count();
+    }
+
+    auto percentile = [&](double p) {
+        if (latencies.empty()) {
+            return 0.0;
+        }
+        auto nth = latencies.begin() + std::min(latencies.size() - 1, size_t(p * double(latencies.size())));
+        std::nth_element(latencies.begin(), nth, latencies.end());
+        return *nth;
+    };
+
+    return {
+        .Requests = requests,
+        .Batches = batches,
+        .BatchFill = batches ? double(requests) / double(batches * m_Network.Batch()) : 0.0,
+        .Seconds = seconds,
+        .RequestsPerSecond = seconds > 0.0 ? double(requests) / seconds : 0.0,
+        .P50 = percentile(0.50),
+        .P95 = percentile(0.95),
+        .P99 = percentile(0.99),
+        .Max = longest,
+    };
+}
+
+void InferenceServer::ResetStats() {
+    std::lock_guard lock(m_StatsMutex);
+    m_Latencies.clear();
+    m_Requests = 0;
+    m_LongestLatency = 0.0;
+    m_Batches = 0;
+    m_StatsStart = Clock::now();
+}
+
+} // namespace nn
@@ -0,0 +1,80 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <random>
+#include <span>
+#include <thread>
+#include <vector>
+#include "InferenceNetwork.hpp"
+
+namespace nn {
+
+struct ServerStats {
+    size_t Requests;
+    size_t Batches;
+    double BatchFill; // mean requests per batch over the network's batch size
+    double Seconds;   // since the server started or the stats were last reset
+    double RequestsPerSecond;
+    // milliseconds from Infer to the result being ready, 0 when nothing was served. the percentiles come from a
+    // uniform sample of a bounded number of requests, Max is exact
+    double P50;
+    double P95;
+    double P99;
+    double Max;
+};
+
+// groups single samples from any number of threads into batches of the network's size. a batch goes out once it
+// is full or its oldest request has waited maxLatency, so latency is bounded by maxLatency plus one forward pass
+class InferenceServer {
+public:
+    // the network is used from the server's own thread only, nothing else may run it meanwhile
+    InferenceServer(InferenceNetwork& network, std::chrono::microseconds maxLatency = std::chrono::milliseconds(2));
+    InferenceServer(const InferenceServer&) = delete;
+    void operator=(const InferenceServer&) = delete;
+    // requests already queued are still served
+    ~InferenceServer();
+
+    // sample is Inputs() floats, the result Outputs() floats. a failed forward pass is rethrown by the future
+    std::future<std::vector<float>> Infer(std::span<const float> sample);
+
+    uint32_t Inputs() const { return m_Network.Inputs(); }
+    uint32_t Outputs() const { return m_Network.Outputs(); }
+    ServerStats Stats() const;
+    void ResetStats();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Request {
+        std::vector<float> Sample;
+        std::promise<std::vector<float>> Result;
+        Clock::time_point Arrival;
+    };
+
+    void run();
+    // called with the stats lock held
+    void recordLatency(double milliseconds);
+
+    InferenceNetwork& m_Network;
+    std::chrono::microseconds m_MaxLatency;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_Condition;
+    std::deque<Request> m_Pending;
+    bool m_Stop = false;
+
+    mutable std::mutex m_StatsMutex;
+    std::vector<double> m_Latencies; // milliseconds, a reservoir sample of the served requests
+    std::minstd_rand m_Reservoir;    // picks which sample a new request replaces once the reservoir is full
+    size_t m_Requests = 0;
+    double m_LongestLatency = 0.0;
+    size_t m_Batches = 0;
+    Clock::time_point m_StatsStart;
+
+    std::thread m_Worker;
+};
+
+} // namespace nn
@@ -0,0 +1,104 @@
+#include "MemoryPlanner.hpp"
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+namespace nn {
+
+MemoryPlanner::TensorId MemoryPlanner::AddTensor(size_t count, size_t size) {
+    m_Tensors.push_back({
+        .Count = count,
+        .Size = size,
+        .FirstStep = SIZE_MAX,
+        .LastStep = 0,
+    });
+    return m_Tensors.size() - 1;
+}
+
+void MemoryPlanner::AddStep(const std::vector<TensorId>& tensors) {
+    for (TensorId id : tensors) {
+        Tensor& tensor = m_Tensors.at(id);
+        tensor.FirstStep = std::min(tensor.FirstStep, m_Steps);
+        tensor.LastStep = m_Steps;
+    }
+    m_Steps++;
+}
+
+MemoryPlan MemoryPlanner::Plan(vk::DeviceSize alignment) const {
+    // a buffer takes whole uints on the device, see Buffer::Range
+    alignment = std::max<vk::DeviceSize>(alignment, 4);
+    auto alignedBytes = [&](const Tensor& tensor) {
+        return (vk::DeviceSize(tensor.Count) * tensor.Size + alignment - 1) / alignment * alignment;
+    };
+    auto overlapping = [](const Tensor& a, const Tensor& b) {
+        return a.FirstStep <= b.LastStep && b.FirstStep <= a.LastStep;
+    };
+
+    MemoryPlan plan;
+    plan.Offsets.resize(m_Tensors.size());
+
+    std::vector<TensorId> order(m_Tensors.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::ranges::stable_sort(order, [&](TensorId a, TensorId b) {
+        return alignedBytes(m_Tensors[a]) > alignedBytes(m_Tensors[b]);
+    });
+
+    // ranges taken by placed tensors that are live together with the one being placed, sorted by offset
+    std::vector<TensorId> placed;
+    std::vector<std::pair<vk::DeviceSize, vk::DeviceSize>> taken;
+    for (TensorId id : order) {
+        const Tensor& tensor = m_Tensors[id];
+        vk::DeviceSize bytes = alignedBytes(tensor);
+        plan.UnplannedBytes += bytes;
+        if (tensor.FirstStep == SIZE_MAX) {
+            throw std::runtime_error("a planned tensor is not used by any step");
+        }
+
+        taken.clear();
+        for (TensorId other : placed) {
+            if (overlapping(tensor, m_Tensors[other])) {
+                taken.push_back({plan.Offsets[other], plan.Offsets[other] + alignedBytes(m_Tensors[other])});
+            }
+        }
+        std::ranges::sort(taken);
+
+        // the first gap large enough, or past the end of everything live alongside
+        vk::DeviceSize offset = 0;
+        for (const auto& [begin, end] : taken) {
+            if (begin >= offset + bytes) {
+                break;
+            }
+            offset = std::max(offset, end);
+        }
+
+        plan.Offsets[id] = offset;
+        plan.ArenaBytes = std::max(plan.ArenaBytes, offset + bytes);
+        placed.push_back(id);
+    }
+
+    for (size_t step = 0; step < m_Steps; step++) {
+        vk::DeviceSize live = 0;
+        for (const Tensor& tensor : m_Tensors) {
+            live += tensor.FirstStep <= step && step <= tensor.LastStep ? alignedBytes(tensor) : 0;
+        }
+        plan.LiveBytes = std::max(plan.LiveBytes, live);
+    }
+
+    return plan;
+}
+
+std::vector<std::shared_ptr<Buffer>> MemoryPlanner::Allocate(const ComputeEngine& engine,
+                                                             const MemoryPlan& plan) const {
+    std::vector<std::shared_ptr<Buffer>> buffers;
+    if (m_Tensors.empty()) {
+        return buffers;
+    }
+
+    std::shared_ptr<Allocation> arena = engine.CreateArena(plan.ArenaBytes);
+    for (size_t i = 0; i < m_Tensors.size(); i++) {
+        buffers.push_back(engine.CreateBuffer(m_Tensors[i].Count, m_Tensors[i].Size, arena, plan.Offsets[i]));
+    }
+    return buffers;
+}
+
+} // namespace nn
@@ -0,0 +1,50 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "ComputeEngine.hpp"
+
+namespace nn {
+
+struct MemoryPlan {
+    std::vector<vk::DeviceSize> Offsets; // of every tensor in the arena
+    vk::DeviceSize ArenaBytes = 0;       // peak once tensors that are never live together share memory
+    vk::DeviceSize UnplannedBytes = 0;   // every tensor in a buffer of its own
+    vk::DeviceSize LiveBytes = 0;        // most bytes live at any one step, no packing can go below it
+};
+
+// places short-lived tensors, e.g. activations and gradients, in one arena so that tensors whose lifetimes do
+// not overlap share memory. a tensor lives from the first to the last step that uses it in program order, and
+// a TaskGraph built from the same steps orders every reuse of memory after the last task that used it
+class MemoryPlanner {
+public:
+    using TensorId = size_t;
+
+    TensorId AddTensor(size_t count, size_t size);
+    // one task in program order and every planned tensor it reads or writes
+    void AddStep(const std::vector<TensorId>& tensors);
+
+    size_t TensorCount() const { return m_Tensors.size(); }
+    size_t StepCount() const { return m_Steps; }
+    size_t Count(TensorId id) const { return m_Tensors.at(id).Count; }
+    size_t Size(TensorId id) const { return m_Tensors.at(id).Size; }
+
+    // greedy by size: the largest tensors are placed first, each at the lowest offset clear of every placed
+    // tensor it is live together with. offsets are multiples of alignment
+    MemoryPlan Plan(vk::DeviceSize alignment) const;
+
+    // one device-local buffer per tensor, in a single arena as planned
+    std::vector<std::shared_ptr<Buffer>> Allocate(const ComputeEngine& engine, const MemoryPlan& plan) const;
+
+private:
+    struct Tensor {
+        size_t Count;
+        size_t Size;
+        size_t FirstStep;
+        size_t LastStep;
+    };
+
+    std::vector<Tensor> m_Tensors;
+    size_t m_Steps = 0;
+};
+
+} // namespace nn
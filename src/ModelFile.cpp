@@ -0,0 +1,187 @@
+#include "ModelFile.hpp"
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include "Log.hpp"
+
+namespace nn {
+
+namespace {
+
+constexpr char modelMagic[8] = "NNMODEL";
+
+uint64_t alignOffset(uint64_t offset) {
+    return (offset + modelAlignment - 1) / modelAlignment * modelAlignment;
+}
+
+} // namespace
+
+void WriteModel(const std::string& path, std::span<const ModelLayerData> layers, float outputScale) {
+    // blobs are laid out first so the records can be written in one go
+    std::vector<ModelLayer> records;
+    uint64_t offset = alignOffset(sizeof(ModelHeader) + layers.size() * sizeof(ModelLayer));
+    for (const ModelLayerData& layer : layers) {
+        ModelLayer record = {
+            .Inputs = layer.Inputs,
+            .Outputs = layer.Outputs,
+            .Function = layer.Function,
+            .Storage = layer.Storage,
+            .InputScale = layer.InputScale,
+            .WeightScale = layer.WeightScale,
+            .WeightOffset = offset,
+            .WeightBytes = layer.Weights.size(),
+            .BiasOffset = alignOffset(offset + layer.Weights.size()),
+            .BiasBytes = layer.Bias.size(),
+        };
+        offset = alignOffset(record.BiasOffset + record.BiasBytes);
+        records.push_back(record);
+    }
+
+    ModelHeader header = {
+        .Magic = {},
+        .Version = modelVersion,
+        .LayerCount = uint32_t(layers.size()),
+        .OutputScale = outputScale,
+        .Reserved = 0,
+        .FileSize = offset,
+    };
+    std::memcpy(header.Magic, modelMagic, sizeof(header.Magic));
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error("could not write " + path);
+    }
+
+    static const std::array<char, modelAlignment> zeros = {};
+    auto padTo = [&](uint64_t position) {
+        file.write(zeros.data(), std::streamsize(position - uint64_t(file.tellp())));
+    };
+
+    file.write((const char*)&header, sizeof(header));
+    file.write((const char*)records.data(), std::streamsize(records.size() * sizeof(ModelLayer)));
+    for (size_t i = 0; i < layers.size(); i++) {
+        padTo(records[i].WeightOffset);
+        file.write((const char*)layers[i].Weights.data(), std::streamsize(layers[i].Weights.size()));
+        padTo(records[i].BiasOffset);
+        file.write((const char*)layers[i].Bias.data(), std::streamsize(layers[i].Bias.size()));
+    }
+    padTo(header.FileSize);
+
+    if (!file) {
+        throw std::runtime_error("could not write " + path);
+    }
+}
+
+void SaveModel(ComputeEngine& engine, const std::vector<std::unique_ptr<Dense>>& layers, const std::string& path) {
+    std::vector<std::vector<float>> weights, biases;
+    std::vector<ModelLayerData> data;
+    weights.reserve(layers.size());
+    biases.reserve(layers.size());
+    for (const auto& layer : layers) {
+        const DenseSpecification& spec = layer->Specification();
+        weights.emplace_back(size_t(spec.Inputs) * spec.Outputs);
+        biases.emplace_back(spec.Outputs);
+        engine.Download(*layer->Weights(), std::span<float>(weights.back()));
+        engine.Download(*layer->Bias(), std::span<float>(biases.back()));
+
+        data.push_back({
+            .Inputs = spec.Inputs,
+            .Outputs = spec.Outputs,
+            .Function = spec.Function,
+            .Storage = Precision::eFloat32,
+            .InputScale = 1.0f,
+            .WeightScale = 1.0f,
+            .Weights = {(const uint8_t*)weights.back().data(), weights.back().size() * sizeof(float)},
+            .Bias = {(const uint8_t*)biases.back().data(), biases.back().size() * sizeof(float)},
+        });
+    }
+    WriteModel(path, data);
+}
+
+ModelFile::ModelFile(const std::string& path) : m_File(path) {
+    std::span<const uint8_t> data = m_File.Data();
+    if (data.size() < sizeof(ModelHeader) || std::memcmp(data.data(), modelMagic, sizeof(modelMagic)) != 0) {
+        throw std::runtime_error(path + " is not a model file");
+    }
+
+    // a file written on a host of the other byte order fails here too
+    m_Header = (const ModelHeader*)data.data();
+    if (m_Header->Version != modelVersion) {
+        throw std::runtime_error(path + " has an unsupported model version");
+    }
+    if (m_Header->FileSize != data.size()) {
+        throw std::runtime_error(path + " is truncated");
+    }
+    if (m_Header->LayerCount == 0 ||
+        m_Header->LayerCount > (data.size() - sizeof(ModelHeader)) / sizeof(ModelLayer)) {
+        throw std::runtime_error(path + " has an invalid layer count");
+    }
+    m_Layers = {(const ModelLayer*)(data.data() + sizeof(ModelHeader)), m_Header->LayerCount};
+
+    // every blob inside the file and page aligned, with the sizes its shape and storage call for
+    auto validBlob = [&](uint64_t offset, uint64_t bytes, uint64_t expected) {
+        return bytes == expected && offset % modelAlignment == 0 && offset <= data.size() &&
+               bytes <= data.size() - offset;
+    };
+    for (size_t i = 0; i < m_Layers.size(); i++) {
+        const ModelLayer& layer = m_Layers[i];
+        if (layer.Storage > Precision::eInt8 || layer.Function > Activation::eSigmoid ||
+            !validBlob(layer.WeightOffset,
+                       layer.WeightBytes,
+                       uint64_t(layer.Inputs) * layer.Outputs * PrecisionSize(layer.Storage)) ||
+            !validBlob(layer.BiasOffset, layer.BiasBytes, uint64_t(layer.Outputs) * sizeof(float)) ||
+            (i > 0 && layer.Inputs != m_Layers[i - 1].Outputs)) {
+            throw std::runtime_error(path + " has an invalid record for layer " + std::to_string(i));
+        }
+    }
+}
+
+std::span<const uint8_t> ModelFile::Weights(size_t layer) const {
+    return m_File.Data().subspan(m_Layers[layer].WeightOffset, m_Layers[layer].WeightBytes);
+}
+
+std::span<const uint8_t> ModelFile::Bias(size_t layer) const {
+    return m_File.Data().subspan(m_Layers[layer].BiasOffset, m_Layers[layer].BiasBytes);
+}
+
+SubmitHandle ModelFile::Upload(ComputeEngine& engine, std::span<const uint8_t> blob, const Buffer& dst) const {
+    // host-visible buffers are written in place by the engine, an import only pays off for device-local ones
+    if (!dst.Memory.Mapped()) {
+        std::call_once(m_ImportOnce, [&] {
+            std::span<const uint8_t> data = m_File.Data();
+            m_Imported = engine.ImportHostMemory(data.data(), data.size());
+            LogInfo("model of", data.size(), "bytes", m_Imported ? "imported as host memory" : "read through staging");
+        });
+        if (m_Imported) {
+            return engine.Copy(*m_Imported, dst, blob.size(), vk::DeviceSize(blob.data() - m_File.Data().data()));
+        }
+    }
+    return engine.Upload(dst, blob);
+}
+
+SubmitHandle LoadModel(ComputeEngine& engine,
+                       const ModelFile& model,
+                       const std::vector<std::unique_ptr<Dense>>& layers) {
+    std::span<const ModelLayer> records = model.Layers();
+    if (records.size() != layers.size()) {
+        throw std::runtime_error("the model file has a different number of layers");
+    }
+
+    SubmitHandle handle = {};
+    for (size_t i = 0; i < layers.size(); i++) {
+        const DenseSpecification& spec = layers[i]->Specification();
+        if (records[i].Storage != Precision::eFloat32 || records[i].Inputs != spec.Inputs ||
+            records[i].Outputs != spec.Outputs || records[i].Function != spec.Function) {
+            throw std::runtime_error("model layer " + std::to_string(i) + " does not match the dense layer");
+        }
+        // every copy goes to the transfer queue in order, the last real submission covers the rest
+        for (SubmitHandle submitted : {model.Upload(engine, model.Weights(i), *layers[i]->Weights()),
+                                       model.Upload(engine, model.Bias(i), *layers[i]->Bias())}) {
+            handle = submitted.Value ? submitted : handle;
+        }
+    }
+    return handle;
+}
+
+} // namespace nn
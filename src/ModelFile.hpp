@@ -0,0 +1,90 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <vector>
+#include "Activation.hpp"
+#include "ComputeEngine.hpp"
+#include "Dataset.hpp"
+#include "Dense.hpp"
+#include "Quantization.hpp"
+
+namespace nn {
+
+// a model file is a header, one record per layer and the parameter blobs, in host byte order. every blob starts
+// on a page boundary and is padded to the next one, so the mapped file can be handed to the device as it is
+constexpr uint32_t modelVersion = 1;
+constexpr size_t modelAlignment = 4096;
+
+struct ModelHeader {
+    char Magic[8]; // "NNMODEL\0"
+    uint32_t Version;
+    uint32_t LayerCount;
+    float OutputScale; // scale of the last layer's output, 1 unless int8
+    uint32_t Reserved;
+    uint64_t FileSize; // catches truncated files
+};
+
+struct ModelLayer {
+    uint32_t Inputs;
+    uint32_t Outputs;
+    Activation Function;
+    Precision Storage; // of the weights and activations, bias is always fp32
+    float InputScale;  // 1 unless int8
+    float WeightScale;
+    uint64_t WeightOffset; // from the start of the file
+    uint64_t WeightBytes;
+    uint64_t BiasOffset;
+    uint64_t BiasBytes;
+};
+
+static_assert(sizeof(ModelHeader) == 32 && sizeof(ModelLayer) == 56, "the model file layout is fixed");
+
+// one layer's parameters on the host, already in the layout they are stored in
+struct ModelLayerData {
+    uint32_t Inputs;
+    uint32_t Outputs;
+    Activation Function;
+    Precision Storage;
+    float InputScale;
+    float WeightScale;
+    std::span<const uint8_t> Weights;
+    std::span<const uint8_t> Bias;
+};
+
+void WriteModel(const std::string& path, std::span<const ModelLayerData> layers, float outputScale = 1.0f);
+
+// writes trained layers as fp32, see InferenceNetwork::Save for reduced precision
+void SaveModel(ComputeEngine& engine, const std::vector<std::unique_ptr<Dense>>& layers, const std::string& path);
+
+// a mapped and validated model file, nothing is parsed beyond the layer records. blobs reach the device either
+// through an import of the mapping itself, where the engine supports it, or copied once into the staging ring
+class ModelFile {
+public:
+    explicit ModelFile(const std::string& path);
+
+    std::span<const ModelLayer> Layers() const { return m_Layers; }
+    float OutputScale() const { return m_Header->OutputScale; }
+    std::span<const uint8_t> Weights(size_t layer) const;
+    std::span<const uint8_t> Bias(size_t layer) const;
+
+    // the file must outlive the returned submission, an imported copy reads straight from the mapping
+    SubmitHandle Upload(ComputeEngine& engine, std::span<const uint8_t> blob, const Buffer& dst) const;
+
+private:
+    MappedFile m_File;
+    const ModelHeader* m_Header = nullptr;
+    std::span<const ModelLayer> m_Layers;
+
+    mutable std::once_flag m_ImportOnce;
+    mutable std::shared_ptr<Buffer> m_Imported; // the whole mapping, empty when the import is unsupported
+};
+
+// copies an fp32 model into existing layers of the same shapes, e.g. to resume training. wait on the handle
+// before the file is closed
+SubmitHandle LoadModel(ComputeEngine& engine,
+                       const ModelFile& model,
+                       const std::vector<std::unique_ptr<Dense>>& layers);
+
+} // namespace nn
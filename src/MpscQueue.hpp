@@ -0,0 +1,54 @@
+#pragma once
+#include <atomic>
+#include <optional>
+#include <utility>
+
+namespace nn {
+
+// unbounded lock-free queue any number of threads push to and a single thread pops from.
+// producers swap themselves in at the head with one exchange and link the previous node afterwards,
+// so a pop may briefly miss a push that is still linking, it is picked up by the next pop
+template <typename T>
+class MpscQueue {
+public:
+    MpscQueue() : m_Head(new Node), m_Tail(m_Head.load(std::memory_order_relaxed)) {}
+    MpscQueue(const MpscQueue&) = delete;
+    void operator=(const MpscQueue&) = delete;
+
+    ~MpscQueue() {
+        while (Pop()) {
+        }
+        delete m_Tail;
+    }
+
+    void Push(T value) {
+        Node* node = new Node{std::move(value)};
+        Node* previous = m_Head.exchange(node, std::memory_order_acq_rel);
+        previous->Next.store(node, std::memory_order_release);
+    }
+
+    // consumer only
+    std::optional<T> Pop() {
+        Node* next = m_Tail->Next.load(std::memory_order_acquire);
+        if (!next) {
+            return std::nullopt;
+        }
+        // next becomes the new stub, its value is moved out and the old stub freed
+        T value = std::move(*next->Value);
+        next->Value.reset();
+        delete m_Tail;
+        m_Tail = next;
+        return value;
+    }
+
+private:
+    struct Node {
+        std::optional<T> Value;
+        std::atomic<Node*> Next = nullptr;
+    };
+
+    std::atomic<Node*> m_Head; // last pushed
+    Node* m_Tail;              // stub whose successor is the oldest value
+};
+
+} // namespace nn
@@ -0,0 +1,281 @@
+#include "PipelineLibrary.hpp"
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include "Log.hpp"
+
+namespace nn {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+} // namespace
+
+PipelineLibrary::PipelineLibrary(vk::Device device, vk::PhysicalDevice gpu, std::string cachePath)
+    : m_Device(device),
+      m_Properties(gpu.getProperties()),
+      m_CachePath(std::move(cachePath)) {
+    auto start = Clock::now();
+    std::vector<uint8_t> initialData = loadCache();
+
+    vk::PipelineCacheCreateInfo pipelineCacheCreateInfo = {
+        .sType = vk::StructureType::ePipelineCacheCreateInfo,
+        .pNext = nullptr,
+        .flags = {},
+        .initialDataSize = initialData.size(),
+        .pInitialData = initialData.data(),
+    };
+
+    m_Cache = m_Device.createPipelineCacheUnique(pipelineCacheCreateInfo);
+    m_CreationSeconds = secondsSince(start);
+}
+
+PipelineLibrary::~PipelineLibrary() {
+    try {
+        Save();
+    } catch (std::exception& e) {
+        LogWarning("could not save pipeline cache:", e.what());
+    }
+}
+
+ShaderHandle PipelineLibrary::Shader(std::string_view path) {
+    std::lock_guard lock(m_Mutex);
+    if (auto it = m_ShaderPaths.find(std::string(path)); it != m_ShaderPaths.end()) {
+        return {*m_Shaders.at(it->second), it->second};
+    }
+
+    auto start = Clock::now();
+    std::ifstream ifs(path.data(), std::ios::binary | std::ios::ate);
+    if (!ifs.is_open()) {
+        LogError("could not open", path);
+        return {};
+    }
+
+    std::string contents(size_t(ifs.tellg()), '\0');
+    ifs.seekg(0).read(contents.data(), contents.size());
+    ifs.close();
+
+    size_t hash = std::hash<std::string>{}(contents);
+    m_ShaderPaths.emplace(path, hash);
+
+    // two paths holding the same SPIR-V share a module
+    auto& module = m_Shaders[hash];
+    if (!module) {
+        vk::ShaderModuleCreateInfo shaderModuleCreateInfo = {
+            .sType = vk::StructureType::eShaderModuleCreateInfo,
+            .pNext = nullptr,
+            .flags = {},
+            .codeSize = contents.size(),
+            .pCode = reinterpret_cast<const uint32_t*>(contents.data()),
+        };
+        module = m_Device.createShaderModuleUnique(shaderModuleCreateInfo);
+    }
+    m_CreationSeconds += secondsSince(start);
+
+    return {*module, hash};
+}
+
+vk::DescriptorSetLayout PipelineLibrary::SetLayout(const std::vector<vk::DescriptorSetLayoutBinding>& bindings) {
+    std::lock_guard lock(m_Mutex);
+    std::string key;
+    for (const auto& binding : bindings) {
+        key += std::to_string(binding.binding) + ':' + std::to_string(int(binding.descriptorType)) + ':' +
+               std::to_string(binding.descriptorCount) + ':' + std::to_string(uint32_t(binding.stageFlags)) + ';';
+    }
+
+    auto& setLayout = m_SetLayouts[key];
+    if (!setLayout) {
+        vk::DescriptorSetLayoutCreateInfo descriptSetLayoutCreateInfo = {
+            .sType = vk::StructureType::eDescriptorSetLayoutCreateInfo,
+            .pNext = nullptr,
+            .flags = {},
+            .bindingCount = static_cast<uint32_t>(bindings.size()),
+            .pBindings = bindings.data(),
+        };
+        setLayout = m_Device.createDescriptorSetLayoutUnique(descriptSetLayoutCreateInfo);
+    }
+
+    return *setLayout;
+}
+
+vk::PipelineLayout PipelineLibrary::Layout(vk::DescriptorSetLayout setLayout, uint32_t pushConstantSize) {
+    std::lock_guard lock(m_Mutex);
+    auto& layout = m_Layouts[{setLayout, pushConstantSize}];
+    if (!layout) {
+        vk::PushConstantRange pushConstantRange = {
+            .stageFlags = vk::ShaderStageFlagBits::eCompute,
+            .offset = 0,
+            .size = pushConstantSize,
+        };
+
+        vk::PipelineLayoutCreateInfo pipelineLayoutCreateInfo = {
+            .sType = vk::StructureType::ePipelineLayoutCreateInfo,
+            .pNext = nullptr,
+            .flags = {},
+            .setLayoutCount = 1,
+            .pSetLayouts = &setLayout,
+            .pushConstantRangeCount = pushConstantSize ? 1u : 0u,
+            .pPushConstantRanges = pushConstantSize ? &pushConstantRange : nullptr,
+        };
+        layout = m_Device.createPipelineLayoutUnique(pipelineLayoutCreateInfo);
+    }
+
+    return *layout;
+}
+
+vk::Pipeline PipelineLibrary::Pipeline(const ShaderHandle& shader,
+                                      vk::PipelineLayout layout,
+                                      const std::vector<uint32_t>& constants) {
+    std::lock_guard lock(m_Mutex);
+    auto& pipeline = m_Pipelines[{shader.Hash, layout, constants}];
+    if (!pipeline) {
+        auto start = Clock::now();
+        std::vector<vk::SpecializationMapEntry> mapEntries;
+        for (uint32_t i = 0; i < constants.size(); i++) {
+            mapEntries.push_back({
+                .constantID = i,
+                .offset = uint32_t(i * sizeof(uint32_t)),
+                .size = sizeof(uint32_t),
+            });
+        }
+
+        vk::SpecializationInfo specializationInfo = {
+            .mapEntryCount = static_cast<uint32_t>(mapEntries.size()),
+            .pMapEntries = mapEntries.data(),
+            .dataSize = constants.size() * sizeof(uint32_t),
+            .pData = constants.data(),
+        };
+
+        vk::PipelineShaderStageCreateInfo shaderStageCreateInfo = {
+            .sType = vk::StructureType::ePipelineShaderStageCreateInfo,
+            .pNext = nullptr,
+            .flags = {},
+            .stage = vk::ShaderStageFlagBits::eCompute,
+            .module = shader.Module,
+            .pName = "main",
+            .pSpecializationInfo = constants.empty() ? nullptr : &specializationInfo,
+        };
+
+        vk::ComputePipelineCreateInfo computePipelineCreateInfo = {
+            .sType = vk::StructureType::eComputePipelineCreateInfo,
+            .pNext = nullptr,
+            .flags = {},
+            .stage = shaderStageCreateInfo,
+            .layout = layout,
+            .basePipelineHandle = {},
+            .basePipelineIndex = {},
+        };
+
+        vk::ResultValue result = m_Device.createComputePipelineUnique(*m_Cache, computePipelineCreateInfo);
+        if (result.result != vk::Result::eSuccess) {
+            LogError("could not create compute pipeline");
+        }
+        pipeline = std::move(result.value);
+        m_CreationSeconds += secondsSince(start);
+    }
+
+    return *pipeline;
+}
+
+std::optional<uint32_t> PipelineLibrary::TunedWorkgroupSize(size_t shaderHash,
+                                                            const std::vector<uint32_t>& constants,
+                                                            uint32_t invocations) const {
+    std::lock_guard lock(m_Mutex);
+    if (auto it = m_TunedWorkgroupSizes.find({shaderHash, constants, invocations}); it != m_TunedWorkgroupSizes.end()) {
+        return it->second;
+    }
+    return std::nullopt;
+}
+
+void PipelineLibrary::SetTunedWorkgroupSize(size_t shaderHash,
+                                            const std::vector<uint32_t>& constants,
+                                            uint32_t invocations,
+                                            uint32_t workgroupSize) {
+    std::lock_guard lock(m_Mutex);
+    m_TunedWorkgroupSizes[{shaderHash, constants, invocations}] = workgroupSize;
+}
+
+std::optional<uint32_t> PipelineLibrary::TunedVariant(const std::string& operation,
+                                                      const std::vector<uint32_t>& shape) const {
+    std::lock_guard lock(m_Mutex);
+    if (auto it = m_TunedVariants.find({operation, shape}); it != m_TunedVariants.end()) {
+        return it->second;
+    }
+    return std::nullopt;
+}
+
+void PipelineLibrary::SetTunedVariant(const std::string& operation,
+                                      const std::vector<uint32_t>& shape,
+                                      uint32_t variant) {
+    std::lock_guard lock(m_Mutex);
+    m_TunedVariants[{operation, shape}] = variant;
+}
+
+double PipelineLibrary::CreationSeconds() const {
+    std::lock_guard lock(m_Mutex);
+    return m_CreationSeconds;
+}
+
+void PipelineLibrary::Save() const {
+    if (m_CachePath.empty()) {
+        return;
+    }
+
+    std::vector<uint8_t> data = m_Device.getPipelineCacheData(*m_Cache);
+
+    // write beside the old cache and swap it in so a crash never leaves a torn file
+    std::string tmpPath = m_CachePath + ".tmp";
+    if (std::ofstream ofs{tmpPath, std::ios::binary | std::ios::trunc}) {
+        ofs.write((const char*)data.data(), data.size());
+    } else {
+        LogWarning("could not write", tmpPath);
+        return;
+    }
+    std::filesystem::rename(tmpPath, m_CachePath);
+}
+
+std::vector<uint8_t> PipelineLibrary::loadCache() const {
+    if (m_CachePath.empty()) {
+        return {};
+    }
+
+    std::ifstream ifs(m_CachePath, std::ios::binary | std::ios::ate);
+    if (!ifs.is_open()) {
+        return {};
+    }
+
+    std::vector<uint8_t> data(size_t(ifs.tellg()));
+    ifs.seekg(0).read((char*)data.data(), data.size());
+
+    // VkPipelineCacheHeaderVersionOne, drivers are not required to reject foreign data gracefully
+    struct {
+        uint32_t HeaderSize;
+        uint32_t HeaderVersion;
+        uint32_t VendorID;
+        uint32_t DeviceID;
+        uint8_t Uuid[VK_UUID_SIZE];
+    } header;
+
+    if (data.size() < sizeof(header)) {
+        LogWarning("ignoring truncated pipeline cache", m_CachePath);
+        return {};
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+
+    if (header.HeaderVersion != uint32_t(vk::PipelineCacheHeaderVersion::eOne) ||
+        header.VendorID != m_Properties.vendorID || header.DeviceID != m_Properties.deviceID ||
+        std::memcmp(header.Uuid, m_Properties.pipelineCacheUUID.data(), VK_UUID_SIZE) != 0) {
+        LogInfo("pipeline cache", m_CachePath, "was written by another device or driver, starting empty");
+        return {};
+    }
+
+    return data;
+}
+
+} // namespace nn
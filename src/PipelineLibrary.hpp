@@ -0,0 +1,72 @@
+#pragma once
+#define VULKAN_HPP_NO_STRUCT_CONSTRUCTORS 1
+#include <vulkan/vulkan.hpp>
+#include <string>
+#include <unordered_map>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <tuple>
+
+namespace nn {
+
+struct ShaderHandle {
+    vk::ShaderModule Module;
+    size_t Hash = 0; // hash of the SPIR-V contents, not of the path
+};
+
+// owns every shader module, layout and pipeline the engine creates so tasks
+// built from the same shader and bindings share one compiled pipeline, safe to use from any thread
+class PipelineLibrary {
+public:
+    PipelineLibrary(vk::Device device, vk::PhysicalDevice gpu, std::string cachePath);
+    PipelineLibrary(const PipelineLibrary&) = delete;
+    void operator=(const PipelineLibrary&) = delete;
+    ~PipelineLibrary();
+
+    ShaderHandle Shader(std::string_view path);
+    vk::DescriptorSetLayout SetLayout(const std::vector<vk::DescriptorSetLayoutBinding>& bindings);
+    // pushConstantSize bytes of push constants visible to the compute stage from offset 0
+    vk::PipelineLayout Layout(vk::DescriptorSetLayout setLayout, uint32_t pushConstantSize = 0);
+    // constants[i] specializes constant_id i
+    vk::Pipeline Pipeline(const ShaderHandle& shader,
+                          vk::PipelineLayout layout,
+                          const std::vector<uint32_t>& constants = {});
+
+    // fastest workgroup size measured on this device for a shader, its constants and its invocation count
+    std::optional<uint32_t> TunedWorkgroupSize(size_t shaderHash,
+                                               const std::vector<uint32_t>& constants,
+                                               uint32_t invocations) const;
+    void SetTunedWorkgroupSize(size_t shaderHash,
+                               const std::vector<uint32_t>& constants,
+                               uint32_t invocations,
+                               uint32_t workgroupSize);
+    // fastest of several kernels for one operation, e.g. a convolution, measured on this device for a shape
+    std::optional<uint32_t> TunedVariant(const std::string& operation, const std::vector<uint32_t>& shape) const;
+    void SetTunedVariant(const std::string& operation, const std::vector<uint32_t>& shape, uint32_t variant);
+
+    vk::PipelineCache Cache() const { return *m_Cache; }
+    // wall time spent loading the cache and creating shader modules and pipelines
+    double CreationSeconds() const;
+    void Save() const;
+
+private:
+    std::vector<uint8_t> loadCache() const;
+
+    vk::Device m_Device;
+    vk::PhysicalDeviceProperties m_Properties;
+    std::string m_CachePath;
+    vk::UniquePipelineCache m_Cache;
+    mutable std::mutex m_Mutex; // guards the maps below, the pipeline cache is synchronized by the driver
+
+    std::unordered_map<std::string, size_t> m_ShaderPaths; // path -> content hash
+    std::unordered_map<size_t, vk::UniqueShaderModule> m_Shaders;
+    std::unordered_map<std::string, vk::UniqueDescriptorSetLayout> m_SetLayouts;
+    std::map<std::pair<vk::DescriptorSetLayout, uint32_t>, vk::UniquePipelineLayout> m_Layouts;
+    std::map<std::tuple<size_t, vk::PipelineLayout, std::vector<uint32_t>>, vk::UniquePipeline> m_Pipelines;
+    std::map<std::tuple<size_t, std::vector<uint32_t>, uint32_t>, uint32_t> m_TunedWorkgroupSizes;
+    std::map<std::pair<std::string, std::vector<uint32_t>>, uint32_t> m_TunedVariants;
+    double m_CreationSeconds = 0.0;
+};
+
+} // namespace nn
@@ -0,0 +1,104 @@
+#include "Quantization.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace nn {
+
+size_t PrecisionSize(Precision precision) {
+    switch (precision) {
+        case Precision::eFloat16:
+            return sizeof(uint16_t);
+        case Precision::eInt8:
+            return sizeof(int8_t);
+        default:
+            return sizeof(float);
+    }
+}
+
+uint16_t FloatToHalf(float value) {
+    uint32_t bits = std::bit_cast<uint32_t>(value);
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t exponent = (bits >> 23) & 0xff;
+    uint32_t mantissa = bits & 0x7fffff;
+
+    if (exponent == 0xff) {
+        return uint16_t(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+    }
+
+    int32_t halfExponent = int32_t(exponent) - 127 + 15;
+    if (halfExponent >= 0x1f) {
+        return uint16_t(sign | 0x7c00);
+    }
+
+    // below the normal range the implicit bit is shifted into a subnormal mantissa
+    if (halfExponent <= 0) {
+        if (halfExponent < -10) {
+            return uint16_t(sign);
+        }
+        mantissa |= 0x800000;
+        uint32_t shift = uint32_t(14 - halfExponent);
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1))) {
+            half++;
+        }
+        return uint16_t(sign | half);
+    }
+
+    // a carry out of the mantissa bumps the exponent, up to infinity, which is the correct rounding
+    uint32_t half = (uint32_t(halfExponent) << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) {
+        half++;
+    }
+    return uint16_t(sign | half);
+}
+
+float HalfToFloat(uint16_t value) {
+    uint32_t sign = uint32_t(value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1f;
+    uint32_t mantissa = value & 0x3ff;
+
+    if (exponent == 0) {
+        float magnitude = std::ldexp(float(mantissa), -24);
+        return sign ? -magnitude : magnitude;
+    }
+    if (exponent == 0x1f) {
+        return std::bit_cast<float>(sign | 0x7f800000 | (mantissa << 13));
+    }
+    return std::bit_cast<float>(sign | ((exponent + 127 - 15) << 23) | (mantissa << 13));
+}
+
+void FloatToHalf(std::span<const float> values, std::span<uint16_t> out) {
+    std::ranges::transform(values, out.begin(), [](float value) { return FloatToHalf(value); });
+}
+
+void HalfToFloat(std::span<const uint16_t> values, std::span<float> out) {
+    std::ranges::transform(values, out.begin(), [](uint16_t value) { return HalfToFloat(value); });
+}
+
+float SymmetricScale(std::span<const float> values) {
+    float maxMagnitude = 0.0f;
+    for (float value : values) {
+        maxMagnitude = std::max(maxMagnitude, std::abs(value));
+    }
+    return SymmetricScale(maxMagnitude);
+}
+
+float SymmetricScale(float maxMagnitude) {
+    return maxMagnitude > 0.0f ? maxMagnitude / 127.0f : 1.0f;
+}
+
+void Quantize(std::span<const float> values, float scale, std::span<int8_t> out) {
+    std::ranges::transform(values, out.begin(), [scale](float value) {
+        return int8_t(std::clamp(std::round(value / scale), -127.0f, 127.0f));
+    });
+}
+
+void Dequantize(std::span<const int8_t> values, float scale, std::span<float> out) {
+    std::ranges::transform(values, out.begin(), [scale](int8_t value) { return float(value) * scale; });
+}
+
+} // namespace nn
@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+#include <span>
+
+namespace nn {
+
+// written to model files, keep the values stable
+enum class Precision : uint32_t {
+    eFloat32,
+    eFloat16, // IEEE half, rounded to nearest even
+    eInt8,    // symmetric per-tensor, real = scale * q with q in [-127, 127]
+};
+
+size_t PrecisionSize(Precision precision); // bytes per element
+
+uint16_t FloatToHalf(float value);
+float HalfToFloat(uint16_t value);
+void FloatToHalf(std::span<const float> values, std::span<uint16_t> out);
+void HalfToFloat(std::span<const uint16_t> values, std::span<float> out);
+
+// largest magnitude / 127 so the range maps onto [-127, 127] exactly, 1 for an all-zero tensor
+float SymmetricScale(std::span<const float> values);
+float SymmetricScale(float maxMagnitude);
+void Quantize(std::span<const float> values, float scale, std::span<int8_t> out);
+void Dequantize(std::span<const int8_t> values, float scale, std::span<float> out);
+
+} // namespace nn
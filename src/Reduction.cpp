@@ -0,0 +1,77 @@
+#include "Reduction.hpp"
+#include <bit>
+#include <stdexcept>
+#include "TaskBuilder.hpp"
+
+namespace nn {
+
+namespace {
+
+// must match the workgroup size in evaluate.comp, the row kernels take it as a specialization
+constexpr uint32_t reductionThreads = 256;
+// lanes budgeted per row, more rows than subgroups are strided so any subgroup size works
+constexpr uint32_t rowLanes = 32;
+
+std::shared_ptr<Task> createRowTask(const ComputeEngine& engine,
+                                    const ReductionSpecification& spec,
+                                    const std::string& shader,
+                                    std::shared_ptr<Buffer> src,
+                                    std::shared_ptr<Buffer> dst) {
+    if (!engine.HasSubgroupArithmetic()) {
+        throw std::runtime_error("the reduction kernels need subgroup arithmetic in compute shaders");
+    }
+
+    TaskBuilder taskBuilder(engine);
+    taskBuilder.SetShader(spec.ShaderDirectory + shader);
+    taskBuilder.SetSrcBuffer(std::move(src));
+    taskBuilder.SetDstBuffer(std::move(dst));
+    taskBuilder.SetPipeline({
+        .bindings = StorageBindings(2),
+        .constants = {spec.Rows, spec.Cols, static_cast<uint32_t>(spec.Storage), std::bit_cast<uint32_t>(spec.Scale)},
+    });
+    taskBuilder.SetWorkgroupSize(reductionThreads);
+    taskBuilder.SetInvocations(spec.Rows * rowLanes);
+    return taskBuilder.create();
+}
+
+} // namespace
+
+std::shared_ptr<Task> CreateSoftmaxTask(const ComputeEngine& engine,
+                                        const ReductionSpecification& spec,
+                                        std::shared_ptr<Buffer> src,
+                                        std::shared_ptr<Buffer> dst) {
+    return createRowTask(engine, spec, "/softmax_rows.comp.spv", std::move(src), std::move(dst));
+}
+
+std::shared_ptr<Task> CreateArgmaxTask(const ComputeEngine& engine,
+                                       const ReductionSpecification& spec,
+                                       std::shared_ptr<Buffer> src,
+                                       std::shared_ptr<Buffer> dst) {
+    return createRowTask(engine, spec, "/argmax_rows.comp.spv", std::move(src), std::move(dst));
+}
+
+std::shared_ptr<Task> CreateEvaluateTask(const ComputeEngine& engine,
+                                         const ReductionSpecification& spec,
+                                         std::shared_ptr<Buffer> logits,
+                                         std::shared_ptr<Buffer> labels,
+                                         std::shared_ptr<Buffer> totals) {
+    if (!engine.HasSubgroupArithmetic()) {
+        throw std::runtime_error("the reduction kernels need subgroup arithmetic in compute shaders");
+    }
+
+    TaskBuilder taskBuilder(engine);
+    taskBuilder.SetShader(spec.ShaderDirectory + "/evaluate.comp.spv");
+    taskBuilder.SetSrcBuffer(std::move(logits));
+    taskBuilder.SetDstBuffer(std::move(totals));
+    taskBuilder.AddBuffer(std::move(labels));
+    taskBuilder.SetPipeline({
+        .bindings = StorageBindings(3),
+        .constants = {spec.Rows, spec.Cols, static_cast<uint32_t>(spec.Storage), std::bit_cast<uint32_t>(spec.Scale)},
+        .pushConstantSize = sizeof(EvaluateSlot),
+    });
+    taskBuilder.SetWorkgroupSize(reductionThreads);
+    taskBuilder.SetInvocations(reductionThreads);
+    return taskBuilder.create();
+}
+
+} // namespace nn
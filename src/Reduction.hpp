@@ -0,0 +1,47 @@
+#pragma once
+#include <memory>
+#include <string>
+#include "ComputeEngine.hpp"
+#include "Quantization.hpp"
+#include "Task.hpp"
+
+namespace nn {
+
+// Rows x Cols values, e.g. a batch of logits, reduced along every row on the device. the kernels decode
+// Storage themselves so an fp16 or int8 network's output needs no conversion pass, and build on subgroup
+// arithmetic, see ComputeEngine::HasSubgroupArithmetic
+struct ReductionSpecification {
+    uint32_t Rows;
+    uint32_t Cols;
+    Precision Storage = Precision::eFloat32;
+    float Scale = 1.0f; // of int8 values
+    std::string ShaderDirectory = "tests/spirv";
+};
+
+// push constants of CreateEvaluateTask's kernel
+struct EvaluateSlot {
+    uint32_t Slot;  // pair of totals written, one per batch so a whole set is read back once
+    uint32_t Count; // leading rows that are samples, a short final batch is padded
+};
+
+// dst receives the softmax of every row as fp32
+std::shared_ptr<Task> CreateSoftmaxTask(const ComputeEngine& engine,
+                                        const ReductionSpecification& spec,
+                                        std::shared_ptr<Buffer> src,
+                                        std::shared_ptr<Buffer> dst);
+
+// dst receives one uint32 per row, the index of its largest value and the lowest one on ties
+std::shared_ptr<Task> CreateArgmaxTask(const ComputeEngine& engine,
+                                       const ReductionSpecification& spec,
+                                       std::shared_ptr<Buffer> src,
+                                       std::shared_ptr<Buffer> dst);
+
+// the summed cross-entropy and number of correct predictions of the logits against labels, one byte per row,
+// written as two floats at 2 * EvaluateSlot::Slot in totals. a single workgroup, every subgroup takes rows
+std::shared_ptr<Task> CreateEvaluateTask(const ComputeEngine& engine,
+                                         const ReductionSpecification& spec,
+                                         std::shared_ptr<Buffer> logits,
+                                         std::shared_ptr<Buffer> labels,
+                                         std::shared_ptr<Buffer> totals);
+
+} // namespace nn
@@ -0,0 +1,224 @@
+#include "SocketFrontend.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include "Log.hpp"
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace nn {
+
+#ifdef _WIN32
+
+SocketFrontend::SocketFrontend(InferenceServer& server, const std::string& path) : m_Server(server), m_Path(path) {
+    throw std::runtime_error("the socket front end needs unix domain sockets");
+}
+
+SocketFrontend::~SocketFrontend() = default;
+void SocketFrontend::accept() {}
+void SocketFrontend::serve(int) {}
+
+SocketClient::SocketClient(const std::string&) {
+    throw std::runtime_error("the socket client needs unix domain sockets");
+}
+
+SocketClient::~SocketClient() = default;
+
+std::vector<float> SocketClient::Infer(std::span<const float>) {
+    return {};
+}
+
+#else
+
+namespace {
+
+// a writer to a closed connection gets an error rather than SIGPIPE
+#ifdef MSG_NOSIGNAL
+constexpr int sendFlags = MSG_NOSIGNAL;
+#else
+constexpr int sendFlags = 0;
+#endif
+
+// larger frames are a broken client, not a sample
+constexpr uint32_t maxFrameFloats = 1 << 24;
+
+bool readAll(int socket, void* data, size_t size) {
+    char* bytes = (char*)data;
+    while (size > 0) {
+        ssize_t received = ::recv(socket, bytes, size, 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            return false;
+        }
+        bytes += received;
+        size -= size_t(received);
+    }
+    return true;
+}
+
+bool writeAll(int socket, const void* data, size_t size) {
+    const char* bytes = (const char*)data;
+    while (size > 0) {
+        ssize_t sent = ::send(socket, bytes, size, sendFlags);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            return false;
+        }
+        bytes += sent;
+        size -= size_t(sent);
+    }
+    return true;
+}
+
+bool readFrame(int socket, std::vector<float>& values) {
+    uint32_t count;
+    if (!readAll(socket, &count, sizeof(count)) || count > maxFrameFloats) {
+        return false;
+    }
+    values.resize(count);
+    return readAll(socket, values.data(), values.size() * sizeof(float));
+}
+
+bool writeFrame(int socket, std::span<const float> values) {
+    uint32_t count = uint32_t(values.size());
+    return writeAll(socket, &count, sizeof(count)) && writeAll(socket, values.data(), values.size_bytes());
+}
+
+sockaddr_un socketAddress(const std::string& path) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("socket path is too long: " + path);
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return address;
+}
+
+} // namespace
+
+SocketFrontend::SocketFrontend(InferenceServer& server, const std::string& path) : m_Server(server), m_Path(path) {
+    sockaddr_un address = socketAddress(path);
+    m_Listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (m_Listener < 0) {
+        throw std::runtime_error("could not create a unix socket");
+    }
+
+    ::unlink(path.c_str());
+    if (::bind(m_Listener, (const sockaddr*)&address, sizeof(address)) != 0 || ::listen(m_Listener, SOMAXCONN) != 0) {
+        ::close(m_Listener);
+        throw std::runtime_error("could not listen on " + path);
+    }
+
+    m_Acceptor = std::thread([this] { accept(); });
+}
+
+SocketFrontend::~SocketFrontend() {
+    // shutting the sockets down wakes the blocked accept and recv calls, every thread closes its own descriptor
+    m_Stop = true;
+    ::shutdown(m_Listener, SHUT_RDWR);
+    m_Acceptor.join();
+    {
+        std::lock_guard lock(m_Mutex);
+        for (int connection : m_Connections) {
+            ::shutdown(connection, SHUT_RDWR);
+        }
+    }
+    // only the acceptor adds threads and it has finished
+    for (std::thread& thread : m_Threads) {
+        thread.join();
+    }
+    ::close(m_Listener);
+    ::unlink(m_Path.c_str());
+}
+
+void SocketFrontend::accept() {
+    while (!m_Stop) {
+        int connection = ::accept(m_Listener, nullptr, nullptr);
+        if (connection < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (!m_Stop) {
+                LogError("socket front end stopped accepting:", std::strerror(errno));
+            }
+            return;
+        }
+
+        // threads of closed connections are reaped here, a long-running front end would hold one per connection
+        std::vector<std::thread> finished;
+        {
+            std::lock_guard lock(m_Mutex);
+            for (std::thread::id id : m_Finished) {
+                auto thread = std::ranges::find(m_Threads, id, &std::thread::get_id);
+                finished.push_back(std::move(*thread));
+                m_Threads.erase(thread);
+            }
+            m_Finished.clear();
+            m_Connections.push_back(connection);
+            m_Threads.emplace_back([this, connection] { serve(connection); });
+        }
+        for (std::thread& thread : finished) {
+            thread.join();
+        }
+    }
+}
+
+void SocketFrontend::serve(int connection) {
+    std::vector<float> sample;
+    while (readFrame(connection, sample)) {
+        // a rejected request is answered with an empty frame and the connection stays usable
+        std::vector<float> result;
+        try {
+            result = m_Server.Infer(sample).get();
+        } catch (const std::exception& e) {
+            LogWarning("socket request failed:", e.what());
+        }
+        if (!writeFrame(connection, result)) {
+            break;
+        }
+    }
+
+    std::lock_guard lock(m_Mutex);
+    std::erase(m_Connections, connection);
+    m_Finished.push_back(std::this_thread::get_id());
+    ::close(connection);
+}
+
+SocketClient::SocketClient(const std::string& path) {
+    sockaddr_un address = socketAddress(path);
+    m_Socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (m_Socket < 0 || ::connect(m_Socket, (const sockaddr*)&address, sizeof(address)) != 0) {
+        if (m_Socket >= 0) {
+            ::close(m_Socket);
+        }
+        throw std::runtime_error("could not connect to " + path);
+    }
+}
+
+SocketClient::~SocketClient() {
+    ::close(m_Socket);
+}
+
+std::vector<float> SocketClient::Infer(std::span<const float> sample) {
+    std::vector<float> result;
+    if (!writeFrame(m_Socket, sample) || !readFrame(m_Socket, result)) {
+        throw std::runtime_error("the inference server closed the connection");
+    }
+    if (result.empty()) {
+        throw std::runtime_error("the inference server rejected the request");
+    }
+    return result;
+}
+
+#endif
+
+} // namespace nn
@@ -0,0 +1,55 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+#include "InferenceServer.hpp"
+
+namespace nn {
+
+// local unix socket in front of an inference server, meant for testing and load generation rather than
+// production traffic. a request is a uint32 count followed by that many floats, the reply uses the same
+// framing with a count of 0 when the request was rejected. every connection gets its own thread and sends
+// one request at a time, so clients open as many connections as they want requests in flight
+class SocketFrontend {
+public:
+    // removes whatever is at path first, not available on windows
+    SocketFrontend(InferenceServer& server, const std::string& path);
+    SocketFrontend(const SocketFrontend&) = delete;
+    void operator=(const SocketFrontend&) = delete;
+    // drops the open connections, a request being served is answered first
+    ~SocketFrontend();
+
+private:
+    void accept();
+    void serve(int connection);
+
+    InferenceServer& m_Server;
+    std::string m_Path;
+    int m_Listener = -1;
+    std::atomic<bool> m_Stop = false;
+
+    std::mutex m_Mutex;
+    std::vector<int> m_Connections; // open ones, shut down on destruction
+    std::vector<std::thread> m_Threads;
+    std::vector<std::thread::id> m_Finished; // threads done serving, joined by the next accept
+    std::thread m_Acceptor;
+};
+
+// blocking client of a SocketFrontend, one request at a time
+class SocketClient {
+public:
+    explicit SocketClient(const std::string& path);
+    SocketClient(const SocketClient&) = delete;
+    void operator=(const SocketClient&) = delete;
+    ~SocketClient();
+
+    std::vector<float> Infer(std::span<const float> sample);
+
+private:
+    int m_Socket = -1;
+};
+
+} // namespace nn
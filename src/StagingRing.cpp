@@ -0,0 +1,47 @@
+#include "StagingRing.hpp"
+
+namespace nn {
+
+std::optional<vk::DeviceSize> StagingRing::Allocate(vk::DeviceSize size, vk::DeviceSize alignment) {
+    vk::DeviceSize capacity = Capacity();
+    if (size == 0 || size >= capacity) {
+        return std::nullopt;
+    }
+
+    if (m_Regions.empty() && !m_Pending) {
+        m_Head = m_Tail = 0;
+    }
+
+    // head == tail only ever means empty, so a range may not end exactly on the tail
+    vk::DeviceSize offset = (m_Head + alignment - 1) / alignment * alignment;
+    if (m_Head >= m_Tail) {
+        if (offset + size > capacity) {
+            if (size >= m_Tail) {
+                return std::nullopt;
+            }
+            offset = 0;
+        }
+    } else if (offset + size >= m_Tail) {
+        return std::nullopt;
+    }
+
+    m_Head = offset + size;
+    m_Pending = true;
+    return offset;
+}
+
+void StagingRing::Submitted(uint64_t timelineValue) {
+    if (m_Pending) {
+        m_Regions.push_back({m_Head, timelineValue});
+        m_Pending = false;
+    }
+}
+
+void StagingRing::Release(uint64_t completedValue) {
+    while (!m_Regions.empty() && m_Regions.front().Value <= completedValue) {
+        m_Tail = m_Regions.front().End;
+        m_Regions.pop_front();
+    }
+}
+
+} // namespace nn
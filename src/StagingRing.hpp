@@ -0,0 +1,42 @@
+#pragma once
+#define VULKAN_HPP_NO_STRUCT_CONSTRUCTORS 1
+#include <vulkan/vulkan.hpp>
+#include <deque>
+#include <memory>
+#include <optional>
+#include "Buffer.hpp"
+
+namespace nn {
+
+// host-visible ring that transfers to and from device-local buffers pass through.
+// space is handed out in submission order and reclaimed once the timeline value
+// of the submission that used it has been reached
+class StagingRing {
+public:
+    explicit StagingRing(std::shared_ptr<Buffer> buffer) : m_Buffer(std::move(buffer)) {}
+
+    const Buffer& Storage() const { return *m_Buffer; }
+    vk::DeviceSize Capacity() const { return m_Buffer->Bytes(); }
+    char* Mapped(vk::DeviceSize offset) const { return (char*)m_Buffer->Memory.Mapped() + offset; }
+
+    // nullopt when the range does not fit until older submissions complete
+    std::optional<vk::DeviceSize> Allocate(vk::DeviceSize size, vk::DeviceSize alignment = 16);
+    bool HasInFlight() const { return !m_Regions.empty(); }
+    uint64_t OldestValue() const { return m_Regions.front().Value; } // the submission to wait for to free space
+    void Submitted(uint64_t timelineValue); // tags everything allocated since the last call
+    void Release(uint64_t completedValue);
+
+private:
+    struct Region {
+        vk::DeviceSize End;
+        uint64_t Value;
+    };
+
+    std::shared_ptr<Buffer> m_Buffer;
+    vk::DeviceSize m_Head = 0; // next free byte
+    vk::DeviceSize m_Tail = 0; // oldest byte still in use
+    bool m_Pending = false;    // allocated but not yet submitted
+    std::deque<Region> m_Regions;
+};
+
+} // namespace nn
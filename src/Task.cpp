@@ -1,306 +1,325 @@
 #include "Task.hpp"
-#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
 #include "ComputeEngine.hpp"
 #include "Log.hpp"
 
 namespace nn {
 
-void Task::Execute(const ComputeEngine& engine) {
-    vk::CommandBufferBeginInfo commandBufferBeginInfo = {
-        .sType = vk::StructureType::eCommandBufferBeginInfo,
-        .pNext = nullptr,
-        .flags = {},
-        .pInheritanceInfo = nullptr,
-    };
+std::vector<vk::DescriptorSetLayoutBinding> StorageBindings(uint32_t count) {
+    std::vector<vk::DescriptorSetLayoutBinding> bindings;
+    for (uint32_t binding = 0; binding < count; binding++) {
+        bindings.push_back({
+            .binding = binding,
+            .descriptorType = vk::DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = vk::ShaderStageFlagBits::eCompute,
+            .pImmutableSamplers = nullptr,
+        });
+    }
+    return bindings;
+}
 
-    m_CommandBuffer->begin(commandBufferBeginInfo);
-    m_CommandBuffer->bindPipeline(vk::PipelineBindPoint::eCompute, *m_ComputePipeline);
-    m_CommandBuffer->bindDescriptorSets(vk::PipelineBindPoint::eCompute, *m_PipelineLayout, 0, {*m_DescriptorSet}, {});
-    m_CommandBuffer->dispatch(64, 1, 1);
-    m_CommandBuffer->end();
+void Task::Execute(const ComputeEngine& engine) {
+    Submit(engine);
+    Wait(engine);
+}
 
-    vk::Queue queue = engine.Device().getQueue(engine.ComputeQueue(), 0);
+void Task::Submit(const ComputeEngine& engine) {
+    // the command buffer and the fence may still be in use by the previous submit when nobody waited for it,
+    // neither may be reset or re-recorded before it completes. the fence starts signaled for the first submit
+    waitFence(engine);
+    auto start = std::chrono::high_resolution_clock::now();
 
-    vk::FenceCreateInfo fenceCreateInfo = {
-        .sType = vk::StructureType::eFenceCreateInfo,
-        .pNext = nullptr,
-        .flags = {},
-    };
-    m_Fence = engine.Device().createFenceUnique(fenceCreateInfo);
+    if (m_RecordMode == RecordMode::eEveryExecute || m_Stale) {
+        record();
+        m_Stale = false;
+    }
 
-    vk::SubmitInfo submitInfo = {
-        .sType = vk::StructureType::eSubmitInfo,
-        .pNext = nullptr,
-        .waitSemaphoreCount = 0,
-        .pWaitSemaphores = nullptr,
-        .pWaitDstStageMask = nullptr,
-        .commandBufferCount = 1,
-        .pCommandBuffers = &*m_CommandBuffer,
-        .signalSemaphoreCount = 0,
-        .pSignalSemaphores = nullptr,
-    };
+    engine.Device().resetFences({*m_Fence});
+    engine.Submit(*m_Commands->CommandBuffer, *m_Fence);
 
-    using mu = std::chrono::microseconds;
-    auto start = std::chrono::high_resolution_clock::now();
+    m_SubmitOverhead = std::chrono::high_resolution_clock::now() - start;
+}
 
-    queue.submit({submitInfo}, *m_Fence);
+void Task::Wait(const ComputeEngine& engine) {
+    waitFence(engine);
+    collect();
+}
 
+void Task::waitFence(const ComputeEngine& engine) {
     vk::Result result = engine.Device().waitForFences({*m_Fence}, true, UINT64_MAX);
     if (result != vk::Result::eSuccess) {
         LogWarning("fence wait result error on line", __LINE__, __FILE__);
     }
+}
 
-    auto finish = std::chrono::high_resolution_clock::now();
-
-    int32_t* srcBufferPtr = (int32_t*)engine.Device().mapMemory(*m_Src.Memory, 0, m_Src.Count * m_Src.Size);
-    LogInfo("//--- Source Buffer ---//");
-    for (uint32_t i = 0; i < m_Src.Count; i++) {
-        printf("%d : %d\n", i, srcBufferPtr[i]);
+void Task::collect() {
+    if (m_Query) {
+        m_GpuTime = m_Profiler->Collect(m_Name, *m_Query);
     }
-    engine.Device().unmapMemory(*m_Src.Memory);
+}
 
-    int32_t* dstBufferPtr = (int32_t*)engine.Device().mapMemory(*m_Dst.Memory, 0, m_Dst.Count * m_Dst.Size);
-    LogInfo("//--- Destination Buffer ---//");
-    for (uint32_t i = 0; i < m_Dst.Count; i++) {
-        printf("%d : %d\n", i, dstBufferPtr[i]);
+void Task::SetPushConstants(const void* data, size_t size) {
+    if (size != m_PushConstants.size()) {
+        throw std::runtime_error("push constants do not match the size the pipeline was built with");
     }
-    engine.Device().unmapMemory(*m_Dst.Memory);
-
-    LogInfo("GPU round trip:", std::chrono::duration_cast<mu>(finish - start).count(), "microseconds");
+    std::memcpy(m_PushConstants.data(), data, size);
+    m_Stale = m_RecordMode == RecordMode::eOnce;
 }
 
-void Task::setShader(const ComputeEngine& engine, std::string_view path) {
-    std::vector<char> contents;
-
-    std::ifstream ifs(path.data(), std::ios::binary | std::ios::ate);
-    if (!ifs.is_open()) {
-        LogError("could not open", path);
-        return;
-    }
+void Task::record() {
+    vk::CommandBufferBeginInfo commandBufferBeginInfo = {
+        .sType = vk::StructureType::eCommandBufferBeginInfo,
+        .pNext = nullptr,
+        .flags = m_RecordMode == RecordMode::eEveryExecute ? vk::CommandBufferUsageFlagBits::eOneTimeSubmit
+                                                           : vk::CommandBufferUsageFlags{},
+        .pInheritanceInfo = nullptr,
+    };
 
-    const size_t fileSize = ifs.tellg();
-    ifs.seekg(0);
-    contents.resize(fileSize);
-    ifs.read(contents.data(), fileSize);
-    ifs.close();
+    vk::MemoryBarrier hostBarrier = {
+        .sType = vk::StructureType::eMemoryBarrier,
+        .pNext = nullptr,
+        .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+        .dstAccessMask = vk::AccessFlagBits::eHostRead,
+    };
 
-    vk::ShaderModuleCreateInfo shaderModuleCreateInfo = {
-        .sType = vk::StructureType::eShaderModuleCreateInfo,
+    // earlier submissions on the same queue may still be writing what the dispatch reads
+    vk::MemoryBarrier submissionBarrier = {
+        .sType = vk::StructureType::eMemoryBarrier,
         .pNext = nullptr,
-        .flags = {},
-        .codeSize = fileSize,
-        .pCode = reinterpret_cast<uint32_t*>(contents.data()),
+        .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+        .dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
     };
 
-    m_Shader = engine.Device().createShaderModuleUnique(shaderModuleCreateInfo);
+    vk::CommandBuffer commandBuffer = *m_Commands->CommandBuffer;
+    commandBuffer.begin(commandBufferBeginInfo);
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                                  vk::PipelineStageFlagBits::eComputeShader,
+                                  {},
+                                  {submissionBarrier},
+                                  {},
+                                  {});
+    recordDispatch(commandBuffer);
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eHost, {}, {hostBarrier}, {}, {});
+    commandBuffer.end();
 }
 
-void Task::setBuffers(const ComputeEngine& engine, const BufferSpecification& spec) {
-    uint32_t computeIndex = engine.ComputeQueue();
+void Task::recordDispatch(vk::CommandBuffer commandBuffer) const {
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, m_ComputePipeline);
+    commandBuffer.bindDescriptorSets(
+        vk::PipelineBindPoint::eCompute, m_PipelineLayout, 0, {m_DescriptorSet.Handle()}, {});
+    if (!m_PushConstants.empty()) {
+        commandBuffer.pushConstants(m_PipelineLayout,
+                                    vk::ShaderStageFlagBits::eCompute,
+                                    0,
+                                    static_cast<uint32_t>(m_PushConstants.size()),
+                                    m_PushConstants.data());
+    }
+    if (m_Query) {
+        m_Profiler->RecordBegin(commandBuffer, *m_Query);
+    }
+    commandBuffer.dispatch(m_GroupCountX, m_GroupCountY, 1);
+    if (m_Query) {
+        m_Profiler->RecordEnd(commandBuffer, *m_Query);
+    }
+}
 
-    m_Src.Size = uint32_t(spec.SrcSize);
-    m_Src.Count = uint32_t(spec.SrcCount);
+void Task::setShader(const ComputeEngine& engine, std::string_view path) {
+    m_Name = path;
+    m_Shader = engine.Pipelines().Shader(path);
+}
 
-    m_Dst.Size = uint32_t(spec.DstSize);
-    m_Dst.Count = uint32_t(spec.DstCount);
+void Task::setBuffers(const ComputeEngine& engine,
+                      const BufferSpecification& spec,
+                      std::shared_ptr<Buffer> src,
+                      std::shared_ptr<Buffer> dst,
+                      std::vector<std::shared_ptr<Buffer>> params,
+                      uint32_t invocations) {
+    // a buffer handed in by the builder is shared with whichever task produced it
+    m_Src = src ? std::move(src) : engine.CreateBuffer(spec.SrcCount, spec.SrcSize, spec.SrcUsage);
+    m_Dst = dst ? std::move(dst) : engine.CreateBuffer(spec.DstCount, spec.DstSize, spec.DstUsage);
+    m_Params = std::move(params);
+    m_Invocations = invocations ? invocations : m_Dst->Count;
+}
 
-    vk::BufferCreateInfo srcBufferCreateInfo = {
-        .sType = vk::StructureType::eBufferCreateInfo,
-        .pNext = nullptr,
-        .flags = {},
-        .size = m_Src.Size * m_Src.Count,
-        .usage = vk::BufferUsageFlagBits::eStorageBuffer,
-        .sharingMode = vk::SharingMode::eExclusive,
-        .queueFamilyIndexCount = 1,
-        .pQueueFamilyIndices = &computeIndex,
-    };
-    auto dstBufferCreateInfo = srcBufferCreateInfo;
-    dstBufferCreateInfo.size = m_Dst.Count * m_Dst.Size;
-
-    m_Src.Buffer = engine.Device().createBufferUnique(srcBufferCreateInfo);
-    m_Dst.Buffer = engine.Device().createBufferUnique(dstBufferCreateInfo);
-
-    vk::MemoryRequirements srcBufferMemoryRequirements = engine.Device().getBufferMemoryRequirements(*m_Src.Buffer);
-    vk::MemoryRequirements dstBufferMemoryRequirements = engine.Device().getBufferMemoryRequirements(*m_Dst.Buffer);
-
-    vk::PhysicalDeviceMemoryProperties memoryProperties = engine.GPU().getMemoryProperties();
-
-    uint32_t memoryTypeIndex = UINT32_MAX;
-    vk::DeviceSize memoryHeapSize = UINT32_MAX;
-    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
-        vk::MemoryType memoryType = memoryProperties.memoryTypes[i];
-        if ((vk::MemoryPropertyFlagBits::eHostVisible & memoryType.propertyFlags) &&
-            (vk::MemoryPropertyFlagBits::eHostCoherent & memoryType.propertyFlags)) {
-            memoryHeapSize = memoryProperties.memoryHeaps[memoryType.heapIndex].size;
-            memoryTypeIndex = i;
-            break;
-        }
+void Task::setPipeline(const ComputeEngine& engine, const PipelineSpecification& spec) {
+    m_DescriptorSetLayout = engine.Pipelines().SetLayout(spec.bindings);
+    m_PipelineLayout = engine.Pipelines().Layout(m_DescriptorSetLayout, spec.pushConstantSize);
+    m_Constants = spec.constants;
+    m_PushConstants.assign(spec.pushConstantSize, 0);
+
+    m_Bindings = spec.bindings;
+    std::vector<std::shared_ptr<Buffer>> bound = boundBuffers();
+    if (bound.size() != spec.bindings.size()) {
+        throw std::runtime_error("task binds " + std::to_string(bound.size()) + " buffers but its layout declares " +
+                                 std::to_string(spec.bindings.size()));
     }
 
-    vk::MemoryAllocateInfo srcBufferAllocInfo = {
-        .sType = vk::StructureType::eMemoryAllocateInfo,
-        .pNext = nullptr,
-        .allocationSize = srcBufferMemoryRequirements.size,
-        .memoryTypeIndex = memoryTypeIndex,
-    };
-    auto dstBufferAllocInfo = srcBufferAllocInfo;
-    dstBufferAllocInfo.allocationSize = dstBufferMemoryRequirements.size;
+    m_DescriptorSet = engine.Descriptors().Allocate(m_DescriptorSetLayout, spec.bindings);
+    bind(engine, bound);
+}
 
-    m_Src.Memory = engine.Device().allocateMemoryUnique(srcBufferAllocInfo);
-    m_Dst.Memory = engine.Device().allocateMemoryUnique(dstBufferAllocInfo);
+std::vector<std::shared_ptr<Buffer>> Task::boundBuffers() const {
+    std::vector<std::shared_ptr<Buffer>> bound = {m_Src, m_Dst};
+    bound.insert(bound.end(), m_Params.begin(), m_Params.end());
+    return bound;
+}
 
-    int32_t* srcBufferPtr = (int32_t*)engine.Device().mapMemory(*m_Src.Memory, 0, m_Src.Count * m_Src.Size);
-    for (uint32_t i = 0; i < m_Src.Count; i++) {
-        srcBufferPtr[i] = i;
+void Task::bind(const ComputeEngine& engine, const std::vector<std::shared_ptr<Buffer>>& buffers) {
+    // bindings[i] describes buffers[i], src and dst first followed by the task's params
+    std::vector<vk::DescriptorBufferInfo> bufferInfos;
+    std::vector<vk::WriteDescriptorSet> writeDescriptorSets;
+    bufferInfos.reserve(buffers.size());
+    for (uint32_t i = 0; i < buffers.size(); i++) {
+        bufferInfos.push_back({
+            .buffer = *buffers[i]->Handle,
+            .offset = 0,
+            .range = buffers[i]->Range(),
+        });
+        writeDescriptorSets.push_back({
+            .sType = vk::StructureType::eWriteDescriptorSet,
+            .pNext = nullptr,
+            .dstSet = m_DescriptorSet.Handle(),
+            .dstBinding = m_Bindings[i].binding,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = m_Bindings[i].descriptorType,
+            .pImageInfo = nullptr,
+            .pBufferInfo = &bufferInfos.back(),
+            .pTexelBufferView = nullptr,
+        });
     }
-    engine.Device().unmapMemory(*m_Src.Memory);
 
-    engine.Device().bindBufferMemory(*m_Src.Buffer, *m_Src.Memory, 0);
-    engine.Device().bindBufferMemory(*m_Dst.Buffer, *m_Dst.Memory, 0);
+    engine.Device().updateDescriptorSets(writeDescriptorSets, {});
 }
 
-void Task::setPipeline(const ComputeEngine& engine, const PipelineSpecification& spec) {
-    vk::DescriptorSetLayoutCreateInfo descriptSetLayoutCreateInfo = {
-        .sType = vk::StructureType::eDescriptorSetLayoutCreateInfo,
-        .pNext = nullptr,
-        .flags = {},
-        .bindingCount = 2,
-        .pBindings = spec.bindings.data(),
-    };
+void Task::setWorkgroupSize(const ComputeEngine& engine, uint32_t workgroupSize) {
+    std::vector<uint32_t> constants = {workgroupSize};
+    constants.insert(constants.end(), m_Constants.begin(), m_Constants.end());
 
-    m_DescriptorSetLayout = engine.Device().createDescriptorSetLayoutUnique(descriptSetLayoutCreateInfo);
+    m_WorkgroupSize = workgroupSize;
+    m_ComputePipeline = engine.Pipelines().Pipeline(m_Shader, m_PipelineLayout, constants);
 
-    vk::PipelineLayoutCreateInfo pipelineLayoutCreateInfo = {
-        .sType = vk::StructureType::ePipelineLayoutCreateInfo,
-        .pNext = nullptr,
-        .flags = {},
-        .setLayoutCount = 1,
-        .pSetLayouts = &*m_DescriptorSetLayout,
-        .pushConstantRangeCount = 0,
-        .pPushConstantRanges = nullptr,
-    };
+    // fold the groups into a second dimension once they exceed the device's x limit,
+    // shaders flatten gl_GlobalInvocationID back into one index and bounds check it
+    uint32_t maxGroupCountX = engine.GPU().getProperties().limits.maxComputeWorkGroupCount[0];
+    uint32_t groupCount = (m_Invocations + workgroupSize - 1) / workgroupSize;
+    m_GroupCountX = std::min(groupCount, maxGroupCountX);
+    m_GroupCountY = (groupCount + m_GroupCountX - 1) / std::max(m_GroupCountX, 1u);
+}
 
-    m_PipelineLayout = engine.Device().createPipelineLayoutUnique(pipelineLayoutCreateInfo);
-    m_PipelineCache = engine.Device().createPipelineCacheUnique({});
+void Task::setCommandPool(const ComputeEngine& engine, RecordMode mode) {
+    m_RecordMode = mode;
 
-    vk::PipelineShaderStageCreateInfo shaderStageCreateInfo = {
-        .sType = vk::StructureType::ePipelineShaderStageCreateInfo,
-        .pNext = nullptr,
-        .flags = {},
-        .stage = vk::ShaderStageFlagBits::eCompute,
-        .module = *m_Shader,
-        .pName = "main",
-        .pSpecializationInfo = nullptr,
-    };
+    // the task keeps the pool for its lifetime, only the thread that submits the task records into it
+    m_Commands = engine.CommandPools().Acquire(engine.ComputeQueue());
 
-    vk::ComputePipelineCreateInfo computePipelineCreateInfo = {
-        .sType = vk::StructureType::eComputePipelineCreateInfo,
+    vk::FenceCreateInfo fenceCreateInfo = {
+        .sType = vk::StructureType::eFenceCreateInfo,
         .pNext = nullptr,
-        .flags = {},
-        .stage = shaderStageCreateInfo,
-        .layout = *m_PipelineLayout,
-        .basePipelineHandle = {},
-        .basePipelineIndex = {},
+        .flags = vk::FenceCreateFlagBits::eSignaled,
     };
+    m_Fence = engine.Device().createFenceUnique(fenceCreateInfo);
 
-    vk::ResultValue result = engine.Device().createComputePipelineUnique(*m_PipelineCache, computePipelineCreateInfo);
-    if (result.result != vk::Result::eSuccess) {
-        LogError("could not create compute pipeline");
+    m_Profiler = &engine.Profiler();
+    m_Query = m_Profiler->AllocateQueries();
+}
+
+void Task::autotune(const ComputeEngine& engine) {
+    PipelineLibrary& pipelines = engine.Pipelines();
+    if (auto tuned = pipelines.TunedWorkgroupSize(m_Shader.Hash, m_Constants, m_Invocations)) {
+        setWorkgroupSize(engine, *tuned);
+        return;
     }
-    m_ComputePipeline = std::move(result.value);
 
-    vk::DescriptorPoolSize descriptorPoolSize = {
-        .type = vk::DescriptorType::eStorageBuffer,
-        .descriptorCount = 2,
-    };
+    vk::PhysicalDeviceLimits limits = engine.GPU().getProperties().limits;
+    uint32_t maxSize = std::min(limits.maxComputeWorkGroupSize[0], limits.maxComputeWorkGroupInvocations);
 
-    vk::DescriptorPoolCreateInfo descriptorPoolCreateInfo = {
-        .sType = vk::StructureType::eDescriptorPoolCreateInfo,
-        .pNext = nullptr,
-        .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
-        .maxSets = 1,
-        .poolSizeCount = 1,
-        .pPoolSizes = &descriptorPoolSize,
-    };
+    constexpr int warmupRuns = 2;
+    constexpr int timedRuns = 8;
 
-    m_DescriptorPool = engine.Device().createDescriptorPoolUnique(descriptorPoolCreateInfo);
+    // the runs go to zeroed scratch buffers of the same sizes and memory, a kernel that updates its buffers in
+    // place or accumulates into them would otherwise start from whatever the tuning runs left behind
+    std::vector<std::shared_ptr<Buffer>> scratch;
+    for (const std::shared_ptr<Buffer>& buffer : boundBuffers()) {
+        MemoryUsage usage = buffer->Memory.Mapped() ? MemoryUsage::eHostVisible : MemoryUsage::eDeviceLocal;
+        scratch.push_back(engine.CreateBuffer(buffer->Count, buffer->Size, usage));
+    }
+    bind(engine, scratch);
+    clear(engine, scratch);
+
+    uint32_t bestSize = m_WorkgroupSize;
+    double bestTime = std::numeric_limits<double>::max();
+    for (uint32_t candidate = 32; candidate <= maxSize; candidate *= 2) {
+        setWorkgroupSize(engine, candidate);
+        record();
+
+        for (int i = 0; i < warmupRuns; i++) {
+            Submit(engine);
+            waitFence(engine);
+        }
 
-    vk::DescriptorSetAllocateInfo descriptorSetAllocInfo = {
-        .sType = vk::StructureType::eDescriptorSetAllocateInfo,
-        .pNext = nullptr,
-        .descriptorPool = *m_DescriptorPool,
-        .descriptorSetCount = 1,
-        .pSetLayouts = &*m_DescriptorSetLayout,
-    };
-    std::vector<vk::UniqueDescriptorSet> descriptorSets =
-        engine.Device().allocateDescriptorSetsUnique(descriptorSetAllocInfo);
-    m_DescriptorSet = std::move(descriptorSets.front());
-
-    vk::DescriptorBufferInfo srcBufferInfo = {
-        .buffer = *m_Src.Buffer,
-        .offset = 0,
-        .range = m_Src.Count * m_Src.Size,
-    };
+        // device timestamps around the dispatch alone, the host clock also counts submission and wake-up
+        // latency and is only the fallback when the queue has no timestamps
+        double elapsed = 0.0;
+        for (int i = 0; i < timedRuns; i++) {
+            auto start = std::chrono::high_resolution_clock::now();
+            Submit(engine);
+            waitFence(engine);
+            std::optional<double> gpuTime = m_Query ? m_Profiler->Read(*m_Query) : std::nullopt;
+            elapsed += gpuTime.value_or(
+                double(std::chrono::nanoseconds(std::chrono::high_resolution_clock::now() - start).count()));
+        }
 
-    vk::DescriptorBufferInfo dstBufferInfo = {
-        .buffer = *m_Dst.Buffer,
-        .offset = 0,
-        .range = m_Dst.Count * m_Dst.Size,
-    };
+        if (elapsed < bestTime) {
+            bestTime = elapsed;
+            bestSize = candidate;
+        }
+    }
 
-    // describes write operations
-    // we just use our input and output buffers for this, may expand if future
-    std::vector<vk::WriteDescriptorSet> writeDescriptorSets = {
-        {
-            .sType = vk::StructureType::eWriteDescriptorSet,
-            .pNext = nullptr,
-            .dstSet = *m_DescriptorSet,
-            .dstBinding = 0,
-            .dstArrayElement = 0,
-            .descriptorCount = 1,
-            .descriptorType = vk::DescriptorType::eStorageBuffer,
-            .pImageInfo = nullptr,
-            .pBufferInfo = &srcBufferInfo,
-            .pTexelBufferView = nullptr,
-        },
-        {
-            .sType = vk::StructureType::eWriteDescriptorSet,
-            .pNext = nullptr,
-            .dstSet = *m_DescriptorSet,
-            .dstBinding = 1,
-            .dstArrayElement = 0,
-            .descriptorCount = 1,
-            .descriptorType = vk::DescriptorType::eStorageBuffer,
-            .pImageInfo = nullptr,
-            .pBufferInfo = &dstBufferInfo,
-            .pTexelBufferView = nullptr,
-        },
-    };
+    bind(engine, boundBuffers());
 
-    engine.Device().updateDescriptorSets(writeDescriptorSets, {});
+    pipelines.SetTunedWorkgroupSize(m_Shader.Hash, m_Constants, m_Invocations, bestSize);
+    setWorkgroupSize(engine, bestSize);
 }
 
-void Task::setCommandPool(const ComputeEngine& engine) {
-    vk::CommandPoolCreateInfo commandPoolCreateInfo = {
-        .sType = vk::StructureType::eCommandPoolCreateInfo,
+void Task::clear(const ComputeEngine& engine, const std::vector<std::shared_ptr<Buffer>>& buffers) {
+    vk::CommandBufferBeginInfo commandBufferBeginInfo = {
+        .sType = vk::StructureType::eCommandBufferBeginInfo,
         .pNext = nullptr,
-        .flags = {},
-        .queueFamilyIndex = engine.ComputeQueue(),
+        .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
+        .pInheritanceInfo = nullptr,
     };
-    
-    m_CommandPool = engine.Device().createCommandPoolUnique(commandPoolCreateInfo);
 
-    vk::CommandBufferAllocateInfo commandBufferAllocInfo = {
-        .sType = vk::StructureType::eCommandBufferAllocateInfo,
+    vk::MemoryBarrier transferBarrier = {
+        .sType = vk::StructureType::eMemoryBarrier,
         .pNext = nullptr,
-        .commandPool = *m_CommandPool,
-        .level = vk::CommandBufferLevel::ePrimary,
-        .commandBufferCount = 1,
+        .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+        .dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
     };
 
-    std::vector<vk::UniqueCommandBuffer> commandBuffers =
-        engine.Device().allocateCommandBuffersUnique(commandBufferAllocInfo);
-    m_CommandBuffer = std::move(commandBuffers.front());
+    waitFence(engine);
+    vk::CommandBuffer commandBuffer = *m_Commands->CommandBuffer;
+    commandBuffer.begin(commandBufferBeginInfo);
+    for (const std::shared_ptr<Buffer>& buffer : buffers) {
+        commandBuffer.fillBuffer(*buffer->Handle, 0, VK_WHOLE_SIZE, 0);
+    }
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                  vk::PipelineStageFlagBits::eComputeShader,
+                                  {},
+                                  {transferBarrier},
+                                  {},
+                                  {});
+    commandBuffer.end();
+
+    engine.Device().resetFences({*m_Fence});
+    engine.Submit(commandBuffer, *m_Fence);
+    waitFence(engine);
 }
 
 } // namespace nn
\ No newline at end of file
@@ -1,6 +1,18 @@
 #pragma once
 #define VULKAN_HPP_NO_STRUCT_CONSTRUCTORS 1
 #include <vulkan/vulkan.hpp>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "Buffer.hpp"
+#include "CommandPoolCache.hpp"
+#include "DescriptorAllocator.hpp"
+#include "DeviceAllocator.hpp"
+#include "GpuProfiler.hpp"
+#include "PipelineLibrary.hpp"
 
 namespace nn {
 
@@ -11,12 +23,24 @@ struct BufferSpecification {
     size_t SrcSize;  // size of a given element
     size_t DstCount;
     size_t DstSize;
+    MemoryUsage SrcUsage = MemoryUsage::eHostVisible;
+    MemoryUsage DstUsage = MemoryUsage::eReadback;
+};
+
+enum class RecordMode {
+    eOnce,         // record at build time and resubmit the same commands on every execute
+    eEveryExecute, // re-record before each submit
 };
 
 struct PipelineSpecification {
-    std::vector<vk::DescriptorSetLayoutBinding> bindings;
+    std::vector<vk::DescriptorSetLayoutBinding> bindings; // one per bound buffer, src, dst then params
+    std::vector<uint32_t> constants = {}; // constant_id 1..n, constant_id 0 is always local_size_x
+    uint32_t pushConstantSize = 0;        // bytes of per-dispatch scalars, see Task::SetPushConstants
 };
 
+// compute storage buffers at bindings 0..count-1, the layout every shader bound to src, dst and params uses
+std::vector<vk::DescriptorSetLayoutBinding> StorageBindings(uint32_t count);
+
 class Task {
 public:
     Task() = default;
@@ -26,39 +50,98 @@ public:
     Task& operator=(Task&&) noexcept = default;
 
     void Execute(const ComputeEngine& engine);
+    // blocks first while the previous submit of the same task is still running
+    void Submit(const ComputeEngine& engine);
+    void Wait(const ComputeEngine& engine);
+
+    // host time spent inside the last Submit, recording included when not recorded once
+    std::chrono::nanoseconds SubmitOverhead() const { return m_SubmitOverhead; }
+    uint32_t WorkgroupSize() const { return m_WorkgroupSize; }
+    const std::string& Name() const { return m_Name; }
+
+    // scalars pushed with every dispatch, e.g. a learning rate, the size must match the pipeline's.
+    // takes effect at the next submit without touching descriptors or pipelines
+    void SetPushConstants(const void* data, size_t size);
+
+    template <typename T>
+    void SetPushConstants(const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        SetPushConstants(&value, sizeof(T));
+    }
+    // device time of the last completed dispatch, nullopt when timestamps are unavailable
+    std::optional<double> GpuTimeNs() const { return m_GpuTime; }
+
+    const std::shared_ptr<Buffer>& Src() const { return m_Src; }
+    const std::shared_ptr<Buffer>& Dst() const { return m_Dst; }
+    // buffers bound after Src and Dst, from binding 2 onwards
+    const std::vector<std::shared_ptr<Buffer>>& Params() const { return m_Params; }
+
+    // write inputs and read results in place, empty unless the buffer is host visible
+    template <typename T>
+    std::span<T> SrcView() const {
+        return m_Src->View<T>();
+    }
+
+    template <typename T>
+    std::span<T> DstView() const {
+        return m_Dst->View<T>();
+    }
 
 private:
+    void record();
+    void waitFence(const ComputeEngine& engine);
+    void collect();
+    void recordDispatch(vk::CommandBuffer commandBuffer) const;
     void setShader(const ComputeEngine& engine, std::string_view path);
-    void setBuffers(const ComputeEngine& engine, const BufferSpecification& spec);
+    void setBuffers(const ComputeEngine& engine,
+                    const BufferSpecification& spec,
+                    std::shared_ptr<Buffer> src,
+                    std::shared_ptr<Buffer> dst,
+                    std::vector<std::shared_ptr<Buffer>> params,
+                    uint32_t invocations);
     void setPipeline(const ComputeEngine& engine, const PipelineSpecification& spec);
-    void setCommandPool(const ComputeEngine& engine);
-
-    struct {
-        vk::UniqueBuffer Buffer;
-        vk::UniqueDeviceMemory Memory;
-        uint32_t Size;
-        uint32_t Count;
-    } m_Src;
-
-    struct {
-        vk::UniqueBuffer Buffer;
-        vk::UniqueDeviceMemory Memory;
-        uint32_t Size;
-        uint32_t Count;
-    } m_Dst;
-
-    vk::UniquePipeline m_ComputePipeline;
-    vk::UniquePipelineLayout m_PipelineLayout;
-    vk::UniquePipelineCache m_PipelineCache;
-    vk::UniqueDescriptorPool m_DescriptorPool;
-    vk::UniqueDescriptorSetLayout m_DescriptorSetLayout;
-    vk::UniqueDescriptorSet m_DescriptorSet;
-    vk::UniqueCommandPool m_CommandPool;
-    vk::UniqueCommandBuffer m_CommandBuffer;
-    vk::UniqueShaderModule m_Shader;
+    std::vector<std::shared_ptr<Buffer>> boundBuffers() const;
+    // points the descriptor set at buffers in binding order, the task's own or autotune's scratch copies
+    void bind(const ComputeEngine& engine, const std::vector<std::shared_ptr<Buffer>>& buffers);
+    void clear(const ComputeEngine& engine, const std::vector<std::shared_ptr<Buffer>>& buffers);
+    void setWorkgroupSize(const ComputeEngine& engine, uint32_t workgroupSize);
+    void setCommandPool(const ComputeEngine& engine, RecordMode mode);
+    void autotune(const ComputeEngine& engine);
+
+    std::shared_ptr<Buffer> m_Src;
+    std::shared_ptr<Buffer> m_Dst;
+    std::vector<std::shared_ptr<Buffer>> m_Params;
+
+    // owned by the engine's PipelineLibrary and shared between tasks
+    vk::Pipeline m_ComputePipeline;
+    vk::PipelineLayout m_PipelineLayout;
+    vk::DescriptorSetLayout m_DescriptorSetLayout;
+    ShaderHandle m_Shader;
+    std::vector<uint32_t> m_Constants;
+
+    uint32_t m_Invocations = 0; // one per destination element unless the builder overrides it
+    uint32_t m_WorkgroupSize = 0;
+    uint32_t m_GroupCountX = 0;
+    uint32_t m_GroupCountY = 0;
+
+    DescriptorSet m_DescriptorSet; // from the engine's shared descriptor allocator
+    std::vector<vk::DescriptorSetLayoutBinding> m_Bindings;
+    std::vector<uint8_t> m_PushConstants;
+    bool m_Stale = false; // recorded once but the push constants have changed since
+    std::unique_ptr<CommandContext> m_Commands; // a pool of its own from the engine's cache
     vk::UniqueFence m_Fence;
 
+    RecordMode m_RecordMode = RecordMode::eOnce;
+    std::chrono::nanoseconds m_SubmitOverhead{};
+
+    std::string m_Name;
+    GpuProfiler* m_Profiler = nullptr;
+    std::optional<uint32_t> m_Query;
+    std::optional<double> m_GpuTime;
+
     friend class TaskBuilder;
+    friend class ComputeEngine;
+    friend class TaskGraph;
 };
 
 } // namespace nn
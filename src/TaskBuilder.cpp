@@ -5,9 +5,16 @@ namespace nn {
 std::shared_ptr<Task> TaskBuilder::create() const {
     auto task = std::make_shared<Task>();
     task->setShader(m_ComputeEngine, m_ShaderPath);
-    task->setBuffers(m_ComputeEngine, m_BufferSpec);
+    task->setBuffers(m_ComputeEngine, m_BufferSpec, m_SrcBuffer, m_DstBuffer, m_Params, m_Invocations);
     task->setPipeline(m_ComputeEngine, m_PipelineSpec);
-    task->setCommandPool(m_ComputeEngine);
+    task->setWorkgroupSize(m_ComputeEngine, m_WorkgroupSize);
+    task->setCommandPool(m_ComputeEngine, m_RecordMode);
+    if (m_Autotune) {
+        task->autotune(m_ComputeEngine);
+    }
+    if (m_RecordMode == RecordMode::eOnce) {
+        task->record();
+    }
     return task;
 }
 
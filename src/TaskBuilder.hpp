@@ -11,11 +11,26 @@ public:
         : m_ComputeEngine(computeEngine),
           m_ShaderPath(),
           m_BufferSpec(),
+          m_SrcBuffer(),
+          m_DstBuffer(),
+          m_Params(),
           m_PipelineSpec() {}
 
     void SetShader(std::string_view shader) { m_ShaderPath = shader; }
     void SetBuffers(const BufferSpecification& spec) { m_BufferSpec = spec; }
+    // bind an existing buffer, e.g. the previous task's Dst(), instead of allocating one
+    void SetSrcBuffer(std::shared_ptr<Buffer> buffer) { m_SrcBuffer = std::move(buffer); }
+    void SetDstBuffer(std::shared_ptr<Buffer> buffer) { m_DstBuffer = std::move(buffer); }
+    // bind another buffer after src and dst, params take bindings 2.. in the order they are added
+    void AddBuffer(std::shared_ptr<Buffer> buffer) { m_Params.push_back(std::move(buffer)); }
     void SetPipeline(const PipelineSpecification& spec) { m_PipelineSpec = spec; }
+    void SetRecordMode(RecordMode mode) { m_RecordMode = mode; }
+    void SetWorkgroupSize(uint32_t size) { m_WorkgroupSize = size; }
+    // total invocations to dispatch, 0 launches one per dst element
+    void SetInvocations(uint32_t invocations) { m_Invocations = invocations; }
+    // time power-of-two workgroup sizes on this device and keep the fastest, remembered per engine. the runs
+    // use zeroed scratch copies of the bound buffers, so the task's own contents are left untouched
+    void SetAutotune(bool autotune) { m_Autotune = autotune; }
 
     std::shared_ptr<Task> create() const;
 
@@ -24,7 +39,14 @@ private:
 
     std::string m_ShaderPath;
     BufferSpecification m_BufferSpec;
+    std::shared_ptr<Buffer> m_SrcBuffer;
+    std::shared_ptr<Buffer> m_DstBuffer;
+    std::vector<std::shared_ptr<Buffer>> m_Params;
     PipelineSpecification m_PipelineSpec;
+    RecordMode m_RecordMode = RecordMode::eOnce;
+    uint32_t m_WorkgroupSize = 64;
+    uint32_t m_Invocations = 0;
+    bool m_Autotune = false;
 };
 
 } // namespace nn
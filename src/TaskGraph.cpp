@@ -0,0 +1,217 @@
+#include "TaskGraph.hpp"
+#include <algorithm>
+#include <unordered_set>
+
+namespace nn {
+
+TaskGraph::NodeId TaskGraph::Add(std::shared_ptr<Task> task) {
+    std::vector<std::shared_ptr<Buffer>> reads = {task->Src()};
+    reads.insert(reads.end(), task->Params().begin(), task->Params().end());
+    std::shared_ptr<Buffer> dst = task->Dst();
+    return Add(std::move(task), std::move(reads), {dst});
+}
+
+TaskGraph::NodeId TaskGraph::Add(std::shared_ptr<Task> task,
+                                 std::vector<std::shared_ptr<Buffer>> reads,
+                                 std::vector<std::shared_ptr<Buffer>> writes) {
+    NodeId id = m_Nodes.size();
+    std::vector<NodeId> dependencies;
+
+    // read after write
+    for (const auto& buffer : reads) {
+        for (Access* access : aliases(*buffer)) {
+            if (access->Writer) {
+                dependencies.push_back(*access->Writer);
+            }
+        }
+    }
+    // write after write and write after read
+    for (const auto& buffer : writes) {
+        for (Access* access : aliases(*buffer)) {
+            if (access->Writer) {
+                dependencies.push_back(*access->Writer);
+            }
+            dependencies.insert(dependencies.end(), access->Readers.begin(), access->Readers.end());
+        }
+    }
+
+    std::ranges::sort(dependencies);
+    auto [first, last] = std::ranges::unique(dependencies);
+    dependencies.erase(first, last);
+
+    size_t level = 0;
+    for (NodeId dependency : dependencies) {
+        level = std::max(level, m_Nodes[dependency].Level + 1);
+    }
+
+    for (const auto& buffer : reads) {
+        if (buffer->Arena && !m_Accesses.contains(buffer.get())) {
+            m_ArenaBuffers.push_back(buffer.get());
+        }
+        m_Accesses[buffer.get()].Readers.push_back(id);
+    }
+    // a write to aliased memory is a write to every buffer overlapping it
+    for (const auto& buffer : writes) {
+        if (buffer->Arena && !m_Accesses.contains(buffer.get())) {
+            m_ArenaBuffers.push_back(buffer.get());
+        }
+        m_Accesses[buffer.get()];
+        for (Access* access : aliases(*buffer)) {
+            access->Writer = id;
+            access->Readers.clear();
+        }
+    }
+
+    m_Nodes.push_back({
+        .Task = std::move(task),
+        .Reads = std::move(reads),
+        .Writes = std::move(writes),
+        .Dependencies = std::move(dependencies),
+        .Level = level,
+    });
+    return id;
+}
+
+std::vector<TaskGraph::Access*> TaskGraph::aliases(const Buffer& buffer) {
+    std::vector<Access*> accesses;
+    if (!buffer.Arena) {
+        if (auto it = m_Accesses.find(&buffer); it != m_Accesses.end()) {
+            accesses.push_back(&it->second);
+        }
+        return accesses;
+    }
+    for (const Buffer* tracked : m_ArenaBuffers) {
+        if (tracked->Aliases(buffer)) {
+            accesses.push_back(&m_Accesses.at(tracked));
+        }
+    }
+    return accesses;
+}
+
+size_t TaskGraph::Depth() const {
+    size_t depth = 0;
+    for (const auto& node : m_Nodes) {
+        depth = std::max(depth, node.Level + 1);
+    }
+    return depth;
+}
+
+std::vector<TaskGraph> TaskGraph::Components() const {
+    // union-find over the dependency edges
+    std::vector<NodeId> parent(m_Nodes.size());
+    for (NodeId id = 0; id < m_Nodes.size(); id++) {
+        parent[id] = id;
+    }
+    auto find = [&](NodeId id) {
+        while (parent[id] != id) {
+            parent[id] = parent[parent[id]];
+            id = parent[id];
+        }
+        return id;
+    };
+    for (NodeId id = 0; id < m_Nodes.size(); id++) {
+        for (NodeId dependency : m_Nodes[id].Dependencies) {
+            parent[find(id)] = find(dependency);
+        }
+    }
+
+    // nodes are re-added in program order, so each component rebuilds the same hazards
+    std::vector<TaskGraph> components;
+    std::unordered_map<NodeId, size_t> componentOf;
+    for (NodeId id = 0; id < m_Nodes.size(); id++) {
+        auto [it, inserted] = componentOf.try_emplace(find(id), components.size());
+        if (inserted) {
+            components.emplace_back();
+        }
+        const Node& node = m_Nodes[id];
+        components[it->second].Add(node.Task, node.Reads, node.Writes);
+    }
+    return components;
+}
+
+size_t TaskGraph::Record(vk::CommandBuffer commandBuffer) const {
+    std::vector<std::vector<NodeId>> levels(Depth());
+    for (NodeId id = 0; id < m_Nodes.size(); id++) {
+        levels[m_Nodes[id].Level].push_back(id);
+    }
+
+    // writes not yet made visible by a barrier, and reads a later write must not overtake
+    std::unordered_set<const Buffer*> unflushedWrites;
+    std::unordered_set<const Buffer*> pendingReads;
+    size_t barrierCount = 0;
+
+    // an arena buffer also conflicts with whatever else is placed over its memory
+    auto overlaps = [](const std::unordered_set<const Buffer*>& buffers, const Buffer* buffer) {
+        return std::ranges::any_of(buffers, [&](const Buffer* other) { return other->Aliases(*buffer); });
+    };
+
+    for (const auto& level : levels) {
+        std::vector<vk::BufferMemoryBarrier> bufferBarriers;
+        std::vector<vk::MemoryBarrier> memoryBarriers;
+        bool executionDependency = false;
+
+        auto flush = [&](const Buffer* buffer) {
+            // a buffer barrier only covers its own buffer, arena memory may have been written through an
+            // alias so it takes a global one, which flushes every other write as well
+            if (buffer->Arena && overlaps(unflushedWrites, buffer)) {
+                memoryBarriers.push_back({
+                    .sType = vk::StructureType::eMemoryBarrier,
+                    .pNext = nullptr,
+                    .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+                    .dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+                });
+                unflushedWrites.clear();
+            }
+            if (unflushedWrites.erase(buffer)) {
+                bufferBarriers.push_back({
+                    .sType = vk::StructureType::eBufferMemoryBarrier,
+                    .pNext = nullptr,
+                    .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+                    .dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+                    .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                    .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                    .buffer = *buffer->Handle,
+                    .offset = 0,
+                    .size = VK_WHOLE_SIZE,
+                });
+            }
+        };
+
+        for (NodeId id : level) {
+            for (const auto& buffer : m_Nodes[id].Reads) {
+                flush(buffer.get());
+            }
+            for (const auto& buffer : m_Nodes[id].Writes) {
+                flush(buffer.get());
+                executionDependency |= buffer->Arena ? overlaps(pendingReads, buffer.get())
+                                                     : pendingReads.contains(buffer.get());
+            }
+        }
+
+        // any barrier orders all earlier compute work, so clearing every pending read here is sound
+        if (!bufferBarriers.empty() || !memoryBarriers.empty() || executionDependency) {
+            commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                                          vk::PipelineStageFlagBits::eComputeShader,
+                                          {},
+                                          memoryBarriers,
+                                          bufferBarriers,
+                                          {});
+            pendingReads.clear();
+            barrierCount++;
+        }
+
+        for (NodeId id : level) {
+            m_Nodes[id].Task->recordDispatch(commandBuffer);
+            for (const auto& buffer : m_Nodes[id].Reads) {
+                pendingReads.insert(buffer.get());
+            }
+            for (const auto& buffer : m_Nodes[id].Writes) {
+                unflushedWrites.insert(buffer.get());
+            }
+        }
+    }
+
+    return barrierCount;
+}
+
+} // namespace nn
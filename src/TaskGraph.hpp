@@ -0,0 +1,61 @@
+#pragma once
+#define VULKAN_HPP_NO_STRUCT_CONSTRUCTORS 1
+#include <vulkan/vulkan.hpp>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include "Buffer.hpp"
+#include "Task.hpp"
+
+namespace nn {
+
+// tasks added in program order together with the buffers they read and write.
+// hazards between them form a DAG that is scheduled level by level, tasks on the
+// same level share no buffers and run concurrently with no barrier between them.
+// buffers placed in the same arena count as one wherever their memory overlaps
+class TaskGraph {
+public:
+    using NodeId = size_t;
+
+    // reads the task's Src() and Params() and writes its Dst()
+    NodeId Add(std::shared_ptr<Task> task);
+    NodeId Add(std::shared_ptr<Task> task,
+               std::vector<std::shared_ptr<Buffer>> reads,
+               std::vector<std::shared_ptr<Buffer>> writes);
+
+    size_t Size() const { return m_Nodes.size(); }
+    bool Empty() const { return m_Nodes.empty(); }
+    size_t Depth() const; // number of levels, i.e. dispatches on the critical path
+    const std::vector<NodeId>& Dependencies(NodeId node) const { return m_Nodes[node].Dependencies; }
+
+    // splits the graph into groups of tasks with no hazard between groups, each can go to its own queue
+    std::vector<TaskGraph> Components() const;
+
+    // records the schedule and returns the number of pipeline barriers it needed
+    size_t Record(vk::CommandBuffer commandBuffer) const;
+
+private:
+    struct Node {
+        std::shared_ptr<nn::Task> Task;
+        std::vector<std::shared_ptr<Buffer>> Reads;
+        std::vector<std::shared_ptr<Buffer>> Writes;
+        std::vector<NodeId> Dependencies;
+        size_t Level;
+    };
+
+    struct Access {
+        std::optional<NodeId> Writer;
+        std::vector<NodeId> Readers; // since the last write
+    };
+
+    // the tracked buffers sharing memory with buffer, itself included once tracked
+    std::vector<Access*> aliases(const Buffer& buffer);
+
+    std::vector<Node> m_Nodes;
+    std::unordered_map<const Buffer*, Access> m_Accesses;
+    std::vector<const Buffer*> m_ArenaBuffers; // the tracked ones that may alias others
+
+    friend class ComputeEngine;
+};
+
+} // namespace nn
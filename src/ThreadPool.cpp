@@ -0,0 +1,80 @@
+#include "ThreadPool.hpp"
+#include <algorithm>
+
+namespace nn {
+
+ThreadPool::ThreadPool(size_t threads) {
+    for (size_t i = 1; i < std::max<size_t>(threads, 1); i++) {
+        m_Workers.emplace_back(&ThreadPool::run, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_Wake.notify_all();
+    for (auto& worker : m_Workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body) {
+    if (count == 0) {
+        return;
+    }
+    grain = std::max<size_t>(grain, 1);
+    if (m_Workers.empty() || count <= grain) {
+        body(0, count);
+        return;
+    }
+
+    std::lock_guard callerLock(m_CallerMutex);
+    {
+        std::lock_guard lock(m_Mutex);
+        m_Body = &body;
+        m_Count = count;
+        m_Grain = grain;
+        m_Next = 0;
+        m_Busy = m_Workers.size();
+        m_Generation++;
+    }
+    m_Wake.notify_all();
+
+    drain();
+
+    std::unique_lock lock(m_Mutex);
+    m_Done.wait(lock, [&] { return m_Busy == 0; });
+    m_Body = nullptr;
+}
+
+void ThreadPool::run() {
+    uint64_t generation = 0;
+    while (true) {
+        {
+            std::unique_lock lock(m_Mutex);
+            m_Wake.wait(lock, [&] { return m_Stop || m_Generation != generation; });
+            if (m_Stop) {
+                return;
+            }
+            generation = m_Generation;
+        }
+
+        drain();
+
+        std::lock_guard lock(m_Mutex);
+        if (--m_Busy == 0) {
+            m_Done.notify_one();
+        }
+    }
+}
+
+void ThreadPool::drain() {
+    // chunks are claimed dynamically so uneven work still balances
+    for (size_t begin = m_Next.fetch_add(m_Grain); begin < m_Count; begin = m_Next.fetch_add(m_Grain)) {
+        (*m_Body)(begin, std::min(begin + m_Grain, m_Count));
+    }
+}
+
+} // namespace nn
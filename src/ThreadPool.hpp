@@ -0,0 +1,44 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nn {
+
+// fixed set of workers that split loops with the calling thread, one loop at a time
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threads = std::thread::hardware_concurrency());
+    ThreadPool(const ThreadPool&) = delete;
+    void operator=(const ThreadPool&) = delete;
+    ~ThreadPool();
+
+    size_t Size() const { return m_Workers.size() + 1; } // the caller works too
+
+    // calls body(begin, end) on chunks of at most grain items covering [0, count), returns once all are done
+    void ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body);
+
+private:
+    void run();
+    void drain();
+
+    std::vector<std::thread> m_Workers;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    std::condition_variable m_Done;
+    const std::function<void(size_t, size_t)>* m_Body = nullptr;
+    size_t m_Count = 0;
+    size_t m_Grain = 1;
+    std::atomic<size_t> m_Next = 0;
+    size_t m_Busy = 0; // workers that have not finished the current loop
+    uint64_t m_Generation = 0;
+    bool m_Stop = false;
+
+    std::mutex m_CallerMutex; // serializes concurrent ParallelFor calls
+};
+
+} // namespace nn
@@ -0,0 +1,646 @@
+#include "Trainer.hpp"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <numbers>
+#include <stdexcept>
+#include "TaskBuilder.hpp"
+
+namespace nn {
+
+namespace {
+
+// must match the workgroup size in softmax_xent.comp
+constexpr uint32_t lossThreads = 256;
+
+} // namespace
+
+Trainer::Trainer(ComputeEngine& engine, const TrainerSpecification& spec)
+    : m_Engine(engine),
+      m_Spec(spec) {
+    if (spec.Widths.size() < 2) {
+        throw std::runtime_error("a trainer needs at least an input and an output width");
+    }
+
+    const uint32_t batch = spec.Batch;
+    const uint32_t classes = spec.Widths.back();
+
+    const uint32_t pixels = spec.Widths.front();
+    const bool augment = spec.MaxShift > 0 || spec.MaxRotation > 0.0f;
+    if ((augment || !spec.Convolutions.empty()) && (spec.ImageWidth == 0 || pixels % spec.ImageWidth != 0)) {
+        throw std::runtime_error("augmentation and convolutions need an image width that divides the input width");
+    }
+    const bool replicated = spec.Replicas > 1;
+    if (spec.Replicas == 0 || spec.Replica >= spec.Replicas) {
+        throw std::runtime_error("a replica index has to be below the number of replicas");
+    }
+
+    // each batch's bytes as they are in the dataset, the shaders read them four to a uint
+    m_PixelWords = (size_t(batch) * pixels + 3) / 4;
+    m_LabelWords = (batch + 3) / 4;
+    m_Pixels = engine.CreateBuffer(3 * m_PixelWords, sizeof(uint32_t), MemoryUsage::eHostVisible);
+    m_Labels = engine.CreateBuffer(3 * m_LabelWords, sizeof(uint32_t), MemoryUsage::eHostVisible);
+    std::shared_ptr<Buffer> input =
+        engine.CreateBuffer(size_t(batch) * pixels, sizeof(float), MemoryUsage::eDeviceLocal);
+    m_Stats = engine.CreateBuffer(2, sizeof(float), MemoryUsage::eReadback);
+
+    //--- Convolutions
+    // every stage keeps its tensors outside the arena, the dense layers start from the last stage's output
+    std::shared_ptr<Buffer> denseInput = input;
+    uint32_t denseInputs = pixels;
+    uint32_t height = spec.Convolutions.empty() ? 1 : pixels / spec.ImageWidth;
+    uint32_t width = spec.ImageWidth;
+    uint32_t channels = 1;
+    for (size_t s = 0; s < spec.Convolutions.size(); s++) {
+        const ConvStage& stage = spec.Convolutions[s];
+        if (stage.KernelSize % 2 == 0 || stage.Pool == 0) {
+            throw std::runtime_error("a convolution stage needs an odd kernel size and a pooling window");
+        }
+
+        auto conv = std::make_unique<Conv>(engine,
+                                           ConvSpecification{
+                                               .Batch = batch,
+                                               .Height = height,
+                                               .Width = width,
+                                               .Channels = channels,
+                                               .Filters = stage.Filters,
+                                               .KernelSize = stage.KernelSize,
+                                               .Padding = stage.KernelSize / 2,
+                                               .Function = spec.Hidden,
+                                               .Kernel = stage.Kernel,
+                                               .ShaderDirectory = spec.ShaderDirectory,
+                                           },
+                                           denseInput);
+        conv->Initialize(engine, spec.Seed + uint32_t(spec.Widths.size() - 1 + s));
+        const ConvSpecification& convSpec = conv->Specification();
+
+        // padded to keep the size, so the convolution's output has the input's height and width
+        const size_t convPixels = size_t(batch) * height * width;
+        ConvTensors tensors;
+        tensors.Output = conv->Output();
+        tensors.ConvGradient =
+            engine.CreateBuffer(convPixels * stage.Filters, sizeof(float), MemoryUsage::eDeviceLocal);
+        tensors.Gradient = tensors.ConvGradient;
+        if (stage.Pool > 1) {
+            PoolSpecification poolSpec = {
+                .Batch = batch,
+                .Height = height,
+                .Width = width,
+                .Channels = stage.Filters,
+                .Size = stage.Pool,
+                .ShaderDirectory = spec.ShaderDirectory,
+            };
+            tensors.Pool = CreatePoolTask(engine, poolSpec, conv->Output(), nullptr);
+            tensors.Output = tensors.Pool->Dst();
+            tensors.Gradient = engine.CreateBuffer(tensors.Output->Count, sizeof(float), MemoryUsage::eDeviceLocal);
+            height /= stage.Pool;
+            width /= stage.Pool;
+        }
+
+        // the im2col kernel already unrolls its input, the others leave it to the backward pass
+        tensors.Patches = conv->Patches();
+        if (!tensors.Patches) {
+            tensors.Patches =
+                engine.CreateBuffer(convPixels * convSpec.PatchSize(), sizeof(float), MemoryUsage::eDeviceLocal);
+        }
+        if (s > 0) {
+            tensors.PatchGradient =
+                engine.CreateBuffer(convPixels * convSpec.PatchSize(), sizeof(float), MemoryUsage::eDeviceLocal);
+        }
+
+        size_t parameters = size_t(convSpec.PatchSize()) * stage.Filters + stage.Filters;
+        std::vector<float> zeros(2 * parameters, 0.0f);
+        tensors.Moments = engine.CreateBuffer(2 * parameters, sizeof(float), MemoryUsage::eDeviceLocal);
+        engine.Upload(*tensors.Moments, std::span<const float>(zeros));
+
+        channels = stage.Filters;
+        denseInput = tensors.Output;
+        denseInputs = height * width * channels;
+        m_Convolutions.push_back(std::move(conv));
+        m_ConvTensors.push_back(std::move(tensors));
+    }
+    const bool hasConvolutions = !m_Convolutions.empty();
+
+    //--- Schedule
+    // activation i is the input of layer i, so 0 is the preprocessed batch and the last one the logits.
+    // a hidden activation that is not a checkpoint only lives until the next layer has read it, the backward
+    // pass recomputes it from the checkpoint below
+    const size_t layerCount = spec.Widths.size() - 1;
+    auto checkpoint = [&](size_t i) {
+        return i == 0 || i == layerCount || spec.Checkpoint == 0 || i % spec.Checkpoint == 0;
+    };
+
+    enum class StepKind { eForward, eLoss, eRecompute, eBackward, eUpdate };
+    struct ScheduleStep {
+        StepKind Kind;
+        size_t Layer; // the activation for eRecompute
+    };
+
+    // program order, the input gradient has to read the weights before they are updated
+    std::vector<ScheduleStep> schedule;
+    for (size_t i = 0; i < layerCount; i++) {
+        schedule.push_back({StepKind::eForward, i});
+    }
+    schedule.push_back({StepKind::eLoss, layerCount - 1});
+    size_t recomputedFrom = layerCount;
+    for (size_t i = layerCount; i-- > 0;) {
+        if (!checkpoint(i) && i < recomputedFrom) {
+            recomputedFrom = i;
+            while (!checkpoint(recomputedFrom - 1)) {
+                recomputedFrom--;
+            }
+            for (size_t k = recomputedFrom; k <= i; k++) {
+                schedule.push_back({StepKind::eRecompute, k});
+            }
+        }
+        if (i > 0 || hasConvolutions) {
+            schedule.push_back({StepKind::eBackward, i});
+        }
+        schedule.push_back({StepKind::eUpdate, i});
+    }
+
+    //--- Memory
+    using TensorId = MemoryPlanner::TensorId;
+    MemoryPlanner planner;
+    std::vector<TensorId> activations(layerCount + 1), recomputed(layerCount + 1), gradients(layerCount);
+    for (size_t i = 1; i <= layerCount; i++) {
+        activations[i] = planner.AddTensor(size_t(batch) * spec.Widths[i], sizeof(float));
+        if (!checkpoint(i)) {
+            recomputed[i] = planner.AddTensor(size_t(batch) * spec.Widths[i], sizeof(float));
+        }
+    }
+    for (size_t i = 0; i < layerCount; i++) {
+        gradients[i] = planner.AddTensor(size_t(batch) * spec.Widths[i + 1], sizeof(float));
+    }
+
+    // activation i as the backward pass reads it, the input is not planned
+    auto saved = [&](size_t i) { return checkpoint(i) ? activations[i] : recomputed[i]; };
+    auto withInput = [](size_t i, TensorId activation, std::vector<TensorId> tensors) {
+        if (i > 0) {
+            tensors.push_back(activation);
+        }
+        return tensors;
+    };
+    for (const ScheduleStep& step : schedule) {
+        size_t i = step.Layer;
+        switch (step.Kind) {
+            case StepKind::eForward:
+                planner.AddStep(withInput(i, activations[i], {activations[i + 1]}));
+                break;
+            case StepKind::eLoss:
+                planner.AddStep({activations[layerCount], gradients[layerCount - 1]});
+                break;
+            case StepKind::eRecompute:
+                planner.AddStep(withInput(i - 1, saved(i - 1), {recomputed[i]}));
+                break;
+            case StepKind::eBackward:
+                // the first layer's input gradient goes to the last convolution stage
+                planner.AddStep(i > 0 ? std::vector<TensorId>{gradients[i], saved(i + 1), gradients[i - 1]}
+                                      : std::vector<TensorId>{gradients[i], saved(i + 1)});
+                break;
+            case StepKind::eUpdate:
+                planner.AddStep(withInput(i, saved(i), {gradients[i], saved(i + 1)}));
+                break;
+        }
+    }
+
+    m_Memory = planner.Plan(engine.ArenaAlignment());
+    std::vector<std::shared_ptr<Buffer>> tensors;
+    if (spec.PlanMemory) {
+        tensors = planner.Allocate(engine, m_Memory);
+    } else {
+        for (TensorId id = 0; id < planner.TensorCount(); id++) {
+            tensors.push_back(engine.CreateBuffer(planner.Count(id), sizeof(float), MemoryUsage::eDeviceLocal));
+        }
+    }
+    auto activation = [&](size_t i) { return i == 0 ? denseInput : tensors[activations[i]]; };
+    auto savedActivation = [&](size_t i) { return i == 0 ? denseInput : tensors[saved(i)]; };
+
+    //--- Layers
+    for (size_t i = 0; i < layerCount; i++) {
+        DenseSpecification layerSpec = {
+            .Inputs = i == 0 ? denseInputs : spec.Widths[i],
+            .Outputs = spec.Widths[i + 1],
+            .Batch = batch,
+            .Function = i + 1 == layerCount ? Activation::eNone : spec.Hidden,
+            .ShaderDirectory = spec.ShaderDirectory,
+        };
+        auto layer = std::make_unique<Dense>(engine, layerSpec, activation(i), activation(i + 1));
+        layer->Initialize(engine, spec.Seed + uint32_t(i));
+
+        size_t parameters = size_t(layerSpec.Inputs) * layerSpec.Outputs + layerSpec.Outputs;
+        std::vector<float> zeros(2 * parameters, 0.0f);
+        m_Moments.push_back(engine.CreateBuffer(2 * parameters, sizeof(float), MemoryUsage::eDeviceLocal));
+        engine.Upload(*m_Moments.back(), std::span<const float>(zeros));
+
+        m_Gradients.push_back(tensors[gradients[i]]);
+        m_Layers.push_back(std::move(layer));
+    }
+
+    //--- Tasks
+    // a replica's step is cut after every parameter gradient, each layer's update is its own graph
+    if (replicated) {
+        m_Segments.emplace_back();
+    }
+    auto trainGraph = [&]() -> TaskGraph& { return replicated ? m_Segments.back() : m_TrainGraph; };
+
+    // unpacks straight into the first layer's input, no float copy of the batch exists anywhere else
+    TaskBuilder preprocessBuilder(engine);
+    preprocessBuilder.SetShader(spec.ShaderDirectory + "/preprocess.comp.spv");
+    preprocessBuilder.SetSrcBuffer(m_Pixels);
+    preprocessBuilder.SetDstBuffer(input);
+    preprocessBuilder.SetPipeline({
+        .bindings = StorageBindings(2),
+        .constants =
+            {
+                batch,
+                pixels,
+                augment ? spec.ImageWidth : pixels,
+                std::bit_cast<uint32_t>(spec.Mean),
+                std::bit_cast<uint32_t>(spec.Deviation),
+                spec.MaxShift,
+                std::bit_cast<uint32_t>(spec.MaxRotation * std::numbers::pi_v<float> / 180.0f),
+            },
+        .pushConstantSize = sizeof(Preprocess),
+    });
+    preprocessBuilder.SetInvocations(batch * pixels);
+    m_Preprocess = preprocessBuilder.create();
+    trainGraph().Add(m_Preprocess);
+    m_EvalGraph.Add(m_Preprocess);
+
+    for (size_t s = 0; s < m_Convolutions.size(); s++) {
+        std::vector<std::shared_ptr<Task>> forward = m_Convolutions[s]->Forward();
+        if (m_ConvTensors[s].Pool) {
+            forward.push_back(m_ConvTensors[s].Pool);
+        }
+        for (const auto& task : forward) {
+            trainGraph().Add(task);
+            m_EvalGraph.Add(task);
+        }
+    }
+
+    TaskBuilder lossBuilder(engine);
+    lossBuilder.SetShader(spec.ShaderDirectory + "/softmax_xent.comp.spv");
+    lossBuilder.SetSrcBuffer(m_Layers.back()->Output());
+    lossBuilder.SetDstBuffer(m_Gradients.back());
+    lossBuilder.AddBuffer(m_Labels);
+    lossBuilder.AddBuffer(m_Stats);
+    lossBuilder.SetPipeline({
+        .bindings = StorageBindings(4),
+        .constants = {batch, classes},
+        .pushConstantSize = sizeof(Labels),
+    });
+    lossBuilder.SetWorkgroupSize(lossThreads);
+    lossBuilder.SetInvocations(lossThreads);
+    m_Loss = lossBuilder.create();
+
+    // the optimizer step of a dense layer, or of a convolution as the dense layer over its patches that it is,
+    // shape is {rows, outputs, inputs, activation}. a replica writes the parameter gradients out instead, ends
+    // the segment there and applies the summed ones in a graph of their own
+    std::vector<uint32_t> optimizer = {
+        static_cast<uint32_t>(spec.Method),
+        std::bit_cast<uint32_t>(spec.Beta1),
+        std::bit_cast<uint32_t>(spec.Beta2),
+        std::bit_cast<uint32_t>(spec.Epsilon),
+    };
+    auto addUpdate = [&](const std::vector<uint32_t>& shape,
+                         std::shared_ptr<Buffer> gradient,
+                         std::shared_ptr<Buffer> inputs,
+                         std::shared_ptr<Buffer> outputs,
+                         std::shared_ptr<Buffer> weights,
+                         std::shared_ptr<Buffer> bias,
+                         std::shared_ptr<Buffer> moments) {
+        const uint32_t parameters = shape[2] * shape[1] + shape[1];
+
+        if (replicated) {
+            m_ParameterGradients.push_back(engine.CreateBuffer(parameters, sizeof(float), MemoryUsage::eReadback));
+
+            TaskBuilder gradientBuilder(engine);
+            gradientBuilder.SetShader(spec.ShaderDirectory + "/dense_gradient.comp.spv");
+            gradientBuilder.SetSrcBuffer(gradient);
+            gradientBuilder.SetDstBuffer(m_ParameterGradients.back());
+            gradientBuilder.AddBuffer(inputs);
+            gradientBuilder.AddBuffer(outputs);
+            gradientBuilder.SetPipeline({
+                .bindings = StorageBindings(4),
+                .constants = shape,
+            });
+            gradientBuilder.SetInvocations(parameters);
+            m_Segments.back().Add(gradientBuilder.create(), {gradient, inputs, outputs}, {m_ParameterGradients.back()});
+            m_Segments.emplace_back();
+
+            std::vector<uint32_t> constants = {shape[1], shape[2]};
+            constants.insert(constants.end(), optimizer.begin(), optimizer.end());
+            constants.push_back(std::bit_cast<uint32_t>(1.0f / float(spec.Replicas)));
+
+            TaskBuilder applyBuilder(engine);
+            applyBuilder.SetShader(spec.ShaderDirectory + "/dense_apply.comp.spv");
+            applyBuilder.SetSrcBuffer(m_ParameterGradients.back());
+            applyBuilder.SetDstBuffer(weights);
+            applyBuilder.AddBuffer(bias);
+            applyBuilder.AddBuffer(moments);
+            applyBuilder.SetPipeline({
+                .bindings = StorageBindings(4),
+                .constants = constants,
+                .pushConstantSize = sizeof(State),
+            });
+            applyBuilder.SetInvocations(parameters);
+            m_Updates.push_back(applyBuilder.create());
+            m_Applies.emplace_back();
+            m_Applies.back().Add(m_Updates.back(), {m_ParameterGradients.back()}, {weights, bias, moments});
+            return;
+        }
+
+        std::vector<uint32_t> constants = shape;
+        constants.insert(constants.end(), optimizer.begin(), optimizer.end());
+
+        TaskBuilder updateBuilder(engine);
+        updateBuilder.SetShader(spec.ShaderDirectory + "/dense_update.comp.spv");
+        updateBuilder.SetSrcBuffer(gradient);
+        updateBuilder.SetDstBuffer(weights);
+        updateBuilder.AddBuffer(inputs);
+        updateBuilder.AddBuffer(outputs);
+        updateBuilder.AddBuffer(bias);
+        updateBuilder.AddBuffer(moments);
+        updateBuilder.SetPipeline({
+            .bindings = StorageBindings(6),
+            .constants = constants,
+            .pushConstantSize = sizeof(State),
+        });
+        updateBuilder.SetInvocations(parameters);
+        m_Updates.push_back(updateBuilder.create());
+        m_TrainGraph.Add(m_Updates.back(), {gradient, inputs, outputs}, {weights, bias, moments});
+    };
+
+    for (const ScheduleStep& step : schedule) {
+        const size_t i = step.Layer;
+        const Dense& layer = *m_Layers[step.Kind == StepKind::eRecompute ? i - 1 : i];
+        const DenseSpecification& layerSpec = layer.Specification();
+        std::vector<uint32_t> shape = {
+            batch, layerSpec.Outputs, layerSpec.Inputs, static_cast<uint32_t>(layerSpec.Function)};
+
+        switch (step.Kind) {
+            case StepKind::eForward:
+                trainGraph().Add(layer.Forward());
+                m_EvalGraph.Add(layer.Forward());
+                break;
+            case StepKind::eLoss:
+                trainGraph().Add(m_Loss, {layer.Output(), m_Labels}, {m_Gradients.back(), m_Stats});
+                m_EvalGraph.Add(m_Loss, {layer.Output(), m_Labels}, {m_Gradients.back(), m_Stats});
+                break;
+            case StepKind::eRecompute:
+                // the same kernel over the same weights, so the result is bit for bit what the forward pass had
+                trainGraph().Add(CreateGemmTask(
+                    engine, layerSpec, savedActivation(i - 1), savedActivation(i), layer.Weights(), layer.Bias()));
+                break;
+            case StepKind::eBackward: {
+                std::shared_ptr<Buffer> inputGradient = i > 0 ? m_Gradients[i - 1] : m_ConvTensors.back().Gradient;
+                TaskBuilder backwardBuilder(engine);
+                backwardBuilder.SetShader(spec.ShaderDirectory + "/dense_backward.comp.spv");
+                backwardBuilder.SetSrcBuffer(m_Gradients[i]);
+                backwardBuilder.SetDstBuffer(inputGradient);
+                backwardBuilder.AddBuffer(savedActivation(i + 1));
+                backwardBuilder.AddBuffer(layer.Weights());
+                backwardBuilder.SetPipeline({
+                    .bindings = StorageBindings(4),
+                    .constants = shape,
+                });
+                trainGraph().Add(backwardBuilder.create(),
+                                 {m_Gradients[i], savedActivation(i + 1), layer.Weights()},
+                                 {inputGradient});
+                break;
+            }
+            case StepKind::eUpdate:
+                addUpdate(shape,
+                          m_Gradients[i],
+                          savedActivation(i),
+                          savedActivation(i + 1),
+                          layer.Weights(),
+                          layer.Bias(),
+                          m_Moments[i]);
+                break;
+        }
+    }
+
+    // the convolutions last to first, each as a dense layer over its patches: pooling routes the gradient to the
+    // maxima, and every stage but the first folds its patches' gradient back onto its input before the update
+    for (size_t s = m_Convolutions.size(); s-- > 0;) {
+        const Conv& conv = *m_Convolutions[s];
+        const ConvSpecification& convSpec = conv.Specification();
+        const ConvTensors& stage = m_ConvTensors[s];
+        const std::vector<uint32_t> unroll = {
+            batch, convSpec.Height, convSpec.Width, convSpec.Channels, convSpec.KernelSize, convSpec.Padding};
+        std::vector<uint32_t> shape = {batch * convSpec.OutputHeight() * convSpec.OutputWidth(),
+                                       convSpec.Filters,
+                                       convSpec.PatchSize(),
+                                       static_cast<uint32_t>(convSpec.Function)};
+
+        if (stage.Pool) {
+            TaskBuilder poolBuilder(engine);
+            poolBuilder.SetShader(spec.ShaderDirectory + "/maxpool_backward.comp.spv");
+            poolBuilder.SetSrcBuffer(stage.Gradient);
+            poolBuilder.SetDstBuffer(stage.ConvGradient);
+            poolBuilder.AddBuffer(conv.Output());
+            poolBuilder.SetPipeline({
+                .bindings = StorageBindings(3),
+                .constants = {batch,
+                              convSpec.OutputHeight(),
+                              convSpec.OutputWidth(),
+                              convSpec.Filters,
+                              spec.Convolutions[s].Pool},
+            });
+            trainGraph().Add(poolBuilder.create());
+        }
+
+        if (stage.Patches != conv.Patches()) {
+            TaskBuilder im2colBuilder(engine);
+            im2colBuilder.SetShader(spec.ShaderDirectory + "/im2col.comp.spv");
+            im2colBuilder.SetSrcBuffer(conv.Input());
+            im2colBuilder.SetDstBuffer(stage.Patches);
+            im2colBuilder.SetPipeline({
+                .bindings = StorageBindings(2),
+                .constants = unroll,
+            });
+            trainGraph().Add(im2colBuilder.create());
+        }
+
+        if (s > 0) {
+            TaskBuilder backwardBuilder(engine);
+            backwardBuilder.SetShader(spec.ShaderDirectory + "/dense_backward.comp.spv");
+            backwardBuilder.SetSrcBuffer(stage.ConvGradient);
+            backwardBuilder.SetDstBuffer(stage.PatchGradient);
+            backwardBuilder.AddBuffer(conv.Output());
+            backwardBuilder.AddBuffer(conv.Weights());
+            backwardBuilder.SetPipeline({
+                .bindings = StorageBindings(4),
+                .constants = shape,
+            });
+            trainGraph().Add(backwardBuilder.create());
+
+            TaskBuilder col2imBuilder(engine);
+            col2imBuilder.SetShader(spec.ShaderDirectory + "/col2im.comp.spv");
+            col2imBuilder.SetSrcBuffer(stage.PatchGradient);
+            col2imBuilder.SetDstBuffer(m_ConvTensors[s - 1].Gradient);
+            col2imBuilder.SetPipeline({
+                .bindings = StorageBindings(2),
+                .constants = unroll,
+            });
+            trainGraph().Add(col2imBuilder.create());
+        }
+
+        addUpdate(shape, stage.ConvGradient, stage.Patches, conv.Output(), conv.Weights(), conv.Bias(), stage.Moments);
+    }
+
+    // the last update ended a segment that nothing follows
+    if (replicated) {
+        m_Segments.pop_back();
+    }
+}
+
+double Trainer::Flops() const {
+    double flops = 0.0;
+    for (const auto& conv : m_Convolutions) {
+        flops += conv->Flops();
+    }
+    for (const auto& layer : m_Layers) {
+        flops += layer->Flops();
+    }
+    return flops;
+}
+
+StepResult Trainer::Step(std::span<const uint8_t> images, std::span<const uint8_t> labels) {
+    if (m_Spec.Replicas > 1) {
+        throw std::runtime_error("a replica only steps together with the others, see DataParallelTrainer");
+    }
+
+    m_Step++;
+    State state = {
+        .Step = uint32_t(m_Step),
+        .LearningRate = m_Spec.LearningRate,
+    };
+    for (const auto& update : m_Updates) {
+        update->SetPushConstants(state);
+    }
+    return run(m_TrainGraph, true, images, labels);
+}
+
+StepResult Trainer::Evaluate(std::span<const uint8_t> images, std::span<const uint8_t> labels) {
+    return run(m_EvalGraph, false, images, labels);
+}
+
+StepResult Trainer::run(const TaskGraph& graph,
+                        bool augment,
+                        std::span<const uint8_t> images,
+                        std::span<const uint8_t> labels) {
+    m_Engine.Wait(submit(graph, augment, images, labels));
+    return stats();
+}
+
+SubmitHandle Trainer::submit(const TaskGraph& graph,
+                             bool augment,
+                             std::span<const uint8_t> images,
+                             std::span<const uint8_t> labels) {
+    if (images.size() != size_t(m_Spec.Batch) * m_Spec.Widths.front() || labels.size() != m_Spec.Batch) {
+        throw std::runtime_error("batch does not match the trainer's batch size");
+    }
+
+    // a batch packed into one of the BatchSlots is read in place, anything else is copied into the third batch
+    std::array<BatchSlot, 2> slots = BatchSlots();
+    size_t slot = 0;
+    while (slot < slots.size() &&
+           (images.data() != slots[slot].Images.data() || labels.data() != slots[slot].Labels.data())) {
+        slot++;
+    }
+    if (slot == slots.size()) {
+        std::ranges::copy(images, m_Pixels->View<uint8_t>().begin() + slot * m_PixelWords * sizeof(uint32_t));
+        std::ranges::copy(labels, m_Labels->View<uint8_t>().begin() + slot * m_LabelWords * sizeof(uint32_t));
+    }
+
+    // a new draw every step, the shader hashes it with the sample index. replicas draw apart from each other
+    m_Preprocess->SetPushConstants(Preprocess{
+        .Seed = (m_Spec.Seed + m_Spec.Replica * 0x85ebca6bu) ^ uint32_t(m_Step) * 0x9e3779b9u,
+        .Augment = augment ? 1u : 0u,
+        .Offset = uint32_t(slot * m_PixelWords),
+    });
+    m_Loss->SetPushConstants(Labels{
+        .Offset = uint32_t(slot * m_LabelWords),
+    });
+
+    return m_Engine.ExecuteGraph(graph);
+}
+
+StepResult Trainer::stats() const {
+    std::span<float> values = m_Stats->View<float>();
+    return {
+        .Loss = values[0],
+        .Accuracy = values[1],
+    };
+}
+
+std::vector<SubmitHandle> Trainer::submitGradients(std::span<const uint8_t> images,
+                                                   std::span<const uint8_t> labels) {
+    m_Step++;
+    State state = {
+        .Step = uint32_t(m_Step),
+        .LearningRate = m_Spec.LearningRate,
+    };
+    for (const auto& update : m_Updates) {
+        update->SetPushConstants(state);
+    }
+
+    // every segment goes to the same stream, so each starts once the one before it is done
+    std::vector<SubmitHandle> handles = {submit(m_Segments.front(), true, images, labels)};
+    for (size_t segment = 1; segment < m_Segments.size(); segment++) {
+        handles.push_back(m_Engine.ExecuteGraph(m_Segments[segment]));
+    }
+    return handles;
+}
+
+SubmitHandle Trainer::submitUpdate(size_t segment) {
+    return m_Engine.ExecuteGraph(m_Applies[segment]);
+}
+
+std::array<BatchSlot, 2> Trainer::BatchSlots() const {
+    std::span<uint8_t> pixels = m_Pixels->View<uint8_t>();
+    std::span<uint8_t> labels = m_Labels->View<uint8_t>();
+    const size_t imageBytes = size_t(m_Spec.Batch) * m_Spec.Widths.front();
+
+    std::array<BatchSlot, 2> slots;
+    for (size_t slot = 0; slot < slots.size(); slot++) {
+        slots[slot] = {
+            .Images = pixels.subspan(slot * m_PixelWords * sizeof(uint32_t), imageBytes),
+            .Labels = labels.subspan(slot * m_LabelWords * sizeof(uint32_t), m_Spec.Batch),
+        };
+    }
+    return slots;
+}
+
+EpochResult Trainer::TrainEpoch(BatchPrefetcher& prefetcher) {
+    const size_t imageSize = m_Spec.Widths.front();
+
+    EpochResult result = {};
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t batch = 0; batch < prefetcher.BatchesPerEpoch(); batch++) {
+        const BatchSlot& slot = prefetcher.Next();
+        if (slot.Count != m_Spec.Batch) {
+            continue;
+        }
+
+        StepResult step = Step(slot.Images.first(slot.Count * imageSize), slot.Labels.first(slot.Count));
+        result.Loss += step.Loss;
+        result.Accuracy += step.Accuracy;
+        result.Images += slot.Count;
+        result.UploadBytes += UploadBytes();
+    }
+    result.Seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+    size_t steps = result.Images / m_Spec.Batch;
+    if (steps > 0) {
+        result.Loss /= float(steps);
+        result.Accuracy /= float(steps);
+    }
+    result.ImagesPerSecond = result.Seconds > 0.0 ? double(result.Images) / result.Seconds : 0.0;
+    return result;
+}
+
+} // namespace nn
@@ -0,0 +1,185 @@
+#pragma once
+#include <array>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+#include "ComputeEngine.hpp"
+#include "Conv.hpp"
+#include "Dataset.hpp"
+#include "Dense.hpp"
+#include "MemoryPlanner.hpp"
+#include "TaskGraph.hpp"
+
+namespace nn {
+
+enum class Optimizer : uint32_t {
+    eSgd,  // with momentum Beta1, 0 for plain sgd
+    eAdam,
+};
+
+// a convolution ahead of the dense layers, padded to keep the image's size, then max pooled
+struct ConvStage {
+    uint32_t Filters;
+    uint32_t KernelSize = 3;               // odd
+    uint32_t Pool = 2;                     // window and stride of the max pooling, 1 for none
+    ConvKernel Kernel = ConvKernel::eAuto; // of the forward pass, the backward pass always works on im2col patches
+};
+
+struct TrainerSpecification {
+    std::vector<uint32_t> Widths; // input size, hidden layers, classes, e.g. {784, 128, 10}
+    uint32_t Batch = 128;
+    Activation Hidden = Activation::eRelu;
+    Optimizer Method = Optimizer::eAdam;
+    float LearningRate = 1e-3f;
+    float Beta1 = 0.9f;
+    float Beta2 = 0.999f;
+    float Epsilon = 1e-8f;
+    uint32_t Seed = 0;
+    std::string ShaderDirectory = "tests/spirv";
+    bool PlanMemory = true; // activations and gradients share one arena wherever their lifetimes allow
+    // keep every n-th hidden activation for the backward pass and recompute the ones between, 0 keeps them all.
+    // a layer's Output() then only holds its value until the next layer has read it
+    uint32_t Checkpoint = 0;
+    // the raw bytes are uploaded and turned into the first layer's input on the device,
+    // (pixel / 255 - Mean) / Deviation
+    float Mean = 0.0f;
+    float Deviation = 1.0f;
+    // random shift and rotation of every training image, evaluation sees them unchanged
+    uint32_t ImageWidth = 28; // Widths.front() / ImageWidth rows, only needed to augment
+    uint32_t MaxShift = 0;    // pixels in either direction
+    float MaxRotation = 0.0f; // degrees in either direction
+    // one of Replicas data-parallel copies driven by a DataParallelTrainer, Batch is then its shard. the
+    // parameter gradients go to host-visible memory to be summed across replicas before the optimizer runs
+    uint32_t Replicas = 1;
+    uint32_t Replica = 0; // only changes the augmentation draws, every replica starts from the same parameters
+    // over the single-channel ImageWidth wide images in order, with Hidden as their activation. the first dense
+    // layer then takes the last stage's flattened NHWC output instead of Widths.front() inputs
+    std::vector<ConvStage> Convolutions = {};
+};
+
+struct StepResult {
+    float Loss;     // mean cross-entropy over the batch
+    float Accuracy; // fraction of the batch classified correctly
+};
+
+struct EpochResult {
+    float Loss;
+    float Accuracy;
+    size_t Images;
+    double Seconds;
+    double ImagesPerSecond;
+    size_t UploadBytes; // host to device, see Trainer::UploadBytes
+};
+
+// multilayer perceptron trained entirely on the device: preprocessing, forward, softmax cross-entropy, backward
+// and the optimizer update run as one submission per step. the only upload is the batch's packed bytes and the
+// only readback the loss and accuracy
+class Trainer {
+    friend class DataParallelTrainer;
+
+public:
+    Trainer(ComputeEngine& engine, const TrainerSpecification& spec);
+
+    // one optimizer step on exactly Batch images of Widths.front() pixels, and Batch labels.
+    // a replica of several is stepped by its DataParallelTrainer instead
+    StepResult Step(std::span<const uint8_t> images, std::span<const uint8_t> labels);
+    // forward and loss only, the parameters are left untouched
+    StepResult Evaluate(std::span<const uint8_t> images, std::span<const uint8_t> labels);
+
+    // trains on one epoch from the prefetcher, a short final batch is skipped
+    EpochResult TrainEpoch(BatchPrefetcher& prefetcher);
+    // two slots in the trainer's own host-visible batch memory for a BatchPrefetcher to pack into. a batch
+    // from either is read by the device where it lies, any other batch is copied into a third one first
+    std::array<BatchSlot, 2> BatchSlots() const;
+
+    const std::vector<std::unique_ptr<Dense>>& Layers() const { return m_Layers; }
+    const std::vector<std::unique_ptr<Conv>>& Convolutions() const { return m_Convolutions; }
+    const TrainerSpecification& Specification() const { return m_Spec; }
+    // applies from the next step on, e.g. for a schedule, nothing is rebuilt
+    void SetLearningRate(float learningRate) { m_Spec.LearningRate = learningRate; }
+    size_t Steps() const { return m_Step; }
+    // bytes the device reads from host memory per batch, the images and labels as they are in the dataset
+    size_t UploadBytes() const { return (m_PixelWords + m_LabelWords) * sizeof(uint32_t); }
+    // device memory of the dense layers' activations and gradients with and without the arena
+    const MemoryPlan& Memory() const { return m_Memory; }
+    // multiply-adds of one forward pass over a batch counted as two operations
+    double Flops() const;
+
+private:
+    // push constants of dense_update.comp
+    struct State {
+        uint32_t Step;
+        float LearningRate;
+    };
+
+    // push constants of preprocess.comp
+    struct Preprocess {
+        uint32_t Seed;
+        uint32_t Augment;
+        uint32_t Offset; // of the batch in m_Pixels, in uints
+    };
+
+    // push constants of softmax_xent.comp
+    struct Labels {
+        uint32_t Offset; // of the batch in m_Labels, in uints
+    };
+
+    // what a convolution stage keeps for its backward pass, outside the arena
+    struct ConvTensors {
+        std::shared_ptr<Task> Pool;            // empty without pooling
+        std::shared_ptr<Buffer> Output;        // pooled
+        std::shared_ptr<Buffer> Gradient;      // d loss / d Output
+        std::shared_ptr<Buffer> ConvGradient;  // d loss / d the convolution's output, Gradient without pooling
+        std::shared_ptr<Buffer> Patches;       // the convolution's unrolled input
+        std::shared_ptr<Buffer> PatchGradient; // every stage but the first
+        std::shared_ptr<Buffer> Moments;
+    };
+
+    StepResult run(const TaskGraph& graph,
+                   bool augment,
+                   std::span<const uint8_t> images,
+                   std::span<const uint8_t> labels);
+    SubmitHandle submit(const TaskGraph& graph,
+                        bool augment,
+                        std::span<const uint8_t> images,
+                        std::span<const uint8_t> labels);
+    StepResult stats() const;
+
+    //--- Replicas
+    // submits a step up to the parameter gradients, one submission per layer from the last, so the first
+    // layers' gradients can be summed while the device still works on the ones before them
+    std::vector<SubmitHandle> submitGradients(std::span<const uint8_t> images, std::span<const uint8_t> labels);
+    // applies the summed gradients of the layer the segment-th submission above finished
+    SubmitHandle submitUpdate(size_t segment);
+    std::span<float> parameterGradients(size_t segment) const { return m_ParameterGradients[segment]->View<float>(); }
+
+    ComputeEngine& m_Engine;
+    TrainerSpecification m_Spec;
+    std::vector<std::unique_ptr<Dense>> m_Layers;
+    std::vector<std::unique_ptr<Conv>> m_Convolutions;
+    std::vector<ConvTensors> m_ConvTensors;
+
+    // host-visible, the device unpacks them. each holds three batches, the two BatchSlots and one for copies
+    std::shared_ptr<Buffer> m_Pixels;
+    std::shared_ptr<Buffer> m_Labels;
+    size_t m_PixelWords = 0; // uints per batch
+    size_t m_LabelWords = 0;
+    std::shared_ptr<Task> m_Preprocess;
+    std::shared_ptr<Task> m_Loss;
+    std::shared_ptr<Buffer> m_Stats;
+    std::vector<std::shared_ptr<Buffer>> m_Gradients; // d loss / d output of every layer
+    std::vector<std::shared_ptr<Buffer>> m_Moments;
+    std::vector<std::shared_ptr<Task>> m_Updates; // one per layer, last layer first
+    // replicas only, in the order of m_Updates
+    std::vector<std::shared_ptr<Buffer>> m_ParameterGradients; // host-visible, weights then biases
+    std::vector<TaskGraph> m_Segments;                         // the train graph cut after every gradient
+    std::vector<TaskGraph> m_Applies;
+    MemoryPlan m_Memory;
+
+    TaskGraph m_TrainGraph;
+    TaskGraph m_EvalGraph;
+    size_t m_Step = 0;
+};
+
+} // namespace nn
@@ -0,0 +1,135 @@
+#include "VulkanBackend.hpp"
+#include <stdexcept>
+#include "Dense.hpp"
+#include "TaskBuilder.hpp"
+
+namespace nn {
+
+namespace {
+
+enum Operation {
+    eGemm,
+    eActivate,
+    eSumRows,
+};
+
+const VulkanTensor& vulkan(const Tensor& tensor) {
+    return static_cast<const VulkanTensor&>(tensor);
+}
+
+const Buffer* storage(const Tensor& tensor) {
+    return vulkan(tensor).Storage.get();
+}
+
+} // namespace
+
+VulkanBackend::VulkanBackend(const EngineConfig& config, std::string shaderDirectory)
+    : m_Engine(std::make_unique<ComputeEngine>(config)),
+      m_ShaderDirectory(std::move(shaderDirectory)) {}
+
+std::string VulkanBackend::Name() const {
+    return std::string("vulkan ") + m_Engine->GPU().getProperties().deviceName.data();
+}
+
+std::unique_ptr<Tensor> VulkanBackend::CreateTensor(uint32_t rows, uint32_t cols) {
+    return std::make_unique<VulkanTensor>(
+        rows, cols, m_Engine->CreateBuffer(size_t(rows) * cols, sizeof(float), MemoryUsage::eDeviceLocal));
+}
+
+void VulkanBackend::Write(Tensor& tensor, std::span<const float> data) {
+    if (data.size() != tensor.Count()) {
+        throw std::runtime_error("tensor write size mismatch");
+    }
+    // queued operations may still read the old contents
+    Finish();
+    m_Engine->Upload(*vulkan(tensor).Storage, data);
+}
+
+void VulkanBackend::Read(const Tensor& tensor, std::span<float> data) {
+    if (data.size() != tensor.Count()) {
+        throw std::runtime_error("tensor read size mismatch");
+    }
+    Finish();
+    m_Engine->Download(*vulkan(tensor).Storage, data);
+}
+
+void VulkanBackend::Gemm(const Tensor& src,
+                         const Tensor& weights,
+                         const Tensor& bias,
+                         Tensor& dst,
+                         Activation function) {
+    if (weights.Rows() != src.Cols() || bias.Count() != weights.Cols() || dst.Rows() != src.Rows() ||
+        dst.Cols() != weights.Cols()) {
+        throw std::runtime_error("gemm shape mismatch");
+    }
+
+    TaskKey key = {eGemm, storage(src), storage(weights), storage(bias), storage(dst), function};
+    std::shared_ptr<Task>& task = m_Tasks[key];
+    if (!task) {
+        DenseSpecification spec = {
+            .Inputs = src.Cols(),
+            .Outputs = dst.Cols(),
+            .Batch = src.Rows(),
+            .Function = function,
+            .ShaderDirectory = m_ShaderDirectory,
+        };
+        task = CreateGemmTask(*m_Engine,
+                              spec,
+                              vulkan(src).Storage,
+                              vulkan(dst).Storage,
+                              vulkan(weights).Storage,
+                              vulkan(bias).Storage);
+    }
+    m_Pending.Add(task);
+}
+
+void VulkanBackend::Activate(const Tensor& src, Tensor& dst, Activation function) {
+    if (src.Count() != dst.Count()) {
+        throw std::runtime_error("activation size mismatch");
+    }
+
+    TaskKey key = {eActivate, storage(src), storage(dst), nullptr, nullptr, function};
+    std::shared_ptr<Task>& task = m_Tasks[key];
+    if (!task) {
+        task = elementwiseTask("activate.comp.spv", src, dst, {uint32_t(src.Count()), uint32_t(function)});
+    }
+    m_Pending.Add(task, {vulkan(src).Storage}, {vulkan(dst).Storage});
+}
+
+void VulkanBackend::SumRows(const Tensor& src, Tensor& dst) {
+    if (dst.Count() != src.Cols()) {
+        throw std::runtime_error("row sum size mismatch");
+    }
+
+    TaskKey key = {eSumRows, storage(src), storage(dst), nullptr, nullptr, Activation::eNone};
+    std::shared_ptr<Task>& task = m_Tasks[key];
+    if (!task) {
+        task = elementwiseTask("sum_rows.comp.spv", src, dst, {src.Rows(), src.Cols()});
+    }
+    m_Pending.Add(task);
+}
+
+void VulkanBackend::Finish() {
+    if (m_Pending.Empty()) {
+        return;
+    }
+    m_Engine->Wait(m_Engine->ExecuteGraph(m_Pending));
+    m_Pending = {};
+}
+
+std::shared_ptr<Task> VulkanBackend::elementwiseTask(std::string_view shader,
+                                                     const Tensor& src,
+                                                     Tensor& dst,
+                                                     std::vector<uint32_t> constants) {
+    TaskBuilder taskBuilder(*m_Engine);
+    taskBuilder.SetShader(m_ShaderDirectory + "/" + std::string(shader));
+    taskBuilder.SetSrcBuffer(vulkan(src).Storage);
+    taskBuilder.SetDstBuffer(vulkan(dst).Storage);
+    taskBuilder.SetPipeline({
+        .bindings = StorageBindings(2),
+        .constants = std::move(constants),
+    });
+    return taskBuilder.create();
+}
+
+} // namespace nn
@@ -0,0 +1,55 @@
+#pragma once
+#include <map>
+#include <memory>
+#include <tuple>
+#include "ComputeBackend.hpp"
+#include "ComputeEngine.hpp"
+
+namespace nn {
+
+class VulkanTensor : public Tensor {
+public:
+    VulkanTensor(uint32_t rows, uint32_t cols, std::shared_ptr<Buffer> storage)
+        : Tensor(rows, cols),
+          Storage(std::move(storage)) {}
+
+    std::shared_ptr<Buffer> Storage;
+};
+
+// queues operations into a TaskGraph that Finish submits as one command buffer.
+// a task is built the first time an operation meets a set of tensors and reused afterwards
+class VulkanBackend : public ComputeBackend {
+public:
+    explicit VulkanBackend(const EngineConfig& config = {}, std::string shaderDirectory = "tests/spirv");
+
+    std::string Name() const override;
+
+    std::unique_ptr<Tensor> CreateTensor(uint32_t rows, uint32_t cols) override;
+    void Write(Tensor& tensor, std::span<const float> data) override;
+    void Read(const Tensor& tensor, std::span<float> data) override;
+
+    void Gemm(const Tensor& src, const Tensor& weights, const Tensor& bias, Tensor& dst, Activation function) override;
+    void Activate(const Tensor& src, Tensor& dst, Activation function) override;
+    void SumRows(const Tensor& src, Tensor& dst) override;
+
+    void Finish() override;
+
+    ComputeEngine& Engine() { return *m_Engine; }
+
+private:
+    // operation, the buffers involved and the activation. the cached task holds on to its buffers,
+    // so their addresses cannot be reused by a later tensor the way a tensor's own address could
+    using TaskKey = std::tuple<int, const Buffer*, const Buffer*, const Buffer*, const Buffer*, Activation>;
+
+    std::shared_ptr<Task> elementwiseTask(std::string_view shader,
+                                          const Tensor& src,
+                                          Tensor& dst,
+                                          std::vector<uint32_t> constants);
+
+    std::unique_ptr<ComputeEngine> m_Engine;
+    std::string m_ShaderDirectory;
+    std::map<TaskKey, std::shared_ptr<Task>> m_Tasks;
+    TaskGraph m_Pending;
+};
+
+} // namespace nn
@@ -0,0 +1,199 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <random>
+#include <vector>
+#include "ComputeBackend.hpp"
+#include "CpuBackend.hpp"
+#include "InferenceNetwork.hpp"
+#include "InferenceServer.hpp"
+#include "Log.hpp"
+#include "ModelFile.hpp"
+#include "VulkanBackend.hpp"
+
+// run with VK_ICD_FILENAMES pointing at lavapipe's icd json to compare against vulkan on the cpu
+
+namespace {
+
+std::vector<float> randomVector(size_t count, uint32_t seed) {
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+    std::vector<float> values(count);
+    for (float& value : values) {
+        value = distribution(generator);
+    }
+    return values;
+}
+
+struct Result {
+    std::vector<float> Logits;
+    std::vector<float> ColumnSums;
+    double Gflops;
+};
+
+// the same network code for every backend: a two layer perceptron forward pass and a column reduction
+Result forward(nn::ComputeBackend& backend, uint32_t batch, uint32_t inputs, uint32_t hidden, uint32_t classes) {
+    auto input = backend.CreateTensor(batch, inputs);
+    auto weights1 = backend.CreateTensor(inputs, hidden);
+    auto bias1 = backend.CreateTensor(1, hidden);
+    auto activations = backend.CreateTensor(batch, hidden);
+    auto weights2 = backend.CreateTensor(hidden, classes);
+    auto bias2 = backend.CreateTensor(1, classes);
+    auto logits = backend.CreateTensor(batch, classes);
+    auto sums = backend.CreateTensor(1, classes);
+
+    backend.Write(*input, randomVector(input->Count(), 1));
+    backend.Write(*weights1, randomVector(weights1->Count(), 2));
+    backend.Write(*bias1, randomVector(bias1->Count(), 3));
+    backend.Write(*weights2, randomVector(weights2->Count(), 4));
+    backend.Write(*bias2, randomVector(bias2->Count(), 5));
+
+    auto run = [&] {
+        backend.Gemm(*input, *weights1, *bias1, *activations, nn::Activation::eNone);
+        backend.Activate(*activations, *activations, nn::Activation::eRelu);
+        backend.Gemm(*activations, *weights2, *bias2, *logits, nn::Activation::eSigmoid);
+        backend.SumRows(*logits, *sums);
+        backend.Finish();
+    };
+
+    // the first run builds the backend's pipelines
+    run();
+    constexpr int timedRuns = 5;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < timedRuns; i++) {
+        run();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+    Result result = {
+        .Logits = std::vector<float>(logits->Count()),
+        .ColumnSums = std::vector<float>(sums->Count()),
+        .Gflops = 2.0 * batch * (double(inputs) * hidden + double(hidden) * classes) * timedRuns / seconds * 1e-9,
+    };
+    backend.Read(*logits, result.Logits);
+    backend.Read(*sums, result.ColumnSums);
+    return result;
+}
+
+float maxDifference(const std::vector<float>& a, const std::vector<float>& b) {
+    float difference = 0.0f;
+    for (size_t i = 0; i < a.size(); i++) {
+        difference = std::max(difference, std::abs(a[i] - b[i]));
+    }
+    return difference;
+}
+
+std::vector<uint8_t> bytes(const std::vector<float>& values) {
+    std::vector<uint8_t> result(values.size() * sizeof(float));
+    std::memcpy(result.data(), values.data(), result.size());
+    return result;
+}
+
+// a saved fp32 model served from the backend through the inference server, against the layers on the host
+bool serveModel(nn::ComputeBackend& backend) {
+    constexpr uint32_t batch = 4;
+    const std::vector<uint32_t> widths = {20, 16, 5};
+    const std::vector<nn::Activation> functions = {nn::Activation::eRelu, nn::Activation::eSigmoid};
+
+    std::vector<std::vector<float>> weights, biases;
+    std::vector<std::vector<uint8_t>> weightBytes, biasBytes;
+    std::vector<nn::ModelLayerData> layers;
+    for (size_t i = 0; i + 1 < widths.size(); i++) {
+        weights.push_back(randomVector(size_t(widths[i]) * widths[i + 1], uint32_t(10 + i)));
+        biases.push_back(randomVector(widths[i + 1], uint32_t(20 + i)));
+        weightBytes.push_back(bytes(weights.back()));
+        biasBytes.push_back(bytes(biases.back()));
+    }
+    for (size_t i = 0; i + 1 < widths.size(); i++) {
+        layers.push_back({
+            .Inputs = widths[i],
+            .Outputs = widths[i + 1],
+            .Function = functions[i],
+            .Storage = nn::Precision::eFloat32,
+            .InputScale = 1.0f,
+            .WeightScale = 1.0f,
+            .Weights = weightBytes[i],
+            .Bias = biasBytes[i],
+        });
+    }
+    nn::WriteModel("backend.nnm", layers);
+
+    nn::InferenceNetwork network(backend, nn::ModelFile("backend.nnm"), batch);
+    nn::InferenceServer server(network);
+
+    // fewer requests than a batch and more, so one batch goes out full and one on the latency bound
+    constexpr size_t requests = batch + 3;
+    std::vector<std::vector<float>> samples;
+    std::vector<std::future<std::vector<float>>> results;
+    for (size_t r = 0; r < requests; r++) {
+        samples.push_back(randomVector(widths.front(), uint32_t(30 + r)));
+        results.push_back(server.Infer(samples.back()));
+    }
+
+    for (size_t r = 0; r < requests; r++) {
+        std::vector<float> values = samples[r];
+        for (size_t i = 0; i + 1 < widths.size(); i++) {
+            std::vector<float> next(biases[i]);
+            for (uint32_t k = 0; k < widths[i]; k++) {
+                for (uint32_t n = 0; n < widths[i + 1]; n++) {
+                    next[n] += values[k] * weights[i][size_t(k) * widths[i + 1] + n];
+                }
+            }
+            for (float& value : next) {
+                bool relu = functions[i] == nn::Activation::eRelu;
+                value = relu ? std::max(value, 0.0f) : 1.0f / (1.0f + std::exp(-value));
+            }
+            values = next;
+        }
+
+        float difference = maxDifference(values, results[r].get());
+        if (difference > 1e-4f) {
+            nn::LogError(backend.Name(), "served request", r, "off by", difference);
+            return false;
+        }
+    }
+    nn::LogInfo(backend.Name(), "served a saved model");
+    return true;
+}
+
+} // namespace
+
+int main() {
+    try {
+        constexpr uint32_t batch = 512;
+        constexpr uint32_t inputs = 784;
+        constexpr uint32_t hidden = 1024;
+        constexpr uint32_t classes = 10;
+
+        nn::CpuBackend cpu;
+        Result cpuResult = forward(cpu, batch, inputs, hidden, classes);
+        nn::LogInfo(cpu.Name(), cpuResult.Gflops, "GFLOPS");
+        if (!serveModel(cpu)) {
+            return 1;
+        }
+
+        std::unique_ptr<nn::ComputeBackend> backend = nn::CreateBackend();
+        if (dynamic_cast<nn::VulkanBackend*>(backend.get())) {
+            Result vulkanResult = forward(*backend, batch, inputs, hidden, classes);
+            nn::LogInfo(backend->Name(), vulkanResult.Gflops, "GFLOPS");
+
+            float logitDifference = maxDifference(cpuResult.Logits, vulkanResult.Logits);
+            float sumDifference = maxDifference(cpuResult.ColumnSums, vulkanResult.ColumnSums);
+            if (logitDifference > 1e-3f || sumDifference > 1e-2f) {
+                nn::LogError("backends disagree, logits by", logitDifference, "sums by", sumDifference);
+                return 1;
+            }
+            nn::LogInfo("backends agree");
+            if (!serveModel(*backend)) {
+                return 1;
+            }
+        }
+    } catch (std::exception& e) {
+        nn::LogError(e.what());
+        return 1;
+    }
+
+    return 0;
+}
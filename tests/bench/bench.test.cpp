@@ -0,0 +1,368 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+#include "ComputeEngine.hpp"
+#include "Dense.hpp"
+#include "InferenceNetwork.hpp"
+#include "Log.hpp"
+#include "TaskBuilder.hpp"
+#include "Trainer.hpp"
+
+// micro and end-to-end benchmarks with a summary of every one on stdout and all samples summarised in json.
+// needs nothing but a vulkan device, so CPU-only machines run it on lavapipe, e.g. with
+// VK_DRIVER_FILES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json. arguments:
+//   --quick         smaller sizes and fewer runs, for CI on software rasterizers
+//   --runs n        timed runs per benchmark after the warmup
+//   --warmup n      untimed runs first, pipelines, caches and clocks settle
+//   --filter text   only benchmarks whose name contains text
+//   --json path     where the results go, bench.json by default
+//   --device name   run on the device whose name contains name rather than the best scoring one
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// the device's own time for a task that just ran when timestamps are available, else the host's
+double deviceSeconds(const nn::Task& task, double hostSeconds) {
+    return task.GpuTimeNs() ? *task.GpuTimeNs() * 1e-9 : hostSeconds;
+}
+
+struct Options {
+    bool Quick = false;
+    size_t Runs = 20;
+    size_t Warmup = 3;
+    std::string Filter;
+    std::string JsonPath = "bench.json";
+    std::string Device;
+};
+
+struct Summary {
+    std::string Name;
+    std::string Unit; // of Throughput, per second
+    size_t Runs;
+    double Min; // seconds per run
+    double Median;
+    double Mean;
+    double P95;
+    double Max;
+    double Deviation;
+    double Throughput; // work per run over the median
+    std::map<std::string, size_t> Counters; // per run figures that are not timings, e.g. upload_bytes
+};
+
+class Harness {
+public:
+    explicit Harness(const Options& options) : m_Options(options) {}
+
+    // run returns the seconds one repetition took, work is what a repetition does in Unit, e.g. GB or GFLOP.
+    // counters are written next to the timings as they are
+    void Run(const std::string& name,
+             double work,
+             const std::string& unit,
+             const std::function<double()>& run,
+             const std::map<std::string, size_t>& counters = {}) {
+        if (!m_Options.Filter.empty() && name.find(m_Options.Filter) == std::string::npos) {
+            return;
+        }
+
+        for (size_t i = 0; i < m_Options.Warmup; i++) {
+            run();
+        }
+        std::vector<double> samples(m_Options.Runs);
+        for (double& sample : samples) {
+            sample = run();
+        }
+        std::ranges::sort(samples);
+
+        double mean = std::accumulate(samples.begin(), samples.end(), 0.0) / double(samples.size());
+        double variance = 0.0;
+        for (double sample : samples) {
+            variance += (sample - mean) * (sample - mean);
+        }
+        auto percentile = [&](double p) { return samples[std::min(samples.size() - 1, size_t(p * samples.size()))]; };
+
+        Summary summary = {
+            .Name = name,
+            .Unit = unit,
+            .Runs = samples.size(),
+            .Min = samples.front(),
+            .Median = percentile(0.5),
+            .Mean = mean,
+            .P95 = percentile(0.95),
+            .Max = samples.back(),
+            .Deviation = samples.size() > 1 ? std::sqrt(variance / double(samples.size() - 1)) : 0.0,
+            .Throughput = work / percentile(0.5),
+            .Counters = counters,
+        };
+        nn::LogInfo(name,
+                    summary.Throughput,
+                    unit + "/s, median",
+                    summary.Median * 1e6,
+                    "us, min",
+                    summary.Min * 1e6,
+                    "p95",
+                    summary.P95 * 1e6,
+                    "stddev",
+                    summary.Deviation * 1e6);
+        m_Results.push_back(summary);
+    }
+
+    void WriteJson(std::ostream& os, const std::string& device) const {
+        os << "{\"device\":\"" << device << "\",\"benchmarks\":[";
+        bool first = true;
+        for (const Summary& result : m_Results) {
+            os << (first ? "" : ",") << "{\"name\":\"" << result.Name << "\",\"unit\":\"" << result.Unit
+               << "/s\",\"runs\":" << result.Runs << ",\"throughput\":" << result.Throughput
+               << ",\"min_s\":" << result.Min << ",\"median_s\":" << result.Median << ",\"mean_s\":" << result.Mean
+               << ",\"p95_s\":" << result.P95 << ",\"max_s\":" << result.Max << ",\"stddev_s\":" << result.Deviation;
+            for (const auto& [counter, value] : result.Counters) {
+                os << ",\"" << counter << "\":" << value;
+            }
+            os << "}";
+            first = false;
+        }
+        os << "]}\n";
+    }
+
+    const Options& Settings() const { return m_Options; }
+
+private:
+    Options m_Options;
+    std::vector<Summary> m_Results;
+};
+
+Options parseOptions(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (argument == "--quick") {
+            options.Quick = true;
+            options.Runs = 5;
+            options.Warmup = 1;
+        } else if (argument == "--runs" && hasValue) {
+            options.Runs = std::max(1, std::stoi(argv[++i]));
+        } else if (argument == "--warmup" && hasValue) {
+            options.Warmup = std::max(0, std::stoi(argv[++i]));
+        } else if (argument == "--filter" && hasValue) {
+            options.Filter = argv[++i];
+        } else if (argument == "--json" && hasValue) {
+            options.JsonPath = argv[++i];
+        } else if (argument == "--device" && hasValue) {
+            options.Device = argv[++i];
+        } else {
+            throw std::runtime_error("unknown argument " + argument);
+        }
+    }
+    return options;
+}
+
+//--- Dispatch
+void benchDispatch(Harness& harness, nn::ComputeEngine& engine) {
+    nn::TaskBuilder taskBuilder(engine);
+    taskBuilder.SetShader("tests/spirv/empty.comp.spv");
+    taskBuilder.SetBuffers({
+        .SrcCount = 1,
+        .SrcSize = sizeof(float),
+        .DstCount = 1,
+        .DstSize = sizeof(float),
+    });
+    taskBuilder.SetPipeline({.bindings = nn::StorageBindings(2)});
+    std::shared_ptr<nn::Task> task = taskBuilder.create();
+
+    // submit to completion as seen by a host that waits on every dispatch
+    harness.Run("dispatch/round_trip", 1.0, "dispatches", [&] {
+        auto start = Clock::now();
+        task->Execute(engine);
+        return secondsSince(start);
+    });
+
+    // what the host pays to get a recorded dispatch onto the queue
+    harness.Run("dispatch/submit", 1.0, "dispatches", [&] {
+        task->Submit(engine);
+        double seconds = std::chrono::duration<double>(task->SubmitOverhead()).count();
+        task->Wait(engine);
+        return seconds;
+    });
+
+    constexpr size_t batched = 64;
+    harness.Run("dispatch/batched_64", double(batched), "dispatches", [&] {
+        auto start = Clock::now();
+        for (size_t i = 0; i < batched; i++) {
+            engine.PushTask(task);
+        }
+        engine.Wait(engine.ExecuteTasksAsync());
+        return secondsSince(start);
+    });
+}
+
+//--- Bandwidth
+void benchTransfers(Harness& harness, nn::ComputeEngine& engine) {
+    const size_t bytes = harness.Settings().Quick ? 8 << 20 : 32 << 20;
+    const double gigabytes = double(bytes) * 1e-9;
+    std::shared_ptr<nn::Buffer> device = engine.CreateBuffer(bytes / 4, 4, nn::MemoryUsage::eDeviceLocal);
+    std::vector<uint32_t> host(bytes / 4);
+    std::iota(host.begin(), host.end(), 0u);
+
+    harness.Run("transfer/host_to_device", gigabytes, "GB", [&] {
+        auto start = Clock::now();
+        engine.Wait(engine.Upload(*device, std::span<const uint32_t>(host)));
+        return secondsSince(start);
+    });
+
+    harness.Run("transfer/device_to_host", gigabytes, "GB", [&] {
+        auto start = Clock::now();
+        engine.Download(*device, std::span<uint32_t>(host));
+        return secondsSince(start);
+    });
+
+    // a kernel reading and writing device-local storage buffers, every element read once and written once
+    nn::TaskBuilder taskBuilder(engine);
+    taskBuilder.SetShader("tests/spirv/mnist.comp.spv");
+    taskBuilder.SetBuffers({
+        .SrcCount = bytes / 4,
+        .SrcSize = 4,
+        .DstCount = bytes / 4,
+        .DstSize = 4,
+        .SrcUsage = nn::MemoryUsage::eDeviceLocal,
+        .DstUsage = nn::MemoryUsage::eDeviceLocal,
+    });
+    taskBuilder.SetPipeline({.bindings = nn::StorageBindings(2)});
+    std::shared_ptr<nn::Task> task = taskBuilder.create();
+
+    harness.Run("storage/read_write", 2.0 * gigabytes, "GB", [&] {
+        auto start = Clock::now();
+        task->Execute(engine);
+        return deviceSeconds(*task, secondsSince(start));
+    });
+}
+
+//--- Gemm
+void benchGemm(Harness& harness, nn::ComputeEngine& engine) {
+    std::vector<uint32_t> sizes = {128, 256, 512, 1024};
+    if (harness.Settings().Quick) {
+        sizes = {128, 256};
+    }
+
+    std::vector<std::pair<nn::GemmKernel, std::string>> kernels = {
+        {nn::GemmKernel::eNaive, "naive"},
+        {nn::GemmKernel::eTiled, "tiled"},
+    };
+    if (engine.HasFloat16()) {
+        kernels.push_back({nn::GemmKernel::eTiledFloat16, "tiled_f16"});
+    }
+
+    for (uint32_t size : sizes) {
+        for (const auto& [kernel, kernelName] : kernels) {
+            nn::DenseSpecification spec = {
+                .Inputs = size,
+                .Outputs = size,
+                .Batch = size,
+                .Kernel = kernel,
+            };
+            size_t elementSize = nn::PrecisionSize(nn::GemmPrecision(kernel));
+            // contents do not change the timing, the weights stay as allocated
+            std::shared_ptr<nn::Task> task = nn::CreateGemmTask(
+                engine,
+                spec,
+                nullptr,
+                nullptr,
+                engine.CreateBuffer(size_t(size) * size, elementSize, nn::MemoryUsage::eDeviceLocal),
+                engine.CreateBuffer(size, sizeof(float), nn::MemoryUsage::eDeviceLocal));
+
+            double gigaflops = 2.0 * double(size) * size * size * 1e-9;
+            harness.Run("gemm/" + kernelName + "/" + std::to_string(size), gigaflops, "GFLOP", [&] {
+                auto start = Clock::now();
+                task->Execute(engine);
+                return deviceSeconds(*task, secondsSince(start));
+            });
+        }
+    }
+}
+
+//--- Mnist
+// synthetic batches of the mnist shapes, the dataset is not needed to time a step
+void benchMnist(Harness& harness, nn::ComputeEngine& engine) {
+    constexpr uint32_t batch = 256;
+    constexpr uint32_t pixels = 784;
+
+    std::mt19937 generator(1);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::vector<uint8_t> images(batch * pixels);
+    std::vector<uint8_t> labels(batch);
+    for (uint8_t& value : images) {
+        value = uint8_t(byte(generator));
+    }
+    for (uint8_t& value : labels) {
+        value = uint8_t(byte(generator) % 10);
+    }
+
+    nn::Trainer trainer(engine,
+                        {
+                            .Widths = {pixels, 128, 10},
+                            .Batch = batch,
+                        });
+    harness.Run(
+        "mnist/train_step",
+        double(batch),
+        "images",
+        [&] {
+            auto start = Clock::now();
+            trainer.Step(images, labels);
+            return secondsSince(start);
+        },
+        {{"upload_bytes", trainer.UploadBytes()}});
+
+    nn::InferenceNetwork network(engine, trainer.Layers(), nn::Precision::eFloat32);
+    std::vector<float> input(images.begin(), images.end());
+    std::vector<float> logits(batch * 10);
+    harness.Run("mnist/inference", double(batch), "images", [&] {
+        auto start = Clock::now();
+        network.Forward(input, logits);
+        return secondsSince(start);
+    });
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    try {
+        Harness harness(parseOptions(argc, argv));
+
+        nn::ComputeEngine computeEngine({
+            .Device = harness.Settings().Device,
+            .Float16 = true,
+        });
+        std::string device = computeEngine.GPU().getProperties().deviceName.data();
+        nn::LogInfo("benchmarking on", device);
+
+        benchDispatch(harness, computeEngine);
+        benchTransfers(harness, computeEngine);
+        benchGemm(harness, computeEngine);
+        benchMnist(harness, computeEngine);
+
+        std::ofstream json(harness.Settings().JsonPath);
+        if (!json) {
+            nn::LogError("could not write", harness.Settings().JsonPath);
+            return 1;
+        }
+        harness.WriteJson(json, device);
+    } catch (std::exception& e) {
+        nn::LogError(e.what());
+        throw e;
+    }
+
+    return 0;
+}
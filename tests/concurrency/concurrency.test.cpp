@@ -0,0 +1,133 @@
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "Activation.hpp"
+#include "ComputeEngine.hpp"
+#include "Log.hpp"
+#include "TaskBuilder.hpp"
+#include "TaskGraph.hpp"
+
+namespace {
+
+constexpr uint32_t elementCount = 4096;
+
+// relu over a host-visible input tagged with the producer and iteration, so every result is checkable
+std::shared_ptr<nn::Task> buildTask(const nn::ComputeEngine& engine, uint32_t producer, uint32_t iteration) {
+    nn::TaskBuilder taskBuilder(engine);
+    taskBuilder.SetShader("tests/spirv/activate.comp.spv");
+    taskBuilder.SetBuffers({
+        .SrcCount = elementCount,
+        .SrcSize = sizeof(float),
+        .DstCount = elementCount,
+        .DstSize = sizeof(float),
+    });
+    taskBuilder.SetPipeline({
+        .bindings = nn::StorageBindings(2),
+        .constants = {elementCount, static_cast<uint32_t>(nn::Activation::eRelu)},
+    });
+    std::shared_ptr<nn::Task> task = taskBuilder.create();
+
+    std::span<float> src = task->SrcView<float>();
+    for (uint32_t i = 0; i < elementCount; i++) {
+        src[i] = float(producer * 1000 + iteration) * (i % 2 ? 1.0f : -1.0f);
+    }
+    return task;
+}
+
+bool verify(const nn::Task& task) {
+    std::span<const float> src = task.SrcView<float>();
+    std::span<const float> dst = task.DstView<float>();
+    for (uint32_t i = 0; i < elementCount; i++) {
+        if (dst[i] != std::max(src[i], 0.0f)) {
+            nn::LogError("relu mismatch at", i, "expected", std::max(src[i], 0.0f), "got", dst[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main() {
+    try {
+        nn::ComputeEngine computeEngine;
+
+        const uint32_t producers = std::clamp(std::thread::hardware_concurrency(), 4u, 16u);
+        constexpr uint32_t iterations = 200;
+
+        // every producer builds its own tasks and cycles through the three ways of submitting them,
+        // a single consumer drains whatever was pushed onto the engine's queue meanwhile
+        std::vector<std::vector<std::shared_ptr<nn::Task>>> pushed(producers);
+        std::atomic<bool> failed = false;
+        std::atomic<uint32_t> running = producers;
+
+        std::vector<std::thread> threads;
+        for (uint32_t producer = 0; producer < producers; producer++) {
+            threads.emplace_back([&, producer] {
+                try {
+                    for (uint32_t iteration = 0; iteration < iterations && !failed; iteration++) {
+                        std::shared_ptr<nn::Task> task = buildTask(computeEngine, producer, iteration);
+                        switch (iteration % 3) {
+                            case 0:
+                                computeEngine.PushTask(task);
+                                pushed[producer].push_back(task);
+                                continue;
+                            case 1: {
+                                nn::TaskGraph graph;
+                                graph.Add(task);
+                                computeEngine.Wait(computeEngine.ExecuteGraph(graph, producer));
+                                break;
+                            }
+                            default:
+                                task->Execute(computeEngine);
+                                break;
+                        }
+                        if (!verify(*task)) {
+                            failed = true;
+                        }
+                    }
+                } catch (std::exception& e) {
+                    nn::LogError(e.what());
+                    failed = true;
+                }
+                running--;
+            });
+        }
+
+        size_t drains = 0;
+        while (running > 0) {
+            computeEngine.ExecuteTasks();
+            drains++;
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        computeEngine.ExecuteTasks();
+
+        for (const auto& tasks : pushed) {
+            for (const auto& task : tasks) {
+                if (!verify(*task)) {
+                    failed = true;
+                }
+            }
+        }
+        if (failed) {
+            return 1;
+        }
+
+        nn::LogInfo(producers,
+                    "producers submitted",
+                    producers * iterations,
+                    "tasks over",
+                    drains,
+                    "drains,",
+                    computeEngine.CommandPools().Created(),
+                    "command pools created");
+    } catch (std::exception& e) {
+        nn::LogError(e.what());
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "ComputeEngine.hpp"
+#include "Conv.hpp"
+#include "Log.hpp"
+#include "TaskGraph.hpp"
+#include "Trainer.hpp"
+
+namespace {
+
+std::vector<float> randomVector(size_t count, uint32_t seed) {
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+    std::vector<float> values(count);
+    for (float& value : values) {
+        value = distribution(generator);
+    }
+    return values;
+}
+
+void run(nn::ComputeEngine& engine, const std::vector<std::shared_ptr<nn::Task>>& tasks) {
+    nn::TaskGraph graph;
+    for (const auto& task : tasks) {
+        graph.Add(task);
+    }
+    engine.Wait(engine.ExecuteGraph(graph));
+}
+
+// odd sizes on purpose, so tiles, Winograd's 2 x 2 outputs and filter groups are all partial at the edges
+bool verify(nn::ComputeEngine& engine, nn::ConvKernel kernel, uint32_t kernelSize, uint32_t padding) {
+    nn::ConvSpecification spec = {
+        .Batch = 3,
+        .Height = 13,
+        .Width = 11,
+        .Channels = 3,
+        .Filters = 10,
+        .KernelSize = kernelSize,
+        .Padding = padding,
+        .Function = nn::Activation::eRelu,
+        .Kernel = kernel,
+    };
+    nn::Conv layer(engine, spec);
+
+    std::vector<float> input = randomVector(size_t(spec.Batch) * spec.Height * spec.Width * spec.Channels, 1);
+    std::vector<float> weights = randomVector(size_t(spec.PatchSize()) * spec.Filters, 2);
+    std::vector<float> bias = randomVector(spec.Filters, 3);
+    engine.Upload(*layer.Input(), std::span<const float>(input));
+    engine.Upload(*layer.Weights(), std::span<const float>(weights));
+    engine.Upload(*layer.Bias(), std::span<const float>(bias));
+
+    run(engine, layer.Forward());
+
+    const uint32_t outputHeight = spec.OutputHeight();
+    const uint32_t outputWidth = spec.OutputWidth();
+    std::vector<float> output(size_t(spec.Batch) * outputHeight * outputWidth * spec.Filters);
+    engine.Download(*layer.Output(), std::span<float>(output));
+
+    for (uint32_t n = 0; n < spec.Batch; n++) {
+        for (uint32_t y = 0; y < outputHeight; y++) {
+            for (uint32_t x = 0; x < outputWidth; x++) {
+                for (uint32_t f = 0; f < spec.Filters; f++) {
+                    float expected = bias[f];
+                    for (uint32_t ky = 0; ky < kernelSize; ky++) {
+                        for (uint32_t kx = 0; kx < kernelSize; kx++) {
+                            int iy = int(y + ky) - int(padding);
+                            int ix = int(x + kx) - int(padding);
+                            if (iy < 0 || ix < 0 || iy >= int(spec.Height) || ix >= int(spec.Width)) {
+                                continue;
+                            }
+                            for (uint32_t c = 0; c < spec.Channels; c++) {
+                                size_t pixel = ((size_t(n) * spec.Height + iy) * spec.Width + ix) * spec.Channels;
+                                expected += input[pixel + c] *
+                                            weights[((ky * kernelSize + kx) * spec.Channels + c) * spec.Filters + f];
+                            }
+                        }
+                    }
+                    expected = std::max(expected, 0.0f);
+
+                    float actual = output[((size_t(n) * outputHeight + y) * outputWidth + x) * spec.Filters + f];
+                    if (std::abs(actual - expected) > 1e-4f * std::max(1.0f, std::abs(expected))) {
+                        nn::LogError("kernel",
+                                     static_cast<uint32_t>(kernel),
+                                     "output mismatch at",
+                                     n,
+                                     y,
+                                     x,
+                                     f,
+                                     "expected",
+                                     expected,
+                                     "got",
+                                     actual);
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool verifyPool(nn::ComputeEngine& engine) {
+    nn::PoolSpecification spec = {
+        .Batch = 2,
+        .Height = 13,
+        .Width = 10,
+        .Channels = 5,
+        .Size = 2,
+    };
+    std::shared_ptr<nn::Task> pool = nn::CreatePoolTask(engine, spec, nullptr, nullptr);
+    std::vector<float> input = randomVector(pool->Src()->Count, 4);
+    engine.Upload(*pool->Src(), std::span<const float>(input));
+    run(engine, {pool});
+
+    std::vector<float> output(pool->Dst()->Count);
+    engine.Download(*pool->Dst(), std::span<float>(output));
+    const uint32_t height = spec.Height / spec.Size;
+    const uint32_t width = spec.Width / spec.Size;
+    for (size_t i = 0; i < output.size(); i++) {
+        size_t c = i % spec.Channels;
+        size_t x = i / spec.Channels % width * spec.Size;
+        size_t y = i / spec.Channels / width % height * spec.Size;
+        size_t n = i / (spec.Channels * width * height);
+        float expected = -INFINITY;
+        for (size_t dy = 0; dy < spec.Size; dy++) {
+            for (size_t dx = 0; dx < spec.Size; dx++) {
+                size_t pixel = (n * spec.Height + y + dy) * spec.Width + x + dx;
+                expected = std::max(expected, input[pixel * spec.Channels + c]);
+            }
+        }
+        if (output[i] != expected) {
+            nn::LogError("pooled output mismatch at", i, "expected", expected, "got", output[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+// the backward pass never depends on the forward kernel, so every kernel trains the same up to rounding
+bool verifyTraining(nn::ComputeEngine& engine) {
+    constexpr uint32_t batch = 32;
+    constexpr size_t steps = 4;
+
+    std::mt19937 generator(6);
+    std::uniform_int_distribution<int> pixel(0, 255);
+    std::uniform_int_distribution<int> label(0, 9);
+    std::vector<uint8_t> images(batch * 784);
+    std::vector<uint8_t> labels(batch);
+    for (uint8_t& value : images) {
+        value = uint8_t(pixel(generator));
+    }
+    for (uint8_t& value : labels) {
+        value = uint8_t(label(generator));
+    }
+
+    std::vector<float> expected;
+    for (nn::ConvKernel kernel : {nn::ConvKernel::eIm2col, nn::ConvKernel::eDirect, nn::ConvKernel::eWinograd}) {
+        nn::Trainer trainer(engine,
+                            {
+                                .Widths = {784, 32, 10},
+                                .Batch = batch,
+                                .Seed = 8,
+                                .Convolutions = {{.Filters = 4, .Kernel = kernel}, {.Filters = 8, .Kernel = kernel}},
+                            });
+
+        std::vector<float> losses;
+        for (size_t step = 0; step < steps; step++) {
+            losses.push_back(trainer.Step(images, labels).Loss);
+        }
+        if (losses.back() >= losses.front()) {
+            nn::LogError("kernel", static_cast<uint32_t>(kernel), "did not reduce the loss on a fixed batch");
+            return false;
+        }
+        if (expected.empty()) {
+            expected = losses;
+        }
+        for (size_t step = 0; step < steps; step++) {
+            if (std::abs(losses[step] - expected[step]) > 1e-3f * std::max(1.0f, expected[step])) {
+                nn::LogError("kernel", static_cast<uint32_t>(kernel), "step", step, "loss", losses[step]);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main() {
+    try {
+        nn::ComputeEngine computeEngine;
+
+        for (nn::ConvKernel kernel : {nn::ConvKernel::eDirect, nn::ConvKernel::eIm2col, nn::ConvKernel::eWinograd}) {
+            // padding that keeps the size and none at all, Winograd takes 3 x 3 only
+            if (!verify(computeEngine, kernel, 3, 1) || !verify(computeEngine, kernel, 3, 0)) {
+                return 1;
+            }
+            if (kernel != nn::ConvKernel::eWinograd && !verify(computeEngine, kernel, 5, 2)) {
+                return 1;
+            }
+        }
+        if (!verifyPool(computeEngine)) {
+            return 1;
+        }
+        nn::LogInfo("convolution and pooling outputs verified");
+
+        // the first selection times every kernel, the next one for the same shape is a lookup
+        for (uint32_t channels : {1u, 8u, 32u}) {
+            nn::ConvSpecification spec = {
+                .Batch = 128,
+                .Height = 28,
+                .Width = 28,
+                .Channels = channels,
+                .Filters = 16,
+            };
+            auto start = std::chrono::high_resolution_clock::now();
+            nn::ConvKernel selected = nn::SelectConvKernel(computeEngine, spec);
+            auto selectedAt = std::chrono::high_resolution_clock::now();
+            nn::ConvKernel cached = nn::SelectConvKernel(computeEngine, spec);
+            auto cachedAt = std::chrono::high_resolution_clock::now();
+            if (cached != selected) {
+                nn::LogError("the cached kernel differs from the one selected");
+                return 1;
+            }
+
+            using mu = std::chrono::microseconds;
+            nn::LogInfo("28 x 28 x",
+                        channels,
+                        "-> 16 filters selected kernel",
+                        static_cast<uint32_t>(selected),
+                        "in",
+                        std::chrono::duration_cast<mu>(selectedAt - start).count(),
+                        "microseconds, cached in",
+                        std::chrono::duration_cast<mu>(cachedAt - selectedAt).count());
+        }
+
+        if (!verifyTraining(computeEngine)) {
+            return 1;
+        }
+        nn::LogInfo("convolution training verified");
+    } catch (std::exception& e) {
+        nn::LogError(e.what());
+        throw e;
+    }
+
+    return 0;
+}
@@ -0,0 +1,176 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+#include "ComputeEngine.hpp"
+#include "Dense.hpp"
+#include "Log.hpp"
+#include "TaskGraph.hpp"
+
+namespace {
+
+std::vector<float> randomVector(size_t count, uint32_t seed) {
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+    std::vector<float> values(count);
+    for (float& value : values) {
+        value = distribution(generator);
+    }
+    return values;
+}
+
+// compares a layer with odd shapes against a host reference, exercising the partial tiles
+bool verify(nn::ComputeEngine& engine, nn::GemmKernel kernel, nn::Activation function) {
+    nn::DenseSpecification spec = {
+        .Inputs = 70,
+        .Outputs = 133,
+        .Batch = 100,
+        .Function = function,
+        .Kernel = kernel,
+    };
+    nn::Dense layer(engine, spec);
+
+    std::vector<float> input = randomVector(size_t(spec.Batch) * spec.Inputs, 1);
+    std::vector<float> weights = randomVector(size_t(spec.Inputs) * spec.Outputs, 2);
+    std::vector<float> bias = randomVector(spec.Outputs, 3);
+    engine.Upload(*layer.Input(), std::span<const float>(input));
+    engine.Upload(*layer.Weights(), std::span<const float>(weights));
+    engine.Upload(*layer.Bias(), std::span<const float>(bias));
+
+    layer.Forward()->Execute(engine);
+
+    std::vector<float> output(size_t(spec.Batch) * spec.Outputs);
+    engine.Download(*layer.Output(), std::span<float>(output));
+
+    for (uint32_t row = 0; row < spec.Batch; row++) {
+        for (uint32_t col = 0; col < spec.Outputs; col++) {
+            float expected = bias[col];
+            for (uint32_t k = 0; k < spec.Inputs; k++) {
+                expected += input[row * spec.Inputs + k] * weights[k * spec.Outputs + col];
+            }
+            if (function == nn::Activation::eRelu) {
+                expected = std::max(expected, 0.0f);
+            } else if (function == nn::Activation::eSigmoid) {
+                expected = 1.0f / (1.0f + std::exp(-expected));
+            }
+
+            float actual = output[row * spec.Outputs + col];
+            if (std::abs(actual - expected) > 1e-3f * std::max(1.0f, std::abs(expected))) {
+                nn::LogError("dense output mismatch at", row, col, "expected", expected, "got", actual);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// mean device time of a forward pass, in GFLOPS
+double benchmark(nn::ComputeEngine& engine, nn::GemmKernel kernel, uint32_t batch, uint32_t inputs, uint32_t outputs) {
+    nn::Dense layer(engine,
+                    {
+                        .Inputs = inputs,
+                        .Outputs = outputs,
+                        .Batch = batch,
+                        .Function = nn::Activation::eRelu,
+                        .Kernel = kernel,
+                    });
+    layer.Initialize(engine, 0);
+
+    constexpr int warmupRuns = 3;
+    constexpr int timedRuns = 20;
+    for (int i = 0; i < warmupRuns; i++) {
+        layer.Forward()->Execute(engine);
+    }
+
+    double totalNs = 0.0;
+    for (int i = 0; i < timedRuns; i++) {
+        layer.Forward()->Execute(engine);
+        totalNs += layer.Forward()->GpuTimeNs().value_or(0.0);
+    }
+    return totalNs > 0.0 ? layer.Flops() * timedRuns / totalNs : 0.0;
+}
+
+// images per second of independent layers run on separate streams, one stream per compute queue in use
+double streams(nn::ComputeEngine& engine, uint32_t count) {
+    constexpr uint32_t batch = 256;
+    constexpr int runs = 50;
+
+    std::vector<std::unique_ptr<nn::Dense>> layers;
+    std::vector<nn::TaskGraph> graphs(count);
+    for (uint32_t stream = 0; stream < count; stream++) {
+        layers.push_back(std::make_unique<nn::Dense>(engine,
+                                                     nn::DenseSpecification{
+                                                         .Inputs = 784,
+                                                         .Outputs = 1024,
+                                                         .Batch = batch,
+                                                         .Function = nn::Activation::eRelu,
+                                                     }));
+        layers.back()->Initialize(engine, stream);
+        graphs[stream].Add(layers.back()->Forward());
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<nn::SubmitHandle> handles(count);
+    for (int run = 0; run < runs; run++) {
+        for (uint32_t stream = 0; stream < count; stream++) {
+            handles[stream] = engine.ExecuteGraph(graphs[stream], stream);
+        }
+    }
+    for (nn::SubmitHandle handle : handles) {
+        engine.Wait(handle);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    return double(batch) * runs * count / seconds;
+}
+
+} // namespace
+
+int main() {
+    try {
+        nn::ComputeEngine computeEngine;
+
+        for (nn::GemmKernel kernel : {nn::GemmKernel::eTiled, nn::GemmKernel::eNaive}) {
+            for (nn::Activation function : {nn::Activation::eNone, nn::Activation::eRelu, nn::Activation::eSigmoid}) {
+                if (!verify(computeEngine, kernel, function)) {
+                    return 1;
+                }
+            }
+        }
+        nn::LogInfo("dense outputs verified");
+
+        // the first mnist layer over a large batch, then a square product
+        struct Shape {
+            uint32_t Batch, Inputs, Outputs;
+        };
+        for (Shape shape : {Shape{1024, 784, 1024}, Shape{2048, 2048, 2048}}) {
+            double tiled = benchmark(computeEngine, nn::GemmKernel::eTiled, shape.Batch, shape.Inputs, shape.Outputs);
+            double naive = benchmark(computeEngine, nn::GemmKernel::eNaive, shape.Batch, shape.Inputs, shape.Outputs);
+            nn::LogInfo("gemm",
+                        shape.Batch,
+                        "x",
+                        shape.Inputs,
+                        "x",
+                        shape.Outputs,
+                        "tiled",
+                        tiled,
+                        "GFLOPS, naive",
+                        naive,
+                        "GFLOPS");
+        }
+
+        nn::LogInfo(computeEngine.ComputeQueueCount(),
+                    "compute queues,",
+                    computeEngine.HasTransferQueue() ? "with" : "without",
+                    "a transfer queue");
+        for (uint32_t count = 1; count <= computeEngine.ComputeQueueCount(); count++) {
+            nn::LogInfo(count, "streams", streams(computeEngine, count), "images/s");
+        }
+    } catch (std::exception& e) {
+        nn::LogError(e.what());
+        return 1;
+    }
+
+    return 0;
+}
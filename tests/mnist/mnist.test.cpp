@@ -1,27 +1,27 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
 #include <fstream>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
 #include "ComputeEngine.hpp"
+#include "Dataset.hpp"
+#include "InferenceNetwork.hpp"
+#include "ModelFile.hpp"
 #include "TaskBuilder.hpp"
+#include "Trainer.hpp"
 #include "Log.hpp"
 
-#define IMAGE_HEADER_OFFSET 16
-#define LABEL_HEADER_OFFSET 8
-
-std::vector<uint8_t> ImportMnist(const char* path, size_t offset) {
-    if (std::ifstream ifs{path, std::ios::binary | std::ios::ate}) {
-        size_t fileSize = size_t(ifs.tellg()) + offset;
-        std::vector<uint8_t> contents(fileSize);
-
-        ifs.seekg(offset).read((char*)contents.data(), fileSize);
-        return contents; // RVO
-    } else {
-        nn::LogError("could not open", path);
-        return {};
-    }
-}
-
 int main() {
     try {
-        nn::ComputeEngine computeEngine;
+        nn::ComputeEngine computeEngine({
+            .Float16 = true,
+            .Int8 = true,
+        });
         nn::TaskBuilder taskBuilder(computeEngine);
 
         taskBuilder.SetShader("tests/spirv/mnist.comp.spv");
@@ -52,16 +52,348 @@ int main() {
         });
 
         auto task = taskBuilder.create();
-        computeEngine.PushTask(task);
 
-        computeEngine.ExecuteTasks();
+        nn::AllocatorStats memoryStats = computeEngine.Allocator().Stats();
+        nn::LogInfo("device memory:",
+                    memoryStats.BytesInUse,
+                    "bytes in use of",
+                    memoryStats.BytesReserved,
+                    "reserved, fragmentation",
+                    memoryStats.Fragmentation);
+
+        std::span<int32_t> input = task->SrcView<int32_t>();
+        std::iota(input.begin(), input.end(), 0);
+
+        task->Execute(computeEngine);
+
+        std::span<int32_t> output = task->DstView<int32_t>();
+        for (size_t i = 0; i < output.size(); i++) {
+            if (output[i] != input[i] * 2) {
+                nn::LogError("mapped output mismatch at", i, "expected", input[i] * 2, "got", output[i]);
+                return 1;
+            }
+        }
+        nn::LogInfo("GPU kernel time:", task->GpuTimeNs().value_or(0.0) / 1000.0, "microseconds");
+
+        // device-local buffers are only reachable through the staging ring
+        taskBuilder.SetBuffers({
+            .SrcCount = 28,
+            .SrcSize = sizeof(int32_t),
+            .DstCount = 28,
+            .DstSize = sizeof(int32_t),
+            .SrcUsage = nn::MemoryUsage::eDeviceLocal,
+            .DstUsage = nn::MemoryUsage::eDeviceLocal,
+        });
+        auto deviceTask = taskBuilder.create();
+
+        std::vector<int32_t> hostInput(28), hostOutput(28);
+        std::iota(hostInput.begin(), hostInput.end(), 100);
+        computeEngine.Upload(*deviceTask->Src(), std::span<const int32_t>(hostInput));
+        deviceTask->Execute(computeEngine);
+        computeEngine.Download(*deviceTask->Dst(), std::span<int32_t>(hostOutput));
+        for (size_t i = 0; i < hostOutput.size(); i++) {
+            if (hostOutput[i] != hostInput[i] * 2) {
+                nn::LogError("staged output mismatch at", i);
+                return 1;
+            }
+        }
+
+        taskBuilder.SetBuffers({
+            .SrcCount = 28,
+            .SrcSize = sizeof(int32_t),
+            .DstCount = 28,
+            .DstSize = sizeof(int32_t),
+        });
+
+        // recorded once, every further run only pays for the submit
+        constexpr int runs = 1000;
+        std::chrono::nanoseconds overhead{};
+        for (int i = 0; i < runs; i++) {
+            task->Submit(computeEngine);
+            overhead += task->SubmitOverhead();
+            task->Wait(computeEngine);
+        }
+        nn::LogInfo("host overhead per dispatch:", overhead.count() / runs, "nanoseconds");
+
+        // the same kernels batched into one submission, the host is free until it waits
+        for (int i = 0; i < 64; i++) {
+            computeEngine.PushTask(task);
+        }
+        auto batchStart = std::chrono::high_resolution_clock::now();
+        nn::SubmitHandle batch = computeEngine.ExecuteTasksAsync();
+        auto batchSubmitted = std::chrono::high_resolution_clock::now();
+        computeEngine.Wait(batch);
+        auto batchFinish = std::chrono::high_resolution_clock::now();
+
+        using mu = std::chrono::microseconds;
+        nn::LogInfo("batched 64 dispatches: submit",
+                    std::chrono::duration_cast<mu>(batchSubmitted - batchStart).count(),
+                    "microseconds, complete",
+                    std::chrono::duration_cast<mu>(batchFinish - batchStart).count(),
+                    "microseconds");
+
+        // layer 2 consumes layer 1's output, the side branch only shares its read-only input
+        taskBuilder.SetSrcBuffer(task->Dst());
+        auto layer2 = taskBuilder.create();
+        taskBuilder.SetSrcBuffer(task->Src());
+        auto branch = taskBuilder.create();
+        taskBuilder.SetSrcBuffer(nullptr);
+
+        nn::TaskGraph graph;
+        graph.Add(task);
+        graph.Add(layer2);
+        graph.Add(branch);
+        computeEngine.Wait(computeEngine.ExecuteGraph(graph));
+        nn::LogInfo("graph of", graph.Size(), "tasks scheduled in", graph.Depth(), "levels");
+
+        auto* src = (int32_t*)task->Src()->Memory.Mapped();
+        auto* dst = (int32_t*)layer2->Dst()->Memory.Mapped();
+        for (uint32_t i = 0; i < task->Src()->Count; i++) {
+            if (dst[i] != src[i] * 4) {
+                nn::LogError("layer 2 output mismatch at", i);
+                return 1;
+            }
+        }
+
+        taskBuilder.SetAutotune(true);
+        auto tuned = taskBuilder.create();
+        taskBuilder.SetAutotune(false);
+        nn::LogInfo("autotuned workgroup size:", tuned->WorkgroupSize());
+
+        computeEngine.Profiler().WriteJson(std::cout);
+        if (std::ofstream trace{"mnist_trace.json"}) {
+            computeEngine.Profiler().WriteChromeTrace(trace);
+        }
+
+        nn::IdxFile trainingLabels("tests/mnist/dataset/train-labels-idx1-ubyte");
+        nn::LogInfo("training labels:", trainingLabels.Count());
+
+        // the image files are not checked in, see dataset/readme.txt
+        if (!std::filesystem::exists("tests/mnist/dataset/train-images-idx3-ubyte") ||
+            !std::filesystem::exists("tests/mnist/dataset/t10k-images-idx3-ubyte")) {
+            nn::LogWarning("skipping training, the mnist image files are missing");
+            return 0;
+        }
+
+        nn::MnistDataset training("tests/mnist/dataset/train-images-idx3-ubyte",
+                                  "tests/mnist/dataset/train-labels-idx1-ubyte");
+
+        constexpr size_t batchSize = 256;
+        nn::Trainer trainer(computeEngine,
+                            {
+                                .Widths = {uint32_t(training.ImageSize()), 128, 10},
+                                .Batch = batchSize,
+                            });
+
+        // packs straight into the trainer's host-visible batch memory, the device reads the batch from there
+        nn::BatchPrefetcher prefetcher(training, batchSize, trainer.BatchSlots());
+        nn::EpochResult epoch = {};
+        for (int i = 0; i < 3; i++) {
+            epoch = trainer.TrainEpoch(prefetcher);
+            nn::LogInfo("epoch",
+                        i,
+                        "loss",
+                        epoch.Loss,
+                        "accuracy",
+                        epoch.Accuracy,
+                        "images/s",
+                        epoch.ImagesPerSecond,
+                        "stalled for",
+                        prefetcher.StallSeconds(),
+                        "seconds, uploaded",
+                        epoch.UploadBytes / std::max<size_t>(1, epoch.Images / batchSize),
+                        "bytes per batch");
+            // step decay, only the pushed learning rate changes
+            trainer.SetLearningRate(trainer.Specification().LearningRate * 0.5f);
+        }
+        if (epoch.Accuracy < 0.9f) {
+            nn::LogError("training accuracy stayed at", epoch.Accuracy);
+            return 1;
+        }
+
+        // the trained layers on the test set at every precision the device supports, int8 calibrated
+        // on a few training batches, and the accuracy each loses against the fp32 copy
+        nn::MnistDataset testing("tests/mnist/dataset/t10k-images-idx3-ubyte",
+                                 "tests/mnist/dataset/t10k-labels-idx1-ubyte");
+        const size_t imageSize = training.ImageSize();
+        auto toFloats = [&](const nn::MnistDataset& dataset, size_t first, std::span<float> out) {
+            for (size_t i = 0; i < out.size() / imageSize; i++) {
+                std::span<const uint8_t> image = dataset.Image(first + i);
+                for (size_t p = 0; p < imageSize; p++) {
+                    out[i * imageSize + p] = float(image[p]) / 255.0f;
+                }
+            }
+        };
+
+        // the trained weights through a model file and back, the accuracy below is measured on the reload
+        nn::SaveModel(computeEngine, trainer.Layers(), "mnist.nnm");
+        {
+            nn::ModelFile model("mnist.nnm");
+            computeEngine.Wait(nn::LoadModel(computeEngine, model, trainer.Layers()));
+        }
+
+        std::vector<float> calibration(4 * batchSize * imageSize);
+        toFloats(training, 0, calibration);
+
+        std::vector<float> testInputs(testing.Size() * imageSize);
+        std::vector<uint8_t> testLabels(testing.Size());
+        toFloats(testing, 0, testInputs);
+        for (size_t i = 0; i < testLabels.size(); i++) {
+            testLabels[i] = testing.Label(i);
+        }
+
+        std::optional<float> reference;
+        for (nn::Precision precision : {nn::Precision::eFloat32, nn::Precision::eFloat16, nn::Precision::eInt8}) {
+            if ((precision == nn::Precision::eFloat16 && !computeEngine.HasFloat16()) ||
+                (precision == nn::Precision::eInt8 && !computeEngine.HasInt8())) {
+                nn::LogWarning("skipping precision", int(precision), "the device does not support");
+                continue;
+            }
+
+            nn::InferenceNetwork network(computeEngine, trainer.Layers(), precision, calibration);
+            std::vector<float> input(batchSize * imageSize);
+            std::vector<float> logits(batchSize * 10);
+            size_t correct = 0;
+            size_t total = 0;
+            for (size_t first = 0; first + batchSize <= testing.Size(); first += batchSize) {
+                toFloats(testing, first, input);
+                network.Forward(input, logits);
+                for (size_t i = 0; i < batchSize; i++) {
+                    auto row = std::span(logits).subspan(i * 10, 10);
+                    size_t predicted = size_t(std::ranges::max_element(row) - row.begin());
+                    correct += predicted == testing.Label(first + i);
+                }
+                total += batchSize;
+            }
+
+            float accuracy = float(correct) / float(total);
+            reference = reference.value_or(accuracy);
+            nn::LogInfo("precision",
+                        int(precision),
+                        "test accuracy",
+                        accuracy,
+                        "loss against fp32",
+                        *reference - accuracy,
+                        "parameter bytes",
+                        network.ParameterBytes());
+            if (*reference - accuracy > (precision == nn::Precision::eInt8 ? 0.02f : 0.005f)) {
+                nn::LogError("reduced precision lost too much accuracy");
+                return 1;
+            }
+
+            // reduced on the device with two floats read back per batch, over the full batches it has to
+            // count exactly what the host did from every logit
+            if (computeEngine.HasSubgroupArithmetic()) {
+                nn::Evaluation fullBatches = network.Evaluate(std::span(testInputs).first(total * imageSize),
+                                                              std::span(testLabels).first(total));
+                if (size_t(std::lround(fullBatches.Accuracy * float(total))) != correct) {
+                    nn::LogError("device evaluation counted", fullBatches.Accuracy * float(total), "not", correct);
+                    return 1;
+                }
+                nn::Evaluation evaluation = network.Evaluate(testInputs, testLabels);
+                nn::LogInfo("device evaluation of",
+                            evaluation.Samples,
+                            "samples: loss",
+                            evaluation.Loss,
+                            "accuracy",
+                            evaluation.Accuracy);
+            }
+
+            // saved at its own precision and mapped back in, the reload computes exactly the same logits
+            std::string path = "mnist_" + std::to_string(int(precision)) + ".nnm";
+            network.Save(path);
+            auto loadStart = std::chrono::high_resolution_clock::now();
+            nn::InferenceNetwork reloaded(computeEngine, nn::ModelFile(path), batchSize);
+            auto loadFinish = std::chrono::high_resolution_clock::now();
+
+            std::vector<float> reloadedLogits(logits.size());
+            network.Forward(input, logits);
+            reloaded.Forward(input, reloadedLogits);
+            if (reloadedLogits != logits) {
+                nn::LogError("the model reloaded from", path, "computes different logits");
+                return 1;
+            }
+            nn::LogInfo("reloaded",
+                        path,
+                        "in",
+                        std::chrono::duration_cast<mu>(loadFinish - loadStart).count(),
+                        "microseconds");
+        }
+
+        // a small convolutional network against the MLP above, compared by test accuracy per FLOP
+        nn::Trainer cnn(computeEngine,
+                        {
+                            .Widths = {uint32_t(imageSize), 10},
+                            .Batch = batchSize,
+                            .Convolutions = {{.Filters = 4}, {.Filters = 8}},
+                        });
+        nn::BatchPrefetcher cnnPrefetcher(training, batchSize, cnn.BatchSlots());
+        for (int i = 0; i < 3; i++) {
+            epoch = cnn.TrainEpoch(cnnPrefetcher);
+            nn::LogInfo("cnn epoch",
+                        i,
+                        "loss",
+                        epoch.Loss,
+                        "accuracy",
+                        epoch.Accuracy,
+                        "images/s",
+                        epoch.ImagesPerSecond);
+            cnn.SetLearningRate(cnn.Specification().LearningRate * 0.5f);
+        }
+        for (const auto& conv : cnn.Convolutions()) {
+            nn::LogInfo("conv stage",
+                        conv->Specification().Channels,
+                        "->",
+                        conv->Specification().Filters,
+                        "at",
+                        conv->Specification().Width,
+                        "x",
+                        conv->Specification().Height,
+                        "runs kernel",
+                        static_cast<uint32_t>(conv->Specification().Kernel));
+        }
+
+        auto testAccuracy = [&](nn::Trainer& model) {
+            std::vector<uint8_t> batchImages(batchSize * imageSize);
+            std::vector<uint8_t> batchLabels(batchSize);
+            float accuracy = 0.0f;
+            size_t batches = 0;
+            for (size_t first = 0; first + batchSize <= testing.Size(); first += batchSize) {
+                for (size_t i = 0; i < batchSize; i++) {
+                    std::ranges::copy(testing.Image(first + i), batchImages.begin() + i * imageSize);
+                    batchLabels[i] = testing.Label(first + i);
+                }
+                accuracy += model.Evaluate(batchImages, batchLabels).Accuracy;
+                batches++;
+            }
+            return accuracy / float(batches);
+        };
+
+        float mlpAccuracy = testAccuracy(trainer);
+        float cnnAccuracy = testAccuracy(cnn);
+        double mlpFlops = trainer.Flops() / batchSize;
+        double cnnFlops = cnn.Flops() / batchSize;
+        nn::LogInfo("mlp test accuracy",
+                    mlpAccuracy,
+                    "at",
+                    mlpFlops / 1e6,
+                    "MFLOP per image, accuracy per MFLOP",
+                    mlpAccuracy / (mlpFlops / 1e6));
+        nn::LogInfo("cnn test accuracy",
+                    cnnAccuracy,
+                    "at",
+                    cnnFlops / 1e6,
+                    "MFLOP per image, accuracy per MFLOP",
+                    cnnAccuracy / (cnnFlops / 1e6));
+        // strictly better per FLOP, with a floor so a cheap but useless network cannot win on FLOPs alone
+        if (cnnAccuracy / cnnFlops <= mlpAccuracy / mlpFlops || cnnAccuracy < 0.9f) {
+            nn::LogError("the convolutional network is not more accurate per FLOP than the MLP");
+            return 1;
+        }
     } catch (std::exception& e) {
         nn::LogError(e.what());
         throw e;
     }
 
-    auto trainingImages = ImportMnist("tests/mnist/dataset/train-images-idx3-ubyte", IMAGE_HEADER_OFFSET);
-    auto trainingLabels = ImportMnist("tests/mnist/dataset/train-labels-idx1-ubyte", LABEL_HEADER_OFFSET);
-
     return 0;
 }
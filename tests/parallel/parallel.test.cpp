@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+#include "ComputeEngine.hpp"
+#include "DataParallelTrainer.hpp"
+#include "Log.hpp"
+#include "Trainer.hpp"
+
+namespace {
+
+constexpr size_t maxEngines = 4;
+constexpr size_t steps = 5;
+
+struct Batch {
+    std::vector<uint8_t> Images;
+    std::vector<uint8_t> Labels;
+};
+
+Batch randomBatch(size_t size, uint32_t seed) {
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<int> pixel(0, 255);
+    std::uniform_int_distribution<int> label(0, 9);
+    Batch batch = {std::vector<uint8_t>(size * 784), std::vector<uint8_t>(size)};
+    for (uint8_t& value : batch.Images) {
+        value = uint8_t(pixel(generator));
+    }
+    for (uint8_t& value : batch.Labels) {
+        value = uint8_t(label(generator));
+    }
+    return batch;
+}
+
+// sharding a batch only changes the order gradients are summed in, and every replica applies the same sums
+bool verify(const std::vector<nn::ComputeEngine*>& engines) {
+    nn::TrainerSpecification spec = {
+        .Widths = {784, 64, 64, 10},
+        .Batch = 64,
+        .Seed = 9,
+        .Checkpoint = 2,
+    };
+    Batch batch = randomBatch(spec.Batch, 4);
+
+    std::vector<float> expected;
+    nn::Trainer reference(*engines.front(), spec);
+    for (size_t step = 0; step < steps; step++) {
+        expected.push_back(reference.Step(batch.Images, batch.Labels).Loss);
+    }
+
+    for (size_t count = 2; count <= engines.size(); count *= 2) {
+        nn::DataParallelTrainer trainer({engines.begin(), engines.begin() + count}, spec);
+        for (size_t step = 0; step < steps; step++) {
+            float loss = trainer.Step(batch.Images, batch.Labels).Loss;
+            if (std::abs(loss - expected[step]) > 1e-3f * std::max(1.0f, expected[step])) {
+                nn::LogError(count, "engines, step", step, "loss", loss, "not", expected[step]);
+                return false;
+            }
+        }
+
+        for (size_t layer = 0; layer < trainer.Replica(0).Layers().size(); layer++) {
+            std::vector<std::vector<float>> weights;
+            for (size_t replica = 0; replica < count; replica++) {
+                const nn::Buffer& buffer = *trainer.Replica(replica).Layers()[layer]->Weights();
+                weights.emplace_back(buffer.Bytes() / sizeof(float));
+                engines[replica]->Download(buffer, std::span<float>(weights.back()));
+                if (weights.back() != weights.front()) {
+                    nn::LogError("replica", replica, "of", count, "drifted apart in layer", layer);
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// images per second of a step with the same shard on every engine, i.e. weak scaling
+double throughput(const std::vector<nn::ComputeEngine*>& engines, double& reduceSeconds) {
+    constexpr uint32_t shard = 128;
+    constexpr int warmupSteps = 2;
+    constexpr int timedSteps = 20;
+
+    nn::DataParallelTrainer trainer(engines,
+                                    {
+                                        .Widths = {784, 512, 512, 10},
+                                        .Batch = shard * uint32_t(engines.size()),
+                                    });
+    Batch batch = randomBatch(trainer.Specification().Batch, 2);
+    for (int step = 0; step < warmupSteps; step++) {
+        trainer.Step(batch.Images, batch.Labels);
+    }
+
+    double reduceStart = trainer.ReduceSeconds();
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int step = 0; step < timedSteps; step++) {
+        trainer.Step(batch.Images, batch.Labels);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    reduceSeconds = (trainer.ReduceSeconds() - reduceStart) / timedSteps;
+    return double(batch.Labels.size()) * timedSteps / seconds;
+}
+
+} // namespace
+
+int main() {
+    try {
+        std::vector<std::unique_ptr<nn::ComputeEngine>> computeEngines;
+        std::vector<nn::ComputeEngine*> engines;
+        for (size_t i = 0; i < maxEngines; i++) {
+            computeEngines.push_back(std::make_unique<nn::ComputeEngine>());
+            engines.push_back(computeEngines.back().get());
+        }
+
+        if (!verify(engines)) {
+            return 1;
+        }
+        nn::LogInfo("data-parallel losses and replicas verified");
+
+        double single = 0.0;
+        for (size_t count = 1; count <= maxEngines; count *= 2) {
+            double reduceSeconds = 0.0;
+            double imagesPerSecond = throughput({engines.begin(), engines.begin() + count}, reduceSeconds);
+            single = count == 1 ? imagesPerSecond : single;
+            nn::LogInfo(count,
+                        "engines:",
+                        imagesPerSecond,
+                        "images/s, scaling efficiency",
+                        imagesPerSecond / (single * double(count)),
+                        "- all-reduce",
+                        reduceSeconds * 1e3,
+                        "ms per step");
+        }
+    } catch (std::exception& e) {
+        nn::LogError(e.what());
+        throw e;
+    }
+
+    return 0;
+}
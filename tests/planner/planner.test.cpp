@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "ComputeEngine.hpp"
+#include "Log.hpp"
+#include "MemoryPlanner.hpp"
+#include "Trainer.hpp"
+
+namespace {
+
+constexpr uint32_t batch = 64;
+constexpr size_t steps = 5;
+
+// a chain where every tensor is read by the next step only, so at most two are live at once
+bool planChain() {
+    nn::MemoryPlanner planner;
+    std::vector<nn::MemoryPlanner::TensorId> tensors;
+    for (size_t i = 0; i < 8; i++) {
+        tensors.push_back(planner.AddTensor(1000 * (i + 1), sizeof(float)));
+    }
+    for (size_t i = 0; i + 1 < tensors.size(); i++) {
+        planner.AddStep({tensors[i], tensors[i + 1]});
+    }
+
+    nn::MemoryPlan plan = planner.Plan(256);
+    for (size_t a = 0; a < tensors.size(); a++) {
+        for (size_t b = a + 1; b < tensors.size(); b++) {
+            bool live = b == a + 1;
+            bool overlap = plan.Offsets[a] < plan.Offsets[b] + planner.Count(b) * sizeof(float) &&
+                           plan.Offsets[b] < plan.Offsets[a] + planner.Count(a) * sizeof(float);
+            if (live && overlap) {
+                nn::LogError("tensors", a, "and", b, "are live together but overlap");
+                return false;
+            }
+        }
+    }
+    if (plan.ArenaBytes < plan.LiveBytes || plan.ArenaBytes >= plan.UnplannedBytes) {
+        nn::LogError("unexpected arena of", plan.ArenaBytes, "bytes for", plan.LiveBytes, "live");
+        return false;
+    }
+    return true;
+}
+
+std::vector<float> train(nn::ComputeEngine& engine,
+                         const std::vector<uint8_t>& images,
+                         const std::vector<uint8_t>& labels,
+                         bool planMemory,
+                         uint32_t checkpoint) {
+    nn::Trainer trainer(engine,
+                        {
+                            .Widths = {784, 512, 512, 512, 512, 512, 512, 10},
+                            .Batch = batch,
+                            .Seed = 3,
+                            .PlanMemory = planMemory,
+                            .Checkpoint = checkpoint,
+                        });
+    const nn::MemoryPlan& memory = trainer.Memory();
+    nn::LogInfo(planMemory ? "planned," : "unplanned,",
+                "checkpoint",
+                checkpoint,
+                "- activations and gradients:",
+                (planMemory ? memory.ArenaBytes : memory.UnplannedBytes) / 1024,
+                "KiB, unplanned",
+                memory.UnplannedBytes / 1024,
+                "KiB, peak live",
+                memory.LiveBytes / 1024,
+                "KiB");
+
+    std::vector<float> losses;
+    for (size_t step = 0; step < steps; step++) {
+        losses.push_back(trainer.Step(images, labels).Loss);
+    }
+    return losses;
+}
+
+// the device's preprocessing against the host: evaluation normalizes the bytes where they are, and a training step
+// that only shifts moves every image by whole pixels, so one shift within MaxShift must reproduce it
+bool preprocess(nn::ComputeEngine& engine, const std::vector<uint8_t>& images, const std::vector<uint8_t>& labels) {
+    constexpr int width = 28;
+    constexpr int maxShift = 3;
+    constexpr float mean = 0.1307f;
+    constexpr float deviation = 0.3081f;
+    nn::Trainer trainer(engine,
+                        {
+                            .Widths = {width * width, 16, 10},
+                            .Batch = batch,
+                            .Seed = 3,
+                            .PlanMemory = false,
+                            .Mean = mean,
+                            .Deviation = deviation,
+                            .ImageWidth = width,
+                            .MaxShift = maxShift,
+                        });
+
+    // pixels shifted in from outside the image are background
+    auto expected = [&](uint32_t sample, int x, int y) {
+        bool inside = x >= 0 && y >= 0 && x < width && y < width;
+        float value = inside ? float(images[sample * width * width + y * width + x]) : 0.0f;
+        return (value / 255.0f - mean) / deviation;
+    };
+    auto matches = [&](const std::vector<float>& input, uint32_t sample, int dx, int dy) {
+        for (int y = 0; y < width; y++) {
+            for (int x = 0; x < width; x++) {
+                float value = input[sample * width * width + y * width + x];
+                float reference = expected(sample, x - dx, y - dy);
+                if (std::abs(value - reference) > 1e-5f * std::max(1.0f, std::abs(reference))) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    };
+
+    std::vector<float> input(images.size());
+    trainer.Evaluate(images, labels);
+    engine.Download(*trainer.Layers().front()->Input(), std::span<float>(input));
+    for (uint32_t sample = 0; sample < batch; sample++) {
+        if (!matches(input, sample, 0, 0)) {
+            nn::LogError("evaluation preprocessed sample", sample, "differently from the host");
+            return false;
+        }
+    }
+
+    trainer.Step(images, labels);
+    engine.Download(*trainer.Layers().front()->Input(), std::span<float>(input));
+    uint32_t shifted = 0;
+    for (uint32_t sample = 0; sample < batch; sample++) {
+        bool found = false;
+        for (int dy = -maxShift; dy <= maxShift && !found; dy++) {
+            for (int dx = -maxShift; dx <= maxShift && !found; dx++) {
+                if (matches(input, sample, dx, dy)) {
+                    found = true;
+                    shifted += dx != 0 || dy != 0 ? 1 : 0;
+                }
+            }
+        }
+        if (!found) {
+            nn::LogError("training sample", sample, "is not the host image shifted by at most", maxShift, "pixels");
+            return false;
+        }
+    }
+    if (shifted == 0) {
+        nn::LogError("no training sample was shifted");
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main() {
+    try {
+        if (!planChain()) {
+            return 1;
+        }
+
+        nn::ComputeEngine computeEngine;
+
+        std::mt19937 generator(5);
+        std::uniform_int_distribution<int> pixel(0, 255);
+        std::uniform_int_distribution<int> label(0, 9);
+        std::vector<uint8_t> images(batch * 784);
+        std::vector<uint8_t> labels(batch);
+        for (uint8_t& value : images) {
+            value = uint8_t(pixel(generator));
+        }
+        for (uint8_t& value : labels) {
+            value = uint8_t(label(generator));
+        }
+
+        if (!preprocess(computeEngine, images, labels)) {
+            return 1;
+        }
+
+        // sharing memory and recomputing activations change where values live, never what they are
+        std::vector<float> expected = train(computeEngine, images, labels, false, 0);
+        for (uint32_t checkpoint : {0u, 2u, 3u}) {
+            std::vector<float> losses = train(computeEngine, images, labels, true, checkpoint);
+            for (size_t step = 0; step < steps; step++) {
+                if (std::abs(losses[step] - expected[step]) > 1e-6f * std::max(1.0f, expected[step])) {
+                    nn::LogError("checkpoint", checkpoint, "step", step, "loss", losses[step], "not", expected[step]);
+                    return 1;
+                }
+            }
+        }
+    } catch (std::exception& e) {
+        nn::LogError(e.what());
+        throw e;
+    }
+
+    return 0;
+}
@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "ComputeEngine.hpp"
+#include "Log.hpp"
+#include "Quantization.hpp"
+#include "Reduction.hpp"
+
+namespace {
+
+// odd on purpose: rows that do not fill a workgroup and columns that do not fill a subgroup
+constexpr uint32_t rows = 37;
+constexpr uint32_t cols = 10;
+
+struct Logits {
+    std::vector<uint32_t> Stored; // as the kernels read them, padded to whole uints
+    std::vector<float> Decoded;   // what the host reference sees after the same rounding
+    float Scale = 1.0f;
+};
+
+Logits encode(const std::vector<float>& values, nn::Precision precision) {
+    Logits logits;
+    logits.Decoded.resize(values.size());
+    logits.Stored.resize((values.size() * nn::PrecisionSize(precision) + 3) / 4);
+    if (precision == nn::Precision::eFloat16) {
+        std::vector<uint16_t> halves(values.size());
+        nn::FloatToHalf(values, halves);
+        nn::HalfToFloat(halves, logits.Decoded);
+        std::copy_n(reinterpret_cast<const uint8_t*>(halves.data()),
+                    halves.size() * sizeof(uint16_t),
+                    reinterpret_cast<uint8_t*>(logits.Stored.data()));
+    } else if (precision == nn::Precision::eInt8) {
+        std::vector<int8_t> quantized(values.size());
+        logits.Scale = nn::SymmetricScale(values);
+        nn::Quantize(values, logits.Scale, quantized);
+        nn::Dequantize(quantized, logits.Scale, logits.Decoded);
+        std::copy_n(reinterpret_cast<const uint8_t*>(quantized.data()),
+                    quantized.size(),
+                    reinterpret_cast<uint8_t*>(logits.Stored.data()));
+    } else {
+        logits.Decoded = values;
+        std::copy_n(values.begin(), values.size(), reinterpret_cast<float*>(logits.Stored.data()));
+    }
+    return logits;
+}
+
+bool verify(nn::ComputeEngine& engine, nn::Precision precision, const std::vector<float>& values) {
+    Logits logits = encode(values, precision);
+    nn::ReductionSpecification spec = {
+        .Rows = rows,
+        .Cols = cols,
+        .Storage = precision,
+        .Scale = logits.Scale,
+    };
+
+    std::mt19937 generator(7);
+    std::uniform_int_distribution<int> label(0, cols - 1);
+    std::vector<uint8_t> labels((rows + 3) / 4 * 4);
+    for (uint8_t& value : labels) {
+        value = uint8_t(label(generator));
+    }
+
+    auto src = engine.CreateBuffer(logits.Stored.size(), sizeof(uint32_t), nn::MemoryUsage::eDeviceLocal);
+    auto probabilities = engine.CreateBuffer(size_t(rows) * cols, sizeof(float), nn::MemoryUsage::eDeviceLocal);
+    auto indices = engine.CreateBuffer(rows, sizeof(uint32_t), nn::MemoryUsage::eDeviceLocal);
+    auto labelBuffer = engine.CreateBuffer(labels.size() / 4, sizeof(uint32_t), nn::MemoryUsage::eDeviceLocal);
+    auto totals = engine.CreateBuffer(4, sizeof(float), nn::MemoryUsage::eReadback);
+    engine.Upload(*src, std::span<const uint32_t>(logits.Stored));
+    engine.Upload(*labelBuffer, std::span<const uint8_t>(labels));
+
+    nn::CreateSoftmaxTask(engine, spec, src, probabilities)->Execute(engine);
+    nn::CreateArgmaxTask(engine, spec, src, indices)->Execute(engine);
+
+    // every row into slot 0, a prefix into slot 1 like a short final batch
+    constexpr uint32_t prefix = 19;
+    std::shared_ptr<nn::Task> evaluate = nn::CreateEvaluateTask(engine, spec, src, labelBuffer, totals);
+    for (nn::EvaluateSlot slot : {nn::EvaluateSlot{0, rows}, nn::EvaluateSlot{1, prefix}}) {
+        evaluate->SetPushConstants(slot);
+        evaluate->Execute(engine);
+    }
+
+    std::vector<float> softmax(size_t(rows) * cols);
+    std::vector<uint32_t> argmax(rows);
+    engine.Download(*probabilities, std::span<float>(softmax));
+    engine.Download(*indices, std::span<uint32_t>(argmax));
+    std::span<const float> sums = totals->View<float>();
+
+    float loss = 0.0f;
+    float correct = 0.0f;
+    for (uint32_t row = 0; row < rows; row++) {
+        const float* begin = logits.Decoded.data() + size_t(row) * cols;
+        uint32_t expectedIndex = uint32_t(std::max_element(begin, begin + cols) - begin);
+        if (argmax[row] != expectedIndex) {
+            nn::LogError("argmax of row", row, "is", argmax[row], "not", expectedIndex);
+            return false;
+        }
+
+        float sum = 0.0f;
+        for (uint32_t col = 0; col < cols; col++) {
+            sum += std::exp(begin[col] - begin[expectedIndex]);
+        }
+        for (uint32_t col = 0; col < cols; col++) {
+            float expected = std::exp(begin[col] - begin[expectedIndex]) / sum;
+            float actual = softmax[size_t(row) * cols + col];
+            if (std::abs(actual - expected) > 1e-5f) {
+                nn::LogError("softmax of row", row, "column", col, "is", actual, "not", expected);
+                return false;
+            }
+        }
+
+        loss += std::log(sum) - (begin[labels[row]] - begin[expectedIndex]);
+        correct += expectedIndex == labels[row] ? 1.0f : 0.0f;
+        if (row + 1 == prefix &&
+            (std::abs(sums[2] - loss) > 1e-4f * std::max(1.0f, loss) || sums[3] != correct)) {
+            nn::LogError("prefix of", prefix, "rows has loss", sums[2], "and", sums[3], "correct, not", loss, correct);
+            return false;
+        }
+    }
+    if (std::abs(sums[0] - loss) > 1e-4f * std::max(1.0f, loss) || sums[1] != correct) {
+        nn::LogError("evaluation has loss", sums[0], "and", sums[1], "correct, not", loss, correct);
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main() {
+    try {
+        nn::ComputeEngine computeEngine;
+        if (!computeEngine.HasSubgroupArithmetic()) {
+            nn::LogWarning("no subgroup arithmetic in compute shaders, skipping the reduction kernels");
+            return 0;
+        }
+        nn::LogInfo("subgroup size", computeEngine.SubgroupSize());
+
+        std::mt19937 generator(3);
+        std::uniform_real_distribution<float> distribution(-4.0f, 4.0f);
+        std::vector<float> values(size_t(rows) * cols);
+        for (float& value : values) {
+            value = distribution(generator);
+        }
+        // ties resolve to the lowest index, the host's max_element does the same
+        std::fill_n(values.begin(), cols, 1.0f);
+        std::fill_n(values.begin() + cols + 3, 4, 4.0f);
+
+        for (nn::Precision precision : {nn::Precision::eFloat32, nn::Precision::eFloat16, nn::Precision::eInt8}) {
+            if (!verify(computeEngine, precision, values)) {
+                nn::LogError("precision", static_cast<uint32_t>(precision), "failed");
+                return 1;
+            }
+        }
+        nn::LogInfo("reductions verified");
+    } catch (std::exception& e) {
+        nn::LogError(e.what());
+        throw e;
+    }
+
+    return 0;
+}
@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ComputeEngine.hpp"
+#include "Dense.hpp"
+#include "InferenceNetwork.hpp"
+#include "InferenceServer.hpp"
+#include "Log.hpp"
+#include "SocketFrontend.hpp"
+
+namespace {
+
+constexpr uint32_t inputs = 784;
+constexpr uint32_t outputs = 10;
+constexpr uint32_t batch = 64;
+
+std::vector<float> randomSample(std::mt19937& generator) {
+    std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+    std::vector<float> sample(inputs);
+    for (float& value : sample) {
+        value = distribution(generator);
+    }
+    return sample;
+}
+
+bool matches(const std::vector<float>& actual, std::span<const float> expected) {
+    return actual.size() == expected.size() && std::ranges::equal(actual, expected, [](float a, float b) {
+               return std::abs(a - b) <= 1e-5f * std::max(1.0f, std::abs(b));
+           });
+}
+
+void report(const char* name, const nn::ServerStats& stats) {
+    nn::LogInfo(name,
+                stats.Requests,
+                "requests,",
+                stats.RequestsPerSecond,
+                "requests/s, batch fill",
+                stats.BatchFill,
+                "latency ms p50",
+                stats.P50,
+                "p95",
+                stats.P95,
+                "p99",
+                stats.P99,
+                "max",
+                stats.Max);
+}
+
+// poisson arrivals at a fixed rate regardless of how fast results come back, so queueing shows up in the tail
+nn::ServerStats openLoop(nn::InferenceServer& server, double rate, std::chrono::milliseconds duration) {
+    std::mt19937 generator(7);
+    std::exponential_distribution<double> interval(rate);
+    std::vector<float> sample = randomSample(generator);
+    std::vector<std::future<std::vector<float>>> results;
+
+    server.ResetStats();
+    auto start = std::chrono::steady_clock::now();
+    auto arrival = start;
+    while (arrival - start < duration) {
+        arrival += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(interval(generator)));
+        std::this_thread::sleep_until(arrival);
+        results.push_back(server.Infer(sample));
+    }
+    for (auto& result : results) {
+        result.get();
+    }
+    return server.Stats();
+}
+
+} // namespace
+
+int main() {
+    try {
+        nn::ComputeEngine computeEngine;
+
+        std::vector<std::unique_ptr<nn::Dense>> layers;
+        layers.push_back(std::make_unique<nn::Dense>(computeEngine,
+                                                     nn::DenseSpecification{
+                                                         .Inputs = inputs,
+                                                         .Outputs = 256,
+                                                         .Batch = batch,
+                                                         .Function = nn::Activation::eRelu,
+                                                     }));
+        layers.push_back(std::make_unique<nn::Dense>(computeEngine,
+                                                     nn::DenseSpecification{
+                                                         .Inputs = 256,
+                                                         .Outputs = outputs,
+                                                         .Batch = batch,
+                                                     },
+                                                     layers.back()->Output()));
+        for (uint32_t i = 0; i < layers.size(); i++) {
+            layers[i]->Initialize(computeEngine, i + 1);
+        }
+        nn::InferenceNetwork network(computeEngine, layers, nn::Precision::eFloat32);
+
+        // reference results from whole batches, rows are independent so batching must not change them
+        std::mt19937 generator(1);
+        std::vector<float> samples;
+        for (uint32_t i = 0; i < 4 * batch; i++) {
+            std::vector<float> sample = randomSample(generator);
+            samples.insert(samples.end(), sample.begin(), sample.end());
+        }
+        std::vector<float> expected(4 * batch * outputs);
+        for (uint32_t first = 0; first < 4 * batch; first += batch) {
+            network.Forward(std::span(samples).subspan(first * inputs, batch * inputs),
+                            std::span(expected).subspan(first * outputs, batch * outputs));
+        }
+
+        auto sample = [&](size_t i) { return std::span<const float>(samples).subspan(i * inputs, inputs); };
+        auto reference = [&](size_t i) { return std::span<const float>(expected).subspan(i * outputs, outputs); };
+
+        {
+            nn::InferenceServer server(network);
+
+            // many threads with one request each, they land in batches of whatever size the timing gives
+            std::vector<std::future<std::vector<float>>> results(4 * batch);
+            std::vector<std::thread> clients;
+            for (size_t client = 0; client < 8; client++) {
+                clients.emplace_back([&, client] {
+                    for (size_t i = client; i < results.size(); i += 8) {
+                        results[i] = server.Infer(sample(i));
+                    }
+                });
+            }
+            for (std::thread& client : clients) {
+                client.join();
+            }
+            for (size_t i = 0; i < results.size(); i++) {
+                if (!matches(results[i].get(), reference(i))) {
+                    nn::LogError("batched result mismatch for sample", i);
+                    return 1;
+                }
+            }
+            report("correctness run:", server.Stats());
+        }
+
+        // throughput against tail latency for a few batching deadlines and offered loads
+        for (auto maxLatency : {std::chrono::microseconds(500), std::chrono::microseconds(2000)}) {
+            nn::InferenceServer server(network, maxLatency);
+            for (double rate : {1000.0, 10000.0, 50000.0}) {
+                nn::ServerStats stats = openLoop(server, rate, std::chrono::milliseconds(500));
+                nn::LogInfo("max latency", maxLatency.count(), "us, offered", rate, "requests/s");
+                report("  open loop:", stats);
+            }
+        }
+
+#ifndef _WIN32
+        // closed loop through the socket, every client waits for its reply before sending the next sample
+        {
+            nn::InferenceServer server(network);
+            nn::SocketFrontend frontend(server, "nn_server_test.sock");
+
+            constexpr size_t connections = 16;
+            constexpr size_t requestsPerConnection = 256;
+            std::atomic<bool> failed = false;
+            std::vector<std::thread> clients;
+            for (size_t connection = 0; connection < connections; connection++) {
+                clients.emplace_back([&, connection] {
+                    try {
+                        nn::SocketClient client("nn_server_test.sock");
+                        for (size_t request = 0; request < requestsPerConnection && !failed; request++) {
+                            size_t i = (connection * requestsPerConnection + request) % (4 * batch);
+                            if (!matches(client.Infer(sample(i)), reference(i))) {
+                                nn::LogError("socket result mismatch for sample", i);
+                                failed = true;
+                            }
+                        }
+                    } catch (std::exception& e) {
+                        nn::LogError("socket client:", e.what());
+                        failed = true;
+                    }
+                });
+            }
+            for (std::thread& client : clients) {
+                client.join();
+            }
+            if (failed) {
+                return 1;
+            }
+            report("socket closed loop:", server.Stats());
+        }
+#endif
+    } catch (std::exception& e) {
+        nn::LogError(e.what());
+        throw e;
+    }
+
+    return 0;
+}